@@ -0,0 +1,532 @@
+/**
+ * @file main.cpp
+ * @brief Microbenchmarks for the MonitorFile internals.
+ *
+ * @details
+ * Built with `make bench`. Each benchmark prints one line per variant with
+ * the average cost per operation.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "flathashmap.hpp"
+#include "inotifyengine.hpp"
+#include "lineframer.hpp"
+#include "multimatcher.hpp"
+#include "pagealloc.hpp"
+#include "tailreader.hpp"
+#include "uncachedread.hpp"
+#include "uringreader.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/// Keeps the optimizer from discarding benchmark results.
+static volatile std::uint64_t sink;
+
+/**
+ * @brief Times @p ops calls of @p fn and prints the per-operation cost.
+ *
+ * @param label Name printed in the report.
+ * @param ops Number of operations @p fn performs.
+ * @param fn Benchmark body.
+ */
+template <typename Fn>
+static void run(const char *label, std::size_t ops, Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::printf("  %-36s %8.1f ns/op\n", label, ns / static_cast<double>(ops));
+}
+
+/**
+ * @brief Event routing: (wd, name) lookups against @p routes routes.
+ *
+ * @details
+ * Models the inotify engine's hot path with a realistic key shape (a few
+ * thousand directories, short file names) and a random access pattern.
+ * Lookup keys are laid out sequentially, as events are in a read buffer,
+ * so the measured cost is the table's own.
+ *
+ * @param routes Number of registered routes.
+ */
+static void bench_routing(std::size_t routes)
+{
+    constexpr std::size_t LOOKUPS = 4000000;
+
+    std::vector<RouteKey> keys;
+    keys.reserve(routes);
+    for (std::size_t i = 0; i < routes; ++i)
+    {
+        keys.push_back(RouteKey{static_cast<int>(i % 4096) + 1,
+                                "file-" + std::to_string(i) + ".log"});
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<RouteKey> hits;
+    std::vector<RouteKey> misses;
+    hits.reserve(LOOKUPS);
+    misses.reserve(LOOKUPS);
+    for (std::size_t i = 0; i < LOOKUPS; ++i)
+    {
+        const RouteKey &k = keys[rng() % routes];
+        hits.push_back(k);
+        misses.push_back(RouteKey{k.wd + 4096, k.name});
+    }
+
+    std::printf("Event routing, %zu routes:\n", routes);
+
+    FlatHashMap<RouteKey, std::uint32_t, RouteKeyHash> flat(routes * 8 / 7 + 1);
+    for (std::size_t i = 0; i < routes; ++i)
+    {
+        flat[keys[i]] = static_cast<std::uint32_t>(i);
+    }
+    run("FlatHashMap hit", LOOKUPS, [&] {
+        std::uint64_t sum = 0;
+        for (const auto &k : hits)
+            sum += *flat.find(k);
+        sink = sum;
+    });
+    run("FlatHashMap miss", LOOKUPS, [&] {
+        std::uint64_t sum = 0;
+        for (const auto &k : misses)
+            sum += flat.find(k) != nullptr;
+        sink = sum;
+    });
+
+    std::unordered_map<RouteKey, std::uint32_t, RouteKeyHash> node;
+    node.reserve(routes);
+    for (std::size_t i = 0; i < routes; ++i)
+    {
+        node[keys[i]] = static_cast<std::uint32_t>(i);
+    }
+    run("std::unordered_map hit", LOOKUPS, [&] {
+        std::uint64_t sum = 0;
+        for (const auto &k : hits)
+            sum += node.find(k)->second;
+        sink = sum;
+    });
+    run("std::unordered_map miss", LOOKUPS, [&] {
+        std::uint64_t sum = 0;
+        for (const auto &k : misses)
+            sum += node.find(k) != node.end();
+        sink = sum;
+    });
+}
+
+/**
+ * @brief Line framing: LineFramer against std::getline over a log buffer.
+ *
+ * @details
+ * Lines are 40 to 200 bytes, typical of application logs. Costs are per
+ * line framed.
+ */
+static void bench_framing()
+{
+    constexpr std::size_t BYTES = 64 * 1024 * 1024;
+
+    std::mt19937_64 rng(7);
+    std::string text;
+    text.reserve(BYTES + 256);
+    std::size_t count = 0;
+    while (text.size() < BYTES)
+    {
+        text.append(40 + rng() % 160, 'x');
+        text.push_back('\n');
+        ++count;
+    }
+
+    std::printf("Line framing, %zu MiB, %zu lines (%s):\n", BYTES >> 20, count,
+                delimiter_scan_isa());
+
+    run("LineFramer", count, [&] {
+        LineFramer framer;
+        LineBatch lines;
+        lines.reserve(count);
+        framer.frame(text.data(), text.size(), lines);
+        sink = lines.size();
+    });
+
+    run("std::getline", count, [&] {
+        std::istringstream in(text);
+        std::string line;
+        std::uint64_t n = 0;
+        while (std::getline(in, line))
+            n += line.size();
+        sink = n;
+    });
+}
+
+/**
+ * @brief Multi-pattern scanning: MultiMatcher throughput over log text.
+ *
+ * @details
+ * 300 error signatures built from common words, scanned over 64 MiB of
+ * log-like text with a signature roughly every 20 KiB. Reported in GB/s.
+ */
+static void bench_patterns()
+{
+    constexpr std::size_t BYTES = 64 * 1024 * 1024;
+    static const char *const WORDS[] = {"Exception", "Error", "timeout", "refused", "failed",
+                                        "null", "pointer", "disk", "OOM", "panic"};
+
+    std::mt19937_64 rng(11);
+    std::vector<std::string> signatures;
+    for (int i = 0; i < 300; ++i)
+    {
+        signatures.push_back(std::string(WORDS[rng() % 10]) + " " + std::to_string(rng() % 100000));
+    }
+
+    static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz 0123456789:.-[]ABCDEFGHIJ";
+    std::string text;
+    text.reserve(BYTES + 64);
+    while (text.size() < BYTES)
+    {
+        if (rng() % 20000 == 0)
+            text += signatures[rng() % signatures.size()];
+        else
+            text.push_back(ALPHABET[rng() % (sizeof(ALPHABET) - 1)]);
+        if (rng() % 100 == 0)
+            text.push_back('\n');
+    }
+
+    MultiMatcher matcher(signatures);
+    std::uint64_t matches = 0;
+    auto start = std::chrono::steady_clock::now();
+    matcher.scan(text, [&](std::size_t, std::size_t) { ++matches; });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = matches;
+
+    std::printf("Multi-pattern scan, %zu patterns, %zu MiB (%s):\n", signatures.size(),
+                BYTES >> 20, MultiMatcher::isa());
+    std::printf("  %-36s %8.2f GB/s\n", "MultiMatcher", static_cast<double>(text.size()) / seconds / 1e9);
+}
+
+/**
+ * @brief Bytes of @p fd's first @p size bytes resident in the page cache.
+ */
+static std::size_t resident_bytes(int fd, std::size_t size)
+{
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return 0;
+    const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> pages((size + page - 1) / page);
+    std::size_t resident = 0;
+    if (::mincore(map, size, pages.data()) == 0)
+    {
+        for (unsigned char p : pages)
+            resident += (p & 1) ? page : 0;
+    }
+    ::munmap(map, size);
+    return resident;
+}
+
+/**
+ * @brief Whole-file hashing in each cache mode, from a cold cache.
+ *
+ * @details
+ * Reports throughput and how much of the file is left in the page cache
+ * afterwards, which is what a verification pass costs the rest of the
+ * service. The file is created next to the binary's working directory so
+ * it lands on a real file system rather than tmpfs.
+ */
+static void bench_uncached()
+{
+    constexpr std::size_t BYTES = 256 * 1024 * 1024;
+    const std::string path = "monitorfile_bench.dat";
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return;
+    std::vector<char> block(1 << 20);
+    std::mt19937_64 rng(5);
+    for (std::size_t off = 0; off < BYTES; off += block.size())
+    {
+        for (auto &c : block)
+            c = static_cast<char>(rng());
+        if (::pwrite(fd, block.data(), block.size(), static_cast<off_t>(off)) < 0)
+            break;
+    }
+    ::fsync(fd);
+
+    std::printf("Hashing %zu MiB from a cold cache:\n", BYTES >> 20);
+    const ReadMode modes[] = {ReadMode::CACHED, ReadMode::DIRECT, ReadMode::DONTCACHE,
+                              ReadMode::DROP_BEHIND};
+    for (ReadMode mode : modes)
+    {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        auto start = std::chrono::steady_clock::now();
+        auto hash = hash_file(path, mode);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink = hash.value_or(0);
+
+        auto reader = BlockReader::open(path, mode);
+        std::printf("  %-16s (in effect: %-13s) %6.2f GB/s, %6.1f MiB left cached\n",
+                    read_mode_name(mode), reader ? read_mode_name(reader->mode()) : "-",
+                    static_cast<double>(BYTES) / seconds / 1e9,
+                    static_cast<double>(resident_bytes(fd, BYTES)) / (1 << 20));
+    }
+    ::close(fd);
+    ::unlink(path.c_str());
+}
+
+/**
+ * @brief Tailing many files from a cold cache, pread() per file vs io_uring.
+ *
+ * @details
+ * Every file gets the same backlog of appended lines, then its pages are
+ * dropped so each read has to reach the device. TailReader polls the files
+ * one after another on a single thread; UringReader polls all of them at
+ * once from the same thread.
+ */
+static void bench_uring_tail()
+{
+    constexpr std::size_t FILES = 256;
+    constexpr std::size_t BYTES = 1 << 20;
+    const std::string dir = "monitorfile_bench.d";
+    ::mkdir(dir.c_str(), 0700);
+
+    std::vector<std::string> paths;
+    std::string text;
+    for (std::size_t i = 0; text.size() < BYTES; ++i)
+        text += "2025-01-01T00:00:00 bench line " + std::to_string(i) + "\n";
+    for (std::size_t i = 0; i < FILES; ++i)
+    {
+        paths.push_back(dir + "/tail" + std::to_string(i) + ".log");
+        int fd = ::open(paths.back().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+            return;
+        if (::write(fd, text.data(), text.size()) < 0)
+            sink = 0;
+        ::fsync(fd);
+        ::close(fd);
+    }
+
+    auto drop_caches = [&] {
+        for (const auto &path : paths)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    };
+    auto report = [&](const char *label, double seconds, std::size_t lines) {
+        std::printf("  %-36s %8.2f GB/s (%zu lines)\n", label,
+                    static_cast<double>(FILES * text.size()) / seconds / 1e9, lines);
+    };
+
+    std::printf("Tailing %zu files of %zu KiB from a cold cache:\n", FILES, text.size() >> 10);
+    {
+        std::vector<std::unique_ptr<TailReader>> readers;
+        for (const auto &path : paths)
+            readers.push_back(std::make_unique<TailReader>(path, false));
+        drop_caches();
+        std::size_t lines = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto &reader : readers)
+            lines += reader->poll([](const LineBatch &batch) { sink += batch.size(); });
+        report("TailReader (pread)", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), lines);
+    }
+    for (unsigned depth : {32u, 128u, 512u})
+    {
+        UringOptions options;
+        options.queue_depth = depth;
+        options.buffers = depth;
+        auto reader = UringReader::create(options);
+        if (!reader)
+        {
+            std::printf("  io_uring unavailable\n");
+            break;
+        }
+        for (const auto &path : paths)
+            reader->add(path, false);
+        drop_caches();
+        auto start = std::chrono::steady_clock::now();
+        std::size_t lines = reader->poll([](const std::string &, const LineBatch &batch) { sink += batch.size(); });
+        char label[64];
+        std::snprintf(label, sizeof(label), "UringReader, depth %u%s", depth, reader->registered() ? " (fixed)" : "");
+        report(label, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), lines);
+    }
+
+    for (const auto &path : paths)
+        ::unlink(path.c_str());
+    ::rmdir(dir.c_str());
+}
+
+/**
+ * @brief Opens a per-thread user-space performance counter.
+ *
+ * @return The counter descriptor, or -1 if the counter is unavailable
+ *         (common in virtual machines).
+ */
+static int open_counter(std::uint32_t type, std::uint64_t config)
+{
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+/**
+ * @brief Current value of a counter from open_counter(), or -1.
+ */
+static long long read_counter(int fd)
+{
+    long long value = 0;
+    if (fd < 0 || ::read(fd, &value, sizeof(value)) != sizeof(value))
+        return -1;
+    return value;
+}
+
+/**
+ * @brief One line of /proc/self/smaps_rollup, in bytes.
+ *
+ * @param field Field name including the colon, e.g. "AnonHugePages:".
+ */
+static std::size_t rollup_bytes(const std::string &field)
+{
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string key;
+    std::size_t kib = 0;
+    while (rollup >> key)
+    {
+        if (key == field && rollup >> kib)
+            return kib * 1024;
+        rollup.ignore(256, '\n');
+    }
+    return 0;
+}
+
+/**
+ * @brief Random lookups in a large watch table under each page policy.
+ *
+ * @details
+ * Builds a FlatHashMap the size of a million-watch routing table and
+ * probes it at random, reporting the lookup cost, dTLB load misses per
+ * lookup (when the CPU exposes the counter), page faults taken while the
+ * table was filled, and how much of it ended up on huge pages. On a
+ * multi-node machine the same table is then homed on the local and on a
+ * remote node.
+ */
+static void bench_pages()
+{
+    constexpr std::size_t ENTRIES = 4 * 1024 * 1024;
+    constexpr std::size_t LOOKUPS = 8 * 1024 * 1024;
+    const MemoryOptions saved = memory_options();
+
+    std::vector<std::uint64_t> keys(LOOKUPS);
+    std::mt19937_64 rng(9);
+    for (auto &k : keys)
+        k = rng() % ENTRIES;
+
+    const int dtlb = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    const int faults = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+
+    auto probe = [&](const char *label, int node) {
+        const long long faults_before = read_counter(faults);
+        FlatHashMap<std::uint64_t, std::uint64_t> table(ENTRIES * 8 / 7 + 1, node);
+        for (std::uint64_t i = 0; i < ENTRIES; ++i)
+            table[i] = i;
+        const long long build_faults = read_counter(faults) - faults_before;
+        const std::size_t thp = rollup_bytes("AnonHugePages:");
+        const std::size_t hugetlb = rollup_bytes("Private_Hugetlb:");
+
+        const long long misses_before = read_counter(dtlb);
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t sum = 0;
+        for (std::uint64_t k : keys)
+            sum += *table.find(k);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        const long long misses = read_counter(dtlb) - misses_before;
+        sink = sum;
+
+        char tlb[32] = "n/a";
+        if (dtlb >= 0)
+            std::snprintf(tlb, sizeof(tlb), "%.2f", static_cast<double>(misses) / LOOKUPS);
+        std::printf("  %-24s %6.1f ns/op, dTLB misses/op %6s, %8lld faults, %4zu MiB THP, %4zu MiB hugetlb\n",
+                    label, ns / LOOKUPS, tlb, faults < 0 ? -1LL : build_faults, thp >> 20,
+                    hugetlb >> 20);
+    };
+
+    std::printf("Watch table, %zu entries, random lookups:\n", ENTRIES);
+    const std::pair<const char *, PagePolicy> policies[] = {
+        {"base pages", PagePolicy::DEFAULT},
+        {"transparent huge pages", PagePolicy::TRANSPARENT},
+        {"explicit huge pages", PagePolicy::EXPLICIT}};
+    for (const auto &policy : policies)
+    {
+        configure_memory(MemoryOptions{policy.second, false});
+        probe(policy.first, -1);
+    }
+
+    const int nodes = numa_node_count();
+    if (nodes < 2)
+    {
+        std::printf("  remote access: one NUMA node, comparison skipped\n");
+    }
+    else
+    {
+        // Stay on the current CPU so "local" keeps meaning the same node.
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(static_cast<int>(::sched_getcpu()), &cpus);
+        ::sched_setaffinity(0, sizeof(cpus), &cpus);
+        const int local = current_numa_node();
+        configure_memory(MemoryOptions{PagePolicy::TRANSPARENT, true});
+        probe("THP, local node", local);
+        probe("THP, remote node", (local + 1) % nodes);
+        CPU_ZERO(&cpus);
+        for (unsigned c = 0; c < std::thread::hardware_concurrency(); ++c)
+            CPU_SET(c, &cpus);
+        ::sched_setaffinity(0, sizeof(cpus), &cpus);
+    }
+
+    configure_memory(saved);
+    if (dtlb >= 0)
+        ::close(dtlb);
+    if (faults >= 0)
+        ::close(faults);
+}
+
+/**
+ * @brief Runs every benchmark.
+ *
+ * @return 0 on completion.
+ */
+int main()
+{
+    bench_routing(10000);
+    bench_routing(1000000);
+    bench_framing();
+    bench_patterns();
+    bench_uncached();
+    bench_uring_tail();
+    bench_pages();
+    return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file canceltoken.hpp
+ * @brief Cancellation token handed to change callbacks.
+ *
+ * @details
+ * Every confirmed change gets a new generation number from its watch. A
+ * callback receives a token bound to the generation it is handling; once
+ * a newer change is confirmed the token reports cancelled(), telling a
+ * long-running reload that its work is stale and can be abandoned.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef CANCELTOKEN_HPP
+#define CANCELTOKEN_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class CancelToken
+ * @brief Cheap, copyable view of "has a newer change arrived?".
+ *
+ * @details
+ * Tokens share ownership of the generation counter, so they remain valid
+ * after the callback returns and may be handed to background work.
+ * A default-constructed token is never cancelled.
+ */
+class CancelToken
+{
+public:
+    /// Shared generation counter a token observes.
+    using Source = std::shared_ptr<const std::atomic<std::uint64_t>>;
+
+    /**
+     * @brief Creates a token that is never cancelled.
+     */
+    CancelToken() = default;
+
+    /**
+     * @brief Creates a token for one generation.
+     *
+     * @param source Counter bumped on every confirmed change.
+     * @param generation Generation this token belongs to.
+     */
+    CancelToken(Source source, std::uint64_t generation)
+        : source(std::move(source)), gen(generation)
+    {
+    }
+
+    /**
+     * @brief Checks whether a newer change has superseded this one.
+     *
+     * @return true once the work this token guards is stale.
+     */
+    bool cancelled() const
+    {
+        return source && source->load(std::memory_order_acquire) != gen;
+    }
+
+    /**
+     * @brief Generation this token belongs to.
+     */
+    std::uint64_t generation() const { return gen; }
+
+private:
+    Source source;         ///< Counter owned by the watch.
+    std::uint64_t gen = 0; ///< Generation being handled.
+};
+
+#endif // CANCELTOKEN_HPP
@@ -0,0 +1,259 @@
+/**
+ * @file churnstats.cpp
+ * @brief Implementation file for ChurnStats.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "churnstats.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "flathashmap.hpp"
+
+namespace
+{
+    /// Rounds @p n up to a power of two, at least one.
+    std::size_t power_of_two(std::size_t n)
+    {
+        std::size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+    /// Hash of a path shared by the sketch and the candidates.
+    std::uint64_t path_hash(std::string_view path)
+    {
+        return mix_hash(static_cast<std::uint64_t>(std::hash<std::string_view>()(path)));
+    }
+}
+
+/**
+ * @brief Allocates the sketch.
+ *
+ * @param options Sizing; zero values are raised to one.
+ */
+ChurnStats::ChurnStats(const ChurnOptions &options)
+    : width(power_of_two(options.width)),
+      depth(std::max<std::size_t>(options.depth, 1)),
+      top_k(std::max<std::size_t>(options.top_k, 1)),
+      slices(std::max<std::size_t>(options.slices, 1)),
+      slice_length(std::max<Clock::duration>(
+          std::chrono::duration_cast<Clock::duration>(options.window) /
+              static_cast<Clock::rep>(std::max<std::size_t>(options.slices, 1)),
+          Clock::duration(1))),
+      slice_counts(slices * depth * width, 0),
+      window_counts(depth * width, 0),
+      slice_totals(slices, 0),
+      current(Clock::now().time_since_epoch() / slice_length)
+{
+    heap.reserve(top_k);
+}
+
+/**
+ * @brief Counts @p weight events for @p path.
+ *
+ * @details
+ * The path's candidate, if any, is refreshed in place. Otherwise it
+ * replaces the least busy candidate once its estimate exceeds it.
+ *
+ * @param path File the events concern.
+ * @param weight Number of events.
+ */
+void ChurnStats::record(std::string_view path, std::uint32_t weight)
+{
+    const std::uint64_t hash = path_hash(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    advance();
+
+    std::uint32_t *slice = slice_counts.data() +
+                           static_cast<std::size_t>(current % static_cast<std::int64_t>(slices)) *
+                               depth * width;
+    for (std::size_t row = 0; row < depth; ++row)
+    {
+        const std::size_t i = row * width + column(hash, row);
+        slice[i] += weight;
+        window_counts[i] += weight;
+    }
+    slice_totals[static_cast<std::size_t>(current % static_cast<std::int64_t>(slices))] += weight;
+    window_total += weight;
+
+    const std::uint64_t count = estimate_hash(hash);
+    auto order = [](const Candidate &a, const Candidate &b) { return a.count > b.count; };
+    for (std::size_t i = 0; i < heap.size(); ++i)
+    {
+        if (heap[i].hash == hash && heap[i].path == path)
+        {
+            heap[i].count = count;
+            std::make_heap(heap.begin(), heap.end(), order);
+            return;
+        }
+    }
+
+    if (heap.size() < top_k)
+    {
+        heap.push_back(Candidate{hash, count, std::string(path)});
+        std::push_heap(heap.begin(), heap.end(), order);
+    }
+    else if (count > heap.front().count)
+    {
+        std::pop_heap(heap.begin(), heap.end(), order);
+        Candidate &slot = heap.back();
+        slot.hash = hash;
+        slot.count = count;
+        slot.path.assign(path);
+        std::push_heap(heap.begin(), heap.end(), order);
+    }
+}
+
+/**
+ * @brief Estimated events for @p path within the window.
+ *
+ * @param path File to look up.
+ * @return Upper-bound estimate of its events.
+ */
+std::uint64_t ChurnStats::estimate(std::string_view path)
+{
+    const std::uint64_t hash = path_hash(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    advance();
+    return estimate_hash(hash);
+}
+
+/**
+ * @brief Current heavy hitters, busiest first.
+ *
+ * @return Up to @c top_k entries with a non-zero count.
+ */
+std::vector<ChurnStats::Entry> ChurnStats::top()
+{
+    std::vector<Entry> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        advance();
+        result.reserve(heap.size());
+        for (const auto &c : heap)
+        {
+            if (c.count > 0)
+                result.push_back(Entry{c.path, c.count});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const Entry &a, const Entry &b) {
+        return a.count != b.count ? a.count > b.count : a.path < b.path;
+    });
+    return result;
+}
+
+/**
+ * @brief Total events recorded within the window.
+ *
+ * @return Exact event count.
+ */
+std::uint64_t ChurnStats::total()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    advance();
+    return window_total;
+}
+
+/**
+ * @brief Forgets every count.
+ */
+void ChurnStats::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fill(slice_counts.begin(), slice_counts.end(), 0);
+    std::fill(window_counts.begin(), window_counts.end(), 0);
+    std::fill(slice_totals.begin(), slice_totals.end(), 0);
+    window_total = 0;
+    heap.clear();
+}
+
+/**
+ * @brief Retires slices that fell out of the window.
+ *
+ * @details
+ * Each retired slice is subtracted from the window sketch and cleared for
+ * reuse. Afterwards the candidates are re-estimated, since their counts
+ * can only have dropped.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+void ChurnStats::advance()
+{
+    const std::int64_t now = Clock::now().time_since_epoch() / slice_length;
+    if (now <= current)
+        return;
+
+    const std::int64_t ring = static_cast<std::int64_t>(slices);
+    if (now - current >= ring)
+    {
+        std::fill(slice_counts.begin(), slice_counts.end(), 0);
+        std::fill(window_counts.begin(), window_counts.end(), 0);
+        std::fill(slice_totals.begin(), slice_totals.end(), 0);
+        window_total = 0;
+    }
+    else
+    {
+        for (std::int64_t s = current + 1; s <= now; ++s)
+        {
+            const std::size_t index = static_cast<std::size_t>(s % ring);
+            std::uint32_t *slice = slice_counts.data() + index * depth * width;
+            for (std::size_t i = 0; i < depth * width; ++i)
+            {
+                window_counts[i] -= slice[i];
+            }
+            std::fill(slice, slice + depth * width, 0);
+            window_total -= slice_totals[index];
+            slice_totals[index] = 0;
+        }
+    }
+    current = now;
+
+    for (auto &c : heap)
+    {
+        c.count = estimate_hash(c.hash);
+    }
+    std::make_heap(heap.begin(), heap.end(),
+                   [](const Candidate &a, const Candidate &b) { return a.count > b.count; });
+}
+
+/**
+ * @brief Window estimate for a path hash.
+ *
+ * @param hash Hash of the path.
+ * @return Smallest counter across the rows.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+std::uint64_t ChurnStats::estimate_hash(std::uint64_t hash) const
+{
+    std::uint32_t count = window_counts[column(hash, 0)];
+    for (std::size_t row = 1; row < depth; ++row)
+    {
+        count = std::min(count, window_counts[row * width + column(hash, row)]);
+    }
+    return count;
+}
+
+/**
+ * @brief Counter index in row @p row for @p hash.
+ *
+ * @details
+ * Rows use double hashing (Kirsch-Mitzenmacher) over the two halves of
+ * the 64-bit hash, so one hash of the path serves every row.
+ *
+ * @param hash Hash of the path.
+ * @param row Sketch row.
+ * @return Column within the row.
+ */
+std::size_t ChurnStats::column(std::uint64_t hash, std::size_t row) const
+{
+    const std::uint64_t h1 = hash & 0xFFFFFFFFULL;
+    const std::uint64_t h2 = (hash >> 32) | 1;
+    return static_cast<std::size_t>((h1 + row * h2) & (width - 1));
+}
@@ -0,0 +1,152 @@
+/**
+ * @file churnstats.hpp
+ * @brief Fixed-memory statistics of which files change most often.
+ *
+ * @details
+ * ChurnStats counts events per path with a count-min sketch split into
+ * time slices. The slices form a ring covering a sliding window: the
+ * oldest slice is subtracted from a running window sketch and cleared
+ * as time advances, so the counts always cover the last window and
+ * nothing grows with the number of distinct paths. A small min-heap of
+ * candidates tracks the current heavy hitters.
+ *
+ * Estimates never undercount. They overcount by at most a small fraction
+ * of the window's total events, which shrinks as the sketch widens.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef CHURNSTATS_HPP
+#define CHURNSTATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @struct ChurnOptions
+ * @brief Sizing of a ChurnStats instance.
+ */
+struct ChurnOptions
+{
+    std::size_t width = 2048;                ///< Counters per sketch row (rounded up to a power of two).
+    std::size_t depth = 4;                   ///< Sketch rows (independent hashes).
+    std::size_t top_k = 16;                  ///< Heavy hitters tracked.
+    std::chrono::milliseconds window{60000}; ///< Length of the sliding window.
+    std::size_t slices = 6;                  ///< Time slices the window is split into.
+};
+
+/**
+ * @class ChurnStats
+ * @brief Sliding-window count-min sketch with top-K heavy hitters.
+ *
+ * @details
+ * Memory is allocated once in the constructor: @c slices + 1 sketches of
+ * @c depth by @c width 32-bit counters, plus @c top_k candidate paths.
+ * All methods are thread-safe; record() takes one short lock.
+ */
+class ChurnStats
+{
+public:
+    /**
+     * @brief A heavy hitter reported by top().
+     */
+    struct Entry
+    {
+        std::string path;    ///< File path as recorded.
+        std::uint64_t count; ///< Estimated events within the window.
+    };
+
+    /**
+     * @brief Allocates the sketch.
+     *
+     * @param options Sizing; zero values are raised to one.
+     */
+    explicit ChurnStats(const ChurnOptions &options = {});
+
+    ChurnStats(const ChurnStats &) = delete;
+    ChurnStats &operator=(const ChurnStats &) = delete;
+
+    /**
+     * @brief Counts @p weight events for @p path.
+     *
+     * @param path File the events concern.
+     * @param weight Number of events.
+     */
+    void record(std::string_view path, std::uint32_t weight = 1);
+
+    /**
+     * @brief Estimated events for @p path within the window.
+     */
+    std::uint64_t estimate(std::string_view path);
+
+    /**
+     * @brief Current heavy hitters, busiest first.
+     *
+     * @return Up to @c top_k entries with a non-zero count.
+     */
+    std::vector<Entry> top();
+
+    /**
+     * @brief Total events recorded within the window.
+     */
+    std::uint64_t total();
+
+    /**
+     * @brief Forgets every count.
+     */
+    void reset();
+
+private:
+    /**
+     * @brief A heavy-hitter candidate.
+     */
+    struct Candidate
+    {
+        std::uint64_t hash = 0;  ///< Hash of @ref path.
+        std::uint64_t count = 0; ///< Estimate when last refreshed.
+        std::string path;        ///< The path itself.
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Retires slices that fell out of the window.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void advance();
+
+    /**
+     * @brief Window estimate for a path hash.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    std::uint64_t estimate_hash(std::uint64_t hash) const;
+
+    /**
+     * @brief Counter index in row @p row for @p hash.
+     */
+    std::size_t column(std::uint64_t hash, std::size_t row) const;
+
+    const std::size_t width;                 ///< Counters per row.
+    const std::size_t depth;                 ///< Rows per sketch.
+    const std::size_t top_k;                 ///< Candidate capacity.
+    const std::size_t slices;                ///< Slices in the ring.
+    const Clock::duration slice_length;      ///< Time covered by one slice.
+    std::mutex mutex;                        ///< Guards everything below.
+    std::vector<std::uint32_t> slice_counts; ///< @c slices sketches, one per slice.
+    std::vector<std::uint32_t> window_counts; ///< Sum of all slice sketches.
+    std::vector<std::uint64_t> slice_totals; ///< Events per slice.
+    std::uint64_t window_total = 0;          ///< Events in the window.
+    std::int64_t current = 0;                ///< Absolute index of the current slice.
+    std::vector<Candidate> heap;             ///< Min-heap of candidates by count.
+};
+
+#endif // CHURNSTATS_HPP
@@ -0,0 +1,275 @@
+/**
+ * @file contentloader.cpp
+ * @brief Implementation file for the torn-read-safe content loader.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "contentloader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    /**
+     * @brief Closes a descriptor when it goes out of scope.
+     */
+    struct FdGuard
+    {
+        int fd;
+        ~FdGuard()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    };
+
+    /**
+     * @brief Reads exactly @p size bytes and checks that nothing follows.
+     *
+     * @return true if the file held exactly @p size bytes during the read.
+     */
+    bool read_exact(int fd, std::vector<char> &out, std::size_t size)
+    {
+        // One spare byte detects a file that grew since it was stat'ed.
+        out.resize(size + 1);
+        std::size_t done = 0;
+        while (done < out.size())
+        {
+            ssize_t n = ::pread(fd, out.data() + done, out.size() - done,
+                                static_cast<off_t>(done));
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            if (n == 0)
+                break;
+            done += static_cast<std::size_t>(n);
+        }
+        out.resize(std::min(done, out.size()));
+        return done == size;
+    }
+
+    /**
+     * @brief Makes one read attempt.
+     *
+     * @param path Path to the file.
+     * @param settle Minimum age of the last write; 0 disables the check.
+     * @return The contents, or std::nullopt if the file changed meanwhile
+     *         or could not be read.
+     */
+    std::optional<FileContent> try_load(const std::string &path, std::chrono::milliseconds settle)
+    {
+        FdGuard file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (file.fd < 0)
+        {
+            return std::nullopt;
+        }
+
+        auto before = FileFingerprint::capture(file.fd);
+        if (!before)
+        {
+            return std::nullopt;
+        }
+        if (settle.count() > 0)
+        {
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch());
+            // ctime also covers truncation, which not every filesystem
+            // reflects in mtime.
+            std::int64_t last = std::max(before->mtime_ns, before->ctime_ns);
+            if (now.count() - last < std::chrono::nanoseconds(settle).count())
+            {
+                return std::nullopt;
+            }
+        }
+
+        BufferPool &pool = BufferPool::instance();
+        auto buffer = pool.acquire(before->size + 1);
+        bool complete = read_exact(file.fd, *buffer, before->size);
+
+        auto after = FileFingerprint::capture(file.fd);
+        auto current = FileFingerprint::capture(path);
+        if (!complete || !after || !current || *after != *before || *current != *before)
+        {
+            pool.recycle(std::move(buffer));
+            return std::nullopt;
+        }
+        return FileContent{pool.share(std::move(buffer)), *before};
+    }
+}
+
+/**
+ * @brief Returns the process-wide pool.
+ *
+ * @details
+ * Never destroyed, so buffers released during program exit still have a
+ * pool to return to.
+ *
+ * @return Reference to the singleton instance.
+ */
+BufferPool &BufferPool::instance()
+{
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+}
+
+/**
+ * @brief Takes a buffer from the pool, or allocates one.
+ *
+ * @details
+ * Prefers the smallest idle buffer that is already large enough.
+ *
+ * @param capacity Bytes the caller expects to store.
+ * @return An empty buffer.
+ */
+std::unique_ptr<std::vector<char>> BufferPool::acquire(std::size_t capacity)
+{
+    std::unique_ptr<std::vector<char>> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto best = free_list.end();
+        for (auto it = free_list.begin(); it != free_list.end(); ++it)
+        {
+            if ((*it)->capacity() >= capacity &&
+                (best == free_list.end() || (*it)->capacity() < (*best)->capacity()))
+            {
+                best = it;
+            }
+        }
+        if (best == free_list.end() && !free_list.empty())
+        {
+            best = free_list.begin();
+        }
+        if (best != free_list.end())
+        {
+            buffer = std::move(*best);
+            free_list.erase(best);
+        }
+    }
+
+    if (!buffer)
+    {
+        buffer = std::make_unique<std::vector<char>>();
+    }
+    buffer->clear();
+    buffer->reserve(capacity);
+    return buffer;
+}
+
+/**
+ * @brief Wraps a filled buffer so it returns to the pool when released.
+ *
+ * @param buffer Buffer obtained from acquire().
+ * @return Shared, immutable view of the buffer.
+ */
+ContentBuffer BufferPool::share(std::unique_ptr<std::vector<char>> buffer)
+{
+    return ContentBuffer(buffer.release(), [](const std::vector<char> *p) {
+        BufferPool::instance().recycle(
+            std::unique_ptr<std::vector<char>>(const_cast<std::vector<char> *>(p)));
+    });
+}
+
+/**
+ * @brief Gives a buffer back, or frees it if the pool is full.
+ *
+ * @param buffer Buffer obtained from acquire().
+ */
+void BufferPool::recycle(std::unique_ptr<std::vector<char>> buffer)
+{
+    if (!buffer || buffer->capacity() > MAX_RETAINED_BYTES)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_list.size() < MAX_IDLE)
+    {
+        free_list.push_back(std::move(buffer));
+    }
+}
+
+/**
+ * @brief Number of idle buffers currently held.
+ *
+ * @return Idle buffer count.
+ */
+std::size_t BufferPool::idle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return free_list.size();
+}
+
+/**
+ * @brief Reads a file, retrying until no concurrent write is observed.
+ *
+ * @param path Path to the file.
+ * @param options Retry policy.
+ * @return The contents and matching fingerprint, or std::nullopt.
+ */
+std::optional<FileContent> load_file(const std::string &path, const LoadOptions &options)
+{
+    std::chrono::milliseconds backoff = options.initial_backoff;
+    for (int attempt = 0; attempt < options.max_attempts; ++attempt)
+    {
+        if (attempt > 0)
+        {
+            std::this_thread::sleep_for(backoff);
+            backoff = std::min(backoff * 2, options.max_backoff);
+        }
+        if (auto content = try_load(path, options.settle))
+        {
+            return content;
+        }
+        if (!FileFingerprint::capture(path))
+        {
+            return std::nullopt; // gone, not merely busy
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Sets the file to load and forgets any cached contents.
+ *
+ * @param path Path to the file.
+ */
+void SharedContent::set_path(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    file_name = path;
+    cached = false;
+    content.reset();
+}
+
+/**
+ * @brief Returns the contents for the change @p token belongs to.
+ *
+ * @details
+ * A failed load is cached as well, so subscribers of one change agree on
+ * whether the file was readable.
+ *
+ * @param token Token passed to the subscriber.
+ * @param options Retry policy for the first load of the generation.
+ * @return The shared contents, or std::nullopt.
+ */
+std::optional<FileContent> SharedContent::get(const CancelToken &token, const LoadOptions &options)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cached || generation != token.generation())
+    {
+        content = file_name.empty() ? std::nullopt : load_file(file_name, options);
+        generation = token.generation();
+        cached = true;
+    }
+    return content;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file contentloader.hpp
+ * @brief Reads a file's contents without observing a partial write.
+ *
+ * @details
+ * A callback that reads a file right after a change is confirmed can still
+ * race a writer that paused mid-write. The loader brackets every read with
+ * two FileFingerprint captures of the open descriptor plus one of the path,
+ * and only accepts the bytes if all three agree: the inode was not written
+ * to during the read and the path still names it. Otherwise it backs off
+ * and tries again.
+ *
+ * A writer that pauses between two write() calls leaves a consistent but
+ * incomplete file that no fingerprint can tell apart from a finished one.
+ * For such writers LoadOptions::settle additionally rejects files modified
+ * more recently than the given age; the debounce that precedes callbacks
+ * usually makes this unnecessary.
+ *
+ * Buffers come from a small process-wide pool and are handed out as
+ * immutable, reference-counted blocks; when the last reference goes away
+ * the storage returns to the pool for the next load.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef CONTENTLOADER_HPP
+#define CONTENTLOADER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "canceltoken.hpp"
+#include "fingerprint.hpp"
+
+/// Immutable file contents shared between readers.
+using ContentBuffer = std::shared_ptr<const std::vector<char>>;
+
+/**
+ * @struct FileContent
+ * @brief Contents of a file together with the version they belong to.
+ */
+struct FileContent
+{
+    ContentBuffer data;          ///< The bytes read; never null.
+    FileFingerprint fingerprint; ///< File state the bytes correspond to.
+
+    /**
+     * @brief The contents as a string view.
+     */
+    std::string_view view() const { return std::string_view(data->data(), data->size()); }
+};
+
+/**
+ * @struct LoadOptions
+ * @brief Retry policy for load_file().
+ */
+struct LoadOptions
+{
+    int max_attempts = 8;                          ///< Reads tried before giving up.
+    std::chrono::milliseconds initial_backoff{1};  ///< Wait after the first mismatch.
+    std::chrono::milliseconds max_backoff{200};    ///< Cap for the doubling wait.
+    std::chrono::milliseconds settle{0};           ///< Minimum age of the last write.
+};
+
+/**
+ * @class BufferPool
+ * @brief Recycles read buffers between loads.
+ *
+ * @details
+ * Holds a few idle buffers so steady-state reloads of the same file do not
+ * allocate. Buffers larger than the retention limit are freed instead of
+ * pooled.
+ */
+class BufferPool
+{
+public:
+    /**
+     * @brief Returns the process-wide pool.
+     */
+    static BufferPool &instance();
+
+    /**
+     * @brief Takes a buffer with room for at least @p capacity bytes.
+     *
+     * @param capacity Bytes the caller expects to store.
+     * @return An empty buffer.
+     */
+    std::unique_ptr<std::vector<char>> acquire(std::size_t capacity);
+
+    /**
+     * @brief Wraps a filled buffer so it returns to the pool when released.
+     *
+     * @param buffer Buffer obtained from acquire().
+     * @return Shared, immutable view of the buffer.
+     */
+    ContentBuffer share(std::unique_ptr<std::vector<char>> buffer);
+
+    /**
+     * @brief Gives an unused buffer back.
+     *
+     * @param buffer Buffer obtained from acquire().
+     */
+    void recycle(std::unique_ptr<std::vector<char>> buffer);
+
+    /**
+     * @brief Number of idle buffers currently held.
+     */
+    std::size_t idle();
+
+private:
+    BufferPool() = default;
+
+    /// Idle buffers kept at most.
+    static constexpr std::size_t MAX_IDLE = 8;
+    /// Buffers with more capacity than this are not kept.
+    static constexpr std::size_t MAX_RETAINED_BYTES = 16 * 1024 * 1024;
+
+    std::mutex mutex;                                     ///< Guards @ref free_list.
+    std::vector<std::unique_ptr<std::vector<char>>> free_list; ///< Idle buffers.
+};
+
+/**
+ * @brief Reads a file, retrying until no concurrent write is observed.
+ *
+ * @details
+ * Between attempts the wait doubles from @c initial_backoff up to
+ * @c max_backoff. A file that is missing, or still being modified after
+ * @c max_attempts reads, yields std::nullopt.
+ *
+ * @param path Path to the file.
+ * @param options Retry policy.
+ * @return The contents and matching fingerprint, or std::nullopt.
+ */
+std::optional<FileContent> load_file(const std::string &path, const LoadOptions &options = {});
+
+/**
+ * @class SharedContent
+ * @brief Loads a watched file at most once per confirmed change.
+ *
+ * @details
+ * Each Watch owns one, and every content subscriber of every handle
+ * attached to it asks it for the file. The first request for a change
+ * generation reads the file
+ * with load_file(); later requests for that generation get the same
+ * immutable buffer, so the I/O per change does not depend on the number
+ * of subscribers.
+ */
+class SharedContent
+{
+public:
+    /**
+     * @brief Sets the file to load and forgets any cached contents.
+     *
+     * @param path Path to the file.
+     */
+    void set_path(const std::string &path);
+
+    /**
+     * @brief Returns the contents for the change @p token belongs to.
+     *
+     * @param token Token passed to the subscriber.
+     * @param options Retry policy for the first load of the generation.
+     * @return The shared contents, or std::nullopt if the file could not
+     *         be read consistently.
+     */
+    std::optional<FileContent> get(const CancelToken &token, const LoadOptions &options = {});
+
+private:
+    std::mutex mutex;                   ///< Guards the members below.
+    std::string file_name;              ///< File to load.
+    bool cached = false;                ///< Whether @ref content is for @ref generation.
+    std::uint64_t generation = 0;       ///< Generation of the cached contents.
+    std::optional<FileContent> content; ///< Cached result, possibly empty.
+};
+
+#endif // CONTENTLOADER_HPP
@@ -0,0 +1,304 @@
+/**
+ * @file fanotifyengine.cpp
+ * @brief Implementation file for FanotifyEngine.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "fanotifyengine.hpp"
+
+#include <cerrno>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/fanotify.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+namespace
+{
+    /// Events that can indicate a change to a file on a marked file system.
+    constexpr std::uint64_t MARK_MASK = FAN_MODIFY | FAN_CLOSE_WRITE | FAN_ATTRIB |
+                                        FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM |
+                                        FAN_MOVED_TO;
+
+    /**
+     * @brief Packs the two words of a file system id into one.
+     */
+    std::uint64_t pack_fsid(const int val[2])
+    {
+        return static_cast<std::uint32_t>(val[0]) |
+               static_cast<std::uint64_t>(static_cast<std::uint32_t>(val[1])) << 32;
+    }
+
+    /**
+     * @brief Builds the route key for an entry of a directory.
+     *
+     * @details
+     * add() and the reader build keys the same way, from the file system
+     * id, the directory's file handle and the entry name.
+     *
+     * @param key Receives the key; its storage is reused.
+     * @param fsid File system id.
+     * @param handle Handle of the parent directory.
+     * @param name Entry name.
+     */
+    void make_key(std::string &key, std::uint64_t fsid, const struct file_handle *handle,
+                  const char *name)
+    {
+        key.assign(reinterpret_cast<const char *>(&fsid), sizeof(fsid));
+        key.append(reinterpret_cast<const char *>(&handle->handle_type),
+                   sizeof(handle->handle_type));
+        key.append(reinterpret_cast<const char *>(handle->f_handle), handle->handle_bytes);
+        key.append(1, '/').append(name);
+    }
+}
+
+/**
+ * @brief Returns the process-wide engine.
+ *
+ * @details
+ * Never destroyed, like InotifyEngine, so watches with static storage
+ * duration can unregister during program exit.
+ *
+ * @return Reference to the singleton instance.
+ */
+FanotifyEngine &FanotifyEngine::instance()
+{
+    static FanotifyEngine *engine = new FanotifyEngine();
+    return *engine;
+}
+
+/**
+ * @brief Creates the fanotify instance and starts the reader.
+ *
+ * @details
+ * Runs once, on the first add(). Without CAP_SYS_ADMIN or on a kernel
+ * without directory file handle reporting, fd stays -1 and every add()
+ * fails.
+ */
+void FanotifyEngine::start()
+{
+    fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_REPORT_DFID_NAME,
+                       O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        reader = std::thread(&FanotifyEngine::reader_loop, this);
+    }
+}
+
+/**
+ * @brief Registers interest in a file.
+ *
+ * @param path Path to the file; symlinks are resolved.
+ * @param notify Function invoked on every event naming the file.
+ * @return Token for remove(), or 0 on failure.
+ */
+FanotifyEngine::Token FanotifyEngine::add(const std::string &path, std::function<void()> notify)
+{
+    std::error_code ec;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(path, ec);
+    if (ec || !resolved.has_filename())
+    {
+        return 0;
+    }
+
+    std::call_once(started, &FanotifyEngine::start, this);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    const std::string dir = resolved.parent_path().string();
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0)
+    {
+        return 0;
+    }
+
+    struct statfs st;
+    alignas(struct file_handle) char storage[sizeof(struct file_handle) + MAX_HANDLE_SZ];
+    auto *handle = reinterpret_cast<struct file_handle *>(storage);
+    handle->handle_bytes = MAX_HANDLE_SZ;
+    int mount_id = 0;
+    if (::fstatfs(dir_fd, &st) != 0 ||
+        ::name_to_handle_at(dir_fd, "", handle, &mount_id, AT_EMPTY_PATH) != 0)
+    {
+        ::close(dir_fd);
+        return 0;
+    }
+    const std::uint64_t fsid = pack_fsid(st.f_fsid.__val);
+
+    std::string key;
+    make_key(key, fsid, handle, resolved.filename().c_str());
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    FsMark &mark = marks[fsid];
+    if (mark.refs == 0)
+    {
+        if (fanotify_mark(fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, MARK_MASK, dir_fd, nullptr) != 0)
+        {
+            marks.erase(fsid);
+            ::close(dir_fd);
+            return 0;
+        }
+        // Kept so the mark can be removed even if the path goes away.
+        mark.dir_fd = dir_fd;
+    }
+    else
+    {
+        ::close(dir_fd);
+    }
+    ++mark.refs;
+
+    Token token = next_token.fetch_add(1) + 1;
+    routes[key].push_back(Route{token, std::move(notify)});
+    tokens[token] = std::make_pair(std::move(key), fsid);
+    return token;
+}
+
+/**
+ * @brief Drops a registration.
+ *
+ * @param token Token returned by add().
+ */
+void FanotifyEngine::remove(Token token)
+{
+    if (token == 0)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto *entry = tokens.find(token);
+    if (!entry)
+    {
+        return;
+    }
+    std::string key = std::move(entry->first);
+    const std::uint64_t fsid = entry->second;
+    tokens.erase(token);
+
+    if (auto *targets = routes.find(key))
+    {
+        for (auto it = targets->begin(); it != targets->end(); ++it)
+        {
+            if (it->token == token)
+            {
+                targets->erase(it);
+                break;
+            }
+        }
+        if (targets->empty())
+        {
+            routes.erase(key);
+        }
+    }
+
+    if (auto *mark = marks.find(fsid))
+    {
+        if (--mark->refs == 0)
+        {
+            fanotify_mark(fd, FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM, MARK_MASK,
+                          mark->dir_fd, nullptr);
+            ::close(mark->dir_fd);
+            marks.erase(fsid);
+        }
+    }
+}
+
+/**
+ * @brief Number of registered (directory, name) routes.
+ *
+ * @return Count of distinct routes.
+ */
+std::size_t FanotifyEngine::route_count()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return routes.size();
+}
+
+/**
+ * @brief Reads and routes events until the descriptor fails.
+ */
+void FanotifyEngine::reader_loop()
+{
+    alignas(struct fanotify_event_metadata) char buffer[64 * 1024];
+
+    while (true)
+    {
+        ssize_t len = ::read(fd, buffer, sizeof(buffer));
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        route_events(buffer, static_cast<std::size_t>(len));
+    }
+}
+
+/**
+ * @brief Routes one buffer of raw fanotify events to their targets.
+ *
+ * @details
+ * Each event carries one or more directory-and-name records; the event
+ * is routed once per record.
+ *
+ * @param buffer Start of the events.
+ * @param length Number of valid bytes.
+ */
+void FanotifyEngine::route_events(const char *buffer, std::size_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Reuse one key so routing does not allocate per event.
+    std::string key;
+    auto remaining = static_cast<ssize_t>(length);
+    for (auto *ev = reinterpret_cast<const struct fanotify_event_metadata *>(buffer);
+         FAN_EVENT_OK(ev, remaining); ev = FAN_EVENT_NEXT(ev, remaining))
+    {
+        if (ev->fd >= 0)
+        {
+            ::close(ev->fd);
+        }
+        if (ev->mask & FAN_Q_OVERFLOW)
+        {
+            // Events were lost; wake everyone and let them re-check.
+            routes.for_each([](const std::string &, std::vector<Route> &targets) {
+                for (const auto &route : targets)
+                {
+                    route.notify();
+                }
+            });
+            continue;
+        }
+
+        const char *base = reinterpret_cast<const char *>(ev);
+        std::size_t off = ev->metadata_len;
+        while (off + sizeof(struct fanotify_event_info_header) <= ev->event_len)
+        {
+            const auto *info = reinterpret_cast<const struct fanotify_event_info_fid *>(base + off);
+            if (info->hdr.len == 0)
+                break;
+            off += info->hdr.len;
+            if (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+                continue;
+
+            const auto *handle = reinterpret_cast<const struct file_handle *>(info->handle);
+            const char *name =
+                reinterpret_cast<const char *>(handle->f_handle) + handle->handle_bytes;
+            make_key(key, pack_fsid(info->fsid.val), handle, name);
+            if (auto *targets = routes.find(key))
+            {
+                for (const auto &route : *targets)
+                {
+                    route.notify();
+                }
+            }
+        }
+    }
+}
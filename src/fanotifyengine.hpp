@@ -0,0 +1,133 @@
+/**
+ * @file fanotifyengine.hpp
+ * @brief Change notification through fanotify filesystem marks.
+ *
+ * @details
+ * inotify needs one watch per directory and stops accepting them at
+ * fs.inotify.max_user_watches. A fanotify filesystem mark covers a whole
+ * file system with one mark, so it keeps working when the inotify limit
+ * is exhausted. Events are reported with the parent directory's file
+ * handle and the entry name (FAN_REPORT_DFID_NAME), and are routed to the
+ * registered files through a FlatHashMap keyed by file system id,
+ * directory handle and name.
+ *
+ * Marking a file system requires CAP_SYS_ADMIN and Linux 5.9 or later;
+ * without them add() fails and callers fall back to polling.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef FANOTIFYENGINE_HPP
+#define FANOTIFYENGINE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "flathashmap.hpp"
+
+/**
+ * @class FanotifyEngine
+ * @brief Process-wide fanotify instance that wakes watches on change.
+ *
+ * @details
+ * Like InotifyEngine, the notification function runs on the reader
+ * thread and should only wake its owner.
+ */
+class FanotifyEngine
+{
+public:
+    /// Handle returned by add() and accepted by remove().
+    using Token = std::uint64_t;
+
+    /**
+     * @brief Returns the process-wide engine.
+     */
+    static FanotifyEngine &instance();
+
+    /**
+     * @brief Registers interest in a file.
+     *
+     * @details
+     * The file system holding the file is marked on first use and
+     * unmarked when its last registration goes away.
+     *
+     * @param path Path to the file; symlinks are resolved.
+     * @param notify Function invoked on every event naming the file.
+     * @return Token for remove(), or 0 if fanotify is unavailable, not
+     *         permitted, or the file system cannot report file handles.
+     */
+    Token add(const std::string &path, std::function<void()> notify);
+
+    /**
+     * @brief Drops a registration made with add().
+     *
+     * @details
+     * After remove() returns, @p notify is not called again.
+     *
+     * @param token Token returned by add().
+     */
+    void remove(Token token);
+
+    /**
+     * @brief Number of (directory, name) routes currently registered.
+     */
+    std::size_t route_count();
+
+private:
+    /**
+     * @brief A registered notification target.
+     */
+    struct Route
+    {
+        Token token;                 ///< Registration handle.
+        std::function<void()> notify; ///< Wake-up function.
+    };
+
+    /**
+     * @brief Reference-counted mark on one file system.
+     */
+    struct FsMark
+    {
+        int dir_fd = -1;      ///< Directory descriptor used to add and remove the mark.
+        std::size_t refs = 0; ///< Routes on this file system.
+    };
+
+    FanotifyEngine() = default;
+
+    /**
+     * @brief Creates the fanotify instance and starts the reader.
+     */
+    void start();
+
+    /**
+     * @brief Reader thread body; blocks on the descriptor.
+     */
+    void reader_loop();
+
+    /**
+     * @brief Routes one buffer of raw fanotify events.
+     *
+     * @param buffer Start of the events.
+     * @param length Number of valid bytes.
+     */
+    void route_events(const char *buffer, std::size_t length);
+
+    std::once_flag started;                 ///< Guards start().
+    int fd = -1;                            ///< fanotify descriptor, -1 if unavailable.
+    std::thread reader;                     ///< Reader thread.
+    std::mutex mutex;                       ///< Guards the tables below.
+    FlatHashMap<std::string, std::vector<Route>> routes; ///< Fsid, handle and name to targets.
+    FlatHashMap<std::uint64_t, FsMark> marks;            ///< Fsid to filesystem mark.
+    FlatHashMap<Token, std::pair<std::string, std::uint64_t>> tokens; ///< Token to key and fsid.
+    std::atomic<Token> next_token{0};       ///< Source of tokens.
+};
+
+#endif // FANOTIFYENGINE_HPP
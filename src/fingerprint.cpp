@@ -0,0 +1,99 @@
+/**
+ * @file fingerprint.cpp
+ * @brief Implementation file for FileFingerprint.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "fingerprint.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+namespace
+{
+    /// Fields a fingerprint needs from statx().
+    constexpr unsigned STATX_FIELDS = STATX_INO | STATX_SIZE | STATX_MTIME | STATX_CTIME;
+
+    /**
+     * @brief Converts a statx timestamp to nanoseconds.
+     */
+    std::int64_t to_ns(const struct statx_timestamp &ts)
+    {
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    /**
+     * @brief Converts a stat timestamp to nanoseconds.
+     */
+    std::int64_t to_ns(const struct timespec &ts)
+    {
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    /**
+     * @brief Runs statx() on (dirfd, path), falling back to fstatat().
+     *
+     * @details
+     * The fallback covers kernels older than 4.11, where statx() returns
+     * ENOSYS.
+     */
+    std::optional<FileFingerprint> capture_at(int dirfd, const char *path, int flags)
+    {
+        struct statx stx;
+        if (::statx(dirfd, path, flags, STATX_FIELDS, &stx) == 0)
+        {
+            FileFingerprint fp;
+            fp.dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+            fp.ino = stx.stx_ino;
+            fp.size = stx.stx_size;
+            fp.mtime_ns = to_ns(stx.stx_mtime);
+            fp.ctime_ns = to_ns(stx.stx_ctime);
+            return fp;
+        }
+        if (errno != ENOSYS)
+        {
+            return std::nullopt;
+        }
+
+        struct stat st;
+        if (::fstatat(dirfd, path, &st, flags) != 0)
+        {
+            return std::nullopt;
+        }
+        FileFingerprint fp;
+        fp.dev = st.st_dev;
+        fp.ino = st.st_ino;
+        fp.size = static_cast<std::uint64_t>(st.st_size);
+        fp.mtime_ns = to_ns(st.st_mtim);
+        fp.ctime_ns = to_ns(st.st_ctim);
+        return fp;
+    }
+}
+
+/**
+ * @brief Captures the fingerprint of a path.
+ *
+ * @param path Path to the file.
+ * @return The fingerprint, or std::nullopt on failure.
+ */
+std::optional<FileFingerprint> FileFingerprint::capture(const std::string &path)
+{
+    return capture_at(AT_FDCWD, path.c_str(), 0);
+}
+
+/**
+ * @brief Captures the fingerprint of an open file.
+ *
+ * @param fd Open file descriptor.
+ * @return The fingerprint, or std::nullopt on failure.
+ */
+std::optional<FileFingerprint> FileFingerprint::capture(int fd)
+{
+    return capture_at(fd, "", AT_EMPTY_PATH);
+}
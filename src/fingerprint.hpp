@@ -0,0 +1,64 @@
+/**
+ * @file fingerprint.hpp
+ * @brief Cheap identity-plus-version snapshot of a file's metadata.
+ *
+ * @details
+ * A FileFingerprint combines the file's device, inode, size and
+ * modification/change times as reported by statx(). Two equal
+ * fingerprints taken around an operation mean the file was neither
+ * replaced nor written to in between, which is what the speculative and
+ * torn-read-safe loaders rely on.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef FINGERPRINT_HPP
+#define FINGERPRINT_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/**
+ * @struct FileFingerprint
+ * @brief Metadata snapshot used to detect concurrent modification.
+ */
+struct FileFingerprint
+{
+    std::uint64_t dev = 0;      ///< Device containing the file.
+    std::uint64_t ino = 0;      ///< Inode number.
+    std::uint64_t size = 0;     ///< Size in bytes.
+    std::int64_t mtime_ns = 0;  ///< Last data modification, ns since epoch.
+    std::int64_t ctime_ns = 0;  ///< Last status change, ns since epoch.
+
+    /**
+     * @brief Captures the fingerprint of @p path, following symlinks.
+     *
+     * @param path Path to the file.
+     * @return The fingerprint, or std::nullopt if the file cannot be stat'ed.
+     */
+    static std::optional<FileFingerprint> capture(const std::string &path);
+
+    /**
+     * @brief Captures the fingerprint of an open file.
+     *
+     * @param fd Open file descriptor.
+     * @return The fingerprint, or std::nullopt on failure.
+     */
+    static std::optional<FileFingerprint> capture(int fd);
+
+    bool operator==(const FileFingerprint &other) const
+    {
+        return dev == other.dev && ino == other.ino && size == other.size &&
+               mtime_ns == other.mtime_ns && ctime_ns == other.ctime_ns;
+    }
+
+    bool operator!=(const FileFingerprint &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+#endif // FINGERPRINT_HPP
@@ -0,0 +1,357 @@
+/**
+ * @file flathashmap.hpp
+ * @brief Flat open-addressing hash map used for watch indexes.
+ *
+ * @details
+ * Keys and values live in one contiguous slot array with a parallel array
+ * of one-byte control words. A control byte is either EMPTY, DELETED, or
+ * the low seven bits of the key's hash, so most mismatching slots are
+ * rejected without touching the key. Erased slots become tombstones and
+ * are reclaimed on the next rehash.
+ *
+ * Probing works on groups of 16 control bytes at a time (Swiss-table
+ * style): one SSE2 compare yields a bitmask of candidate slots in the
+ * group, and a group containing an EMPTY byte ends the probe. Targets
+ * without SSE2 (e.g. ARM) use an equivalent 64-bit SWAR comparison.
+ *
+ * Both arrays come from PageAllocator, so large tables can be backed by
+ * huge pages and placed on the NUMA node of the thread that probes them.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef FLATHASHMAP_HPP
+#define FLATHASHMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "pagealloc.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Finalizes a 64-bit hash (splitmix64 mixer).
+ *
+ * @param x Value to mix.
+ * @return Well-distributed 64-bit hash.
+ */
+constexpr std::uint64_t mix_hash(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * @brief Bitmask matching over one group of 16 control bytes.
+ *
+ * @details
+ * Bit @c i of every returned mask corresponds to byte @c i of the group.
+ */
+struct ControlGroup
+{
+    static constexpr std::size_t WIDTH = 16; ///< Control bytes per group.
+
+#if defined(__SSE2__)
+    /**
+     * @brief Loads a group starting at @p ctrl.
+     */
+    explicit ControlGroup(const std::uint8_t *ctrl)
+        : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl)))
+    {
+    }
+
+    /**
+     * @brief Mask of bytes equal to @p value.
+     */
+    std::uint32_t match(std::uint8_t value) const
+    {
+        __m128i pattern = _mm_set1_epi8(static_cast<char>(value));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern)));
+    }
+
+    /**
+     * @brief Mask of bytes with the high bit set (EMPTY or DELETED).
+     */
+    std::uint32_t match_free() const
+    {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+    }
+
+private:
+    __m128i bytes; ///< The 16 control bytes.
+#else
+    explicit ControlGroup(const std::uint8_t *ctrl)
+    {
+        std::memcpy(words, ctrl, sizeof(words));
+    }
+
+    std::uint32_t match(std::uint8_t value) const
+    {
+        const std::uint64_t pattern = 0x0101010101010101ULL * value;
+        return compress(zero_bytes(words[0] ^ pattern)) |
+               (compress(zero_bytes(words[1] ^ pattern)) << 8);
+    }
+
+    std::uint32_t match_free() const
+    {
+        return compress(words[0] & HIGH) | (compress(words[1] & HIGH) << 8);
+    }
+
+private:
+    static constexpr std::uint64_t HIGH = 0x8080808080808080ULL;
+    static constexpr std::uint64_t LOW7 = 0x7F7F7F7F7F7F7F7FULL;
+
+    /// Exact per-byte zero test; sets the high bit of each zero byte.
+    static std::uint64_t zero_bytes(std::uint64_t x)
+    {
+        return ~(((x & LOW7) + LOW7) | x | LOW7);
+    }
+
+    /// Gathers the high bit of each byte into an 8-bit mask.
+    static std::uint32_t compress(std::uint64_t high_bits)
+    {
+        return static_cast<std::uint32_t>(((high_bits >> 7) * 0x0102040810204080ULL) >> 56);
+    }
+
+    std::uint64_t words[2]; ///< The 16 control bytes, little-endian.
+#endif
+};
+
+/**
+ * @class FlatHashMap
+ * @brief Open-addressing hash map with one control byte per slot.
+ *
+ * @tparam Key Key type; must be default constructible.
+ * @tparam Value Mapped type; must be default constructible.
+ * @tparam Hash Hash functor for @p Key.
+ * @tparam KeyEqual Equality functor for @p Key.
+ *
+ * @note Not thread-safe; callers provide their own locking.
+ */
+template <typename Key, typename Value,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap
+{
+public:
+    /**
+     * @brief Constructs an empty map.
+     *
+     * @param initial_capacity Number of slots to reserve up front.
+     * @param numa_node Node the table's memory should live on, or -1 for
+     *        the node of the thread that grows it (see PageAllocator).
+     */
+    explicit FlatHashMap(std::size_t initial_capacity = 16, int numa_node = -1)
+        : ctrl(PageAllocator<std::uint8_t>(numa_node)),
+          slots(PageAllocator<value_type>(numa_node))
+    {
+        allocate(round_up(initial_capacity));
+    }
+
+    /**
+     * @brief Looks up a key.
+     *
+     * @param key Key to find.
+     * @return Pointer to the mapped value, or nullptr if absent.
+     */
+    Value *find(const Key &key)
+    {
+        std::size_t idx = locate(key);
+        return idx == npos ? nullptr : &slots[idx].second;
+    }
+
+    /// @copydoc find(const Key &)
+    const Value *find(const Key &key) const
+    {
+        std::size_t idx = locate(key);
+        return idx == npos ? nullptr : &slots[idx].second;
+    }
+
+    /**
+     * @brief Returns the value for @p key, inserting a default one if absent.
+     *
+     * @param key Key to look up or insert.
+     * @return Reference to the mapped value.
+     */
+    Value &operator[](const Key &key)
+    {
+        std::size_t idx = locate(key);
+        if (idx != npos)
+            return slots[idx].second;
+        return slots[insert_new(key)].second;
+    }
+
+    /**
+     * @brief Removes a key.
+     *
+     * @param key Key to remove.
+     * @return true if the key was present.
+     */
+    bool erase(const Key &key)
+    {
+        std::size_t idx = locate(key);
+        if (idx == npos)
+            return false;
+        ctrl[idx] = DELETED;
+        slots[idx] = value_type();
+        --count;
+        ++tombstones;
+        return true;
+    }
+
+    /**
+     * @brief Calls @p fn for every stored key/value pair.
+     *
+     * @param fn Functor taking (const Key &, Value &).
+     */
+    template <typename Fn>
+    void for_each(Fn &&fn)
+    {
+        for (std::size_t i = 0; i < ctrl.size(); ++i)
+        {
+            if (is_full(ctrl[i]))
+                fn(slots[i].first, slots[i].second);
+        }
+    }
+
+    /**
+     * @brief Removes every entry.
+     */
+    void clear()
+    {
+        allocate(ctrl.size());
+    }
+
+    /**
+     * @brief Number of stored entries.
+     */
+    std::size_t size() const { return count; }
+
+    /**
+     * @brief Checks whether the map is empty.
+     */
+    bool empty() const { return count == 0; }
+
+private:
+    using value_type = std::pair<Key, Value>;
+    using ctrl_array = std::vector<std::uint8_t, PageAllocator<std::uint8_t>>;
+    using slot_array = std::vector<value_type, PageAllocator<value_type>>;
+
+    static constexpr std::uint8_t EMPTY = 0x80;   ///< Slot never used.
+    static constexpr std::uint8_t DELETED = 0xFE; ///< Slot freed by erase().
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    static bool is_full(std::uint8_t c) { return (c & 0x80) == 0; }
+
+    static std::size_t round_up(std::size_t n)
+    {
+        std::size_t cap = 16;
+        while (cap < n)
+            cap <<= 1;
+        return cap;
+    }
+
+    std::uint64_t hash_of(const Key &key) const
+    {
+        return mix_hash(static_cast<std::uint64_t>(hasher(key)));
+    }
+
+    std::size_t locate(const Key &key) const
+    {
+        const std::uint64_t h = hash_of(key);
+        const std::uint8_t tag = static_cast<std::uint8_t>(h & 0x7F);
+        const std::size_t group_mask = ctrl.size() / ControlGroup::WIDTH - 1;
+        std::size_t group = (h >> 7) & group_mask;
+        for (std::size_t probe = 0; probe <= group_mask; ++probe)
+        {
+            const std::size_t base = group * ControlGroup::WIDTH;
+            ControlGroup g(&ctrl[base]);
+            for (std::uint32_t bits = g.match(tag); bits; bits &= bits - 1)
+            {
+                std::size_t i = base + static_cast<std::size_t>(__builtin_ctz(bits));
+                if (equal(slots[i].first, key))
+                    return i;
+            }
+            if (g.match(EMPTY))
+                return npos;
+            // Triangular probing visits every group when the count is a power of two.
+            group = (group + probe + 1) & group_mask;
+        }
+        return npos;
+    }
+
+    std::size_t insert_new(const Key &key)
+    {
+        // Keep (live + tombstone) occupancy under 7/8 so probes stay short.
+        if ((count + tombstones + 1) * 8 > ctrl.size() * 7)
+            rehash(count * 2 + 2 > ctrl.size() ? ctrl.size() * 2 : ctrl.size());
+
+        const std::uint64_t h = hash_of(key);
+        const std::size_t group_mask = ctrl.size() / ControlGroup::WIDTH - 1;
+        std::size_t group = (h >> 7) & group_mask;
+        std::size_t i = 0;
+        for (std::size_t probe = 0;; ++probe)
+        {
+            const std::size_t base = group * ControlGroup::WIDTH;
+            std::uint32_t free_bits = ControlGroup(&ctrl[base]).match_free();
+            if (free_bits)
+            {
+                i = base + static_cast<std::size_t>(__builtin_ctz(free_bits));
+                break;
+            }
+            group = (group + probe + 1) & group_mask;
+        }
+        if (ctrl[i] == DELETED)
+            --tombstones;
+        ctrl[i] = static_cast<std::uint8_t>(h & 0x7F);
+        slots[i].first = key;
+        ++count;
+        return i;
+    }
+
+    void allocate(std::size_t capacity)
+    {
+        ctrl.assign(capacity, EMPTY);
+        slots.clear();
+        slots.resize(capacity);
+        count = 0;
+        tombstones = 0;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        ctrl_array old_ctrl = std::move(ctrl);
+        slot_array old_slots = std::move(slots);
+        allocate(capacity);
+        for (std::size_t i = 0; i < old_ctrl.size(); ++i)
+        {
+            if (is_full(old_ctrl[i]))
+            {
+                std::size_t idx = insert_new(old_slots[i].first);
+                slots[idx].second = std::move(old_slots[i].second);
+            }
+        }
+    }
+
+    ctrl_array ctrl;                ///< Control byte per slot.
+    slot_array slots;               ///< Key/value storage.
+    std::size_t count = 0;          ///< Live entries.
+    std::size_t tombstones = 0;     ///< DELETED control bytes.
+    Hash hasher;                    ///< Key hash functor.
+    KeyEqual equal;                 ///< Key equality functor.
+};
+
+#endif // FLATHASHMAP_HPP
@@ -0,0 +1,318 @@
+/**
+ * @file fsprobe.cpp
+ * @brief Implementation file for the file system probe.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "fsprobe.hpp"
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/vfs.h>
+
+#include "flathashmap.hpp"
+
+namespace
+{
+    /**
+     * @enum FsClass
+     * @brief How changes on a file system can be observed.
+     */
+    enum class FsClass
+    {
+        LOCAL,  ///< Every write goes through this kernel; events are complete.
+        REMOTE, ///< Other hosts or a user space server can write.
+        PSEUDO  ///< Synthesized contents; no events at all.
+    };
+
+    /**
+     * @struct KnownFs
+     * @brief One entry of the magic number table.
+     */
+    struct KnownFs
+    {
+        std::uint32_t magic; ///< statfs() f_type.
+        const char *name;    ///< Type name used when mountinfo has no match.
+        FsClass kind;        ///< Classification.
+    };
+
+    /// File systems recognized by magic number (see statfs(2)).
+    constexpr KnownFs KNOWN[] = {
+        {0xEF53, "ext4", FsClass::LOCAL},
+        {0x58465342, "xfs", FsClass::LOCAL},
+        {0x9123683E, "btrfs", FsClass::LOCAL},
+        {0x01021994, "tmpfs", FsClass::LOCAL},
+        {0x858458F6, "ramfs", FsClass::LOCAL},
+        {0xF2F52010, "f2fs", FsClass::LOCAL},
+        {0x2FC12FC1, "zfs", FsClass::LOCAL},
+        {0xCA451A4E, "bcachefs", FsClass::LOCAL},
+        {0x794C7630, "overlay", FsClass::LOCAL},
+        {0x3153464A, "jfs", FsClass::LOCAL},
+        {0x52654973, "reiserfs", FsClass::LOCAL},
+        {0x4D44, "vfat", FsClass::LOCAL},
+        {0x2011BAB0, "exfat", FsClass::LOCAL},
+        {0x5346544E, "ntfs", FsClass::LOCAL},
+        {0x73717368, "squashfs", FsClass::LOCAL},
+        {0xE0F5E1E2, "erofs", FsClass::LOCAL},
+        {0x9660, "iso9660", FsClass::LOCAL},
+        {0x6969, "nfs", FsClass::REMOTE},
+        {0x517B, "smb", FsClass::REMOTE},
+        {0xFF534D42, "cifs", FsClass::REMOTE},
+        {0xFE534D42, "smb2", FsClass::REMOTE},
+        {0x01021997, "9p", FsClass::REMOTE},
+        {0x00C36400, "ceph", FsClass::REMOTE},
+        {0x6B414653, "afs", FsClass::REMOTE},
+        {0x5346414F, "afs", FsClass::REMOTE},
+        {0x01161970, "gfs2", FsClass::REMOTE},
+        {0x7461636F, "ocfs2", FsClass::REMOTE},
+        {0x0BD00BD0, "lustre", FsClass::REMOTE},
+        {0x47504653, "gpfs", FsClass::REMOTE},
+        {0x65735546, "fuse", FsClass::REMOTE},
+        {0x786F4256, "vboxsf", FsClass::REMOTE},
+        {0x20030528, "orangefs", FsClass::REMOTE},
+        {0x73757245, "coda", FsClass::REMOTE},
+        {0x9FA0, "proc", FsClass::PSEUDO},
+        {0x62656572, "sysfs", FsClass::PSEUDO},
+        {0x63677270, "cgroup2", FsClass::PSEUDO},
+        {0x0027E0EB, "cgroup", FsClass::PSEUDO},
+        {0x64626720, "debugfs", FsClass::PSEUDO},
+        {0x74726163, "tracefs", FsClass::PSEUDO},
+        {0x62656570, "configfs", FsClass::PSEUDO},
+        {0x73636673, "securityfs", FsClass::PSEUDO},
+        {0xCAFE4A11, "bpf", FsClass::PSEUDO},
+        {0xDE5E81E4, "efivarfs", FsClass::PSEUDO},
+        {0x6165676C, "pstore", FsClass::PSEUDO},
+    };
+
+    constexpr std::uint32_t NFS_MAGIC = 0x6969;
+    constexpr std::uint32_t SMB_MAGIC = 0x517B;
+    constexpr std::uint32_t CIFS_MAGIC = 0xFF534D42;
+    constexpr std::uint32_t SMB2_MAGIC = 0xFE534D42;
+
+    /**
+     * @struct ProbeCache
+     * @brief Classifications already made, by device.
+     */
+    struct ProbeCache
+    {
+        std::mutex mutex;                                ///< Guards @ref entries.
+        FlatHashMap<std::uint64_t, FilesystemInfo> entries; ///< st_dev to result.
+    };
+
+    /**
+     * @brief Returns the process-wide cache; never destroyed.
+     */
+    ProbeCache &probe_cache()
+    {
+        static ProbeCache *cache = new ProbeCache();
+        return *cache;
+    }
+
+    /**
+     * @brief Undoes the octal escapes mountinfo uses for blanks and backslashes.
+     */
+    std::string unescape(const std::string &field)
+    {
+        std::string out;
+        out.reserve(field.size());
+        for (std::size_t i = 0; i < field.size(); ++i)
+        {
+            if (field[i] == '\\' && i + 3 < field.size())
+            {
+                out += static_cast<char>(std::strtol(field.substr(i + 1, 3).c_str(), nullptr, 8));
+                i += 3;
+            }
+            else
+            {
+                out += field[i];
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief Fills type, source, mount point and options from mountinfo.
+     *
+     * @details
+     * Each line reads "id parent major:minor root mount_point options
+     * [optional fields] - type source super_options". Of the mounts of
+     * @p dev, the one with the longest mount point that prefixes @p path
+     * wins, i.e. the mount the path is actually reached through.
+     *
+     * @return true if a mount of @p dev was found.
+     */
+    bool read_mountinfo(dev_t dev, const std::string &path, FilesystemInfo &info)
+    {
+        std::ifstream mountinfo("/proc/self/mountinfo");
+        const std::string wanted = std::to_string(major(dev)) + ":" + std::to_string(minor(dev));
+
+        bool found = false;
+        std::size_t best = 0;
+        std::string line;
+        while (std::getline(mountinfo, line))
+        {
+            std::istringstream fields(line);
+            std::string id, parent, devno, root, mount_point, options, field;
+            if (!(fields >> id >> parent >> devno >> root >> mount_point >> options) ||
+                devno != wanted)
+            {
+                continue;
+            }
+            while (fields >> field && field != "-")
+            {
+            }
+            std::string type, source, super_options;
+            if (!(fields >> type >> source >> super_options))
+            {
+                continue;
+            }
+
+            mount_point = unescape(mount_point);
+            const bool prefix = path.compare(0, mount_point.size(), mount_point) == 0;
+            const std::size_t score = prefix ? mount_point.size() + 1 : 0;
+            if (found && score <= best)
+            {
+                continue;
+            }
+            found = true;
+            best = score;
+            info.type = type;
+            info.source = unescape(source);
+            info.mount_point = mount_point;
+            info.options = options + "," + super_options;
+        }
+        return found;
+    }
+
+    /**
+     * @brief Whether the comma separated @p options contain @p name.
+     */
+    bool has_option(const std::string &options, const std::string &name)
+    {
+        return ("," + options + ",").find("," + name + ",") != std::string::npos;
+    }
+
+    /**
+     * @brief Numeric value of "name=value" in @p options.
+     *
+     * @return The value, or std::nullopt if absent.
+     */
+    std::optional<long> option_value(const std::string &options, const std::string &name)
+    {
+        const std::string padded = "," + options;
+        const std::size_t at = padded.find("," + name + "=");
+        if (at == std::string::npos)
+        {
+            return std::nullopt;
+        }
+        return std::strtol(padded.c_str() + at + name.size() + 2, nullptr, 10);
+    }
+
+    /**
+     * @brief Attribute cache lifetime of a remote mount.
+     *
+     * @details
+     * NFS caches regular file attributes for acregmin seconds (3 by
+     * default) and not at all with noac; CIFS for actimeo seconds (1 by
+     * default). Other remote types are given one second.
+     */
+    std::chrono::milliseconds attribute_cache(std::uint32_t magic, const std::string &options)
+    {
+        using std::chrono::seconds;
+        if (magic == NFS_MAGIC)
+        {
+            if (has_option(options, "noac"))
+                return std::chrono::milliseconds(0);
+            if (auto value = option_value(options, "acregmin"))
+                return seconds(*value);
+            if (auto value = option_value(options, "actimeo"))
+                return seconds(*value);
+            return seconds(3);
+        }
+        if (magic == SMB_MAGIC || magic == CIFS_MAGIC || magic == SMB2_MAGIC)
+        {
+            if (auto value = option_value(options, "actimeo"))
+                return seconds(*value);
+            return seconds(1);
+        }
+        return seconds(1);
+    }
+}
+
+/**
+ * @brief Classifies the file system holding @p path.
+ *
+ * @details
+ * The cached result for a device is reused while the magic number still
+ * matches, so a device number recycled by another mount is probed again.
+ *
+ * @param path Any path on the file system; symlinks are followed.
+ * @return The classification, or std::nullopt if @p path cannot be stat'ed.
+ */
+std::optional<FilesystemInfo> probe_filesystem(const std::string &path)
+{
+    struct stat st;
+    struct statfs sfs;
+    if (::stat(path.c_str(), &st) != 0 || ::statfs(path.c_str(), &sfs) != 0)
+    {
+        return std::nullopt;
+    }
+    const auto magic = static_cast<std::uint32_t>(sfs.f_type);
+
+    ProbeCache &cache = probe_cache();
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        if (const FilesystemInfo *known = cache.entries.find(st.st_dev))
+        {
+            if (known->magic == magic)
+                return *known;
+        }
+    }
+
+    FilesystemInfo info;
+    info.magic = magic;
+    FsClass kind = FsClass::LOCAL;
+    bool recognized = false;
+    for (const KnownFs &fs : KNOWN)
+    {
+        if (fs.magic == magic)
+        {
+            info.type = fs.name;
+            kind = fs.kind;
+            recognized = true;
+            break;
+        }
+    }
+
+    char resolved[PATH_MAX];
+    const std::string where = ::realpath(path.c_str(), resolved) ? resolved : path;
+    read_mountinfo(st.st_dev, where, info);
+
+    if (!recognized &&
+        (info.type.compare(0, 4, "fuse") == 0 ||
+         info.source.find(":/") != std::string::npos ||
+         info.source.compare(0, 2, "//") == 0))
+    {
+        kind = FsClass::REMOTE;
+    }
+
+    info.remote = kind == FsClass::REMOTE;
+    info.events = kind == FsClass::LOCAL;
+    if (info.remote)
+    {
+        info.min_interval = attribute_cache(magic, info.options);
+    }
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.entries[st.st_dev] = info;
+    return info;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file fsprobe.hpp
+ * @brief Classifies the file system holding a path for backend selection.
+ *
+ * @details
+ * inotify and fanotify only see writes made through the local kernel. On
+ * NFS, CIFS/SMB, 9p, cluster file systems and FUSE, another host (or the
+ * FUSE server) can change a file without a single event, so a watch there
+ * has to poll; on ext4, xfs, btrfs and tmpfs it never should. Pseudo file
+ * systems such as proc and sysfs generate no events either.
+ *
+ * probe_filesystem() reads the statfs() magic number and, from
+ * /proc/self/mountinfo, the type, source and options of the mount. For
+ * remote file systems it also derives the attribute cache lifetime from
+ * the options (actimeo, acregmin, noac): polling more often than that only
+ * re-reads cached attributes, so it is the useful floor for the interval.
+ *
+ * Results are cached per device, so probing a million watches on a few
+ * mounts reads mountinfo a few times.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef FSPROBE_HPP
+#define FSPROBE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/**
+ * @struct FilesystemInfo
+ * @brief What is known about the file system holding a watched file.
+ */
+struct FilesystemInfo
+{
+    std::uint64_t magic = 0;    ///< statfs() f_type.
+    std::string type;           ///< Type name, e.g. "ext4", "nfs4", "fuse.sshfs".
+    std::string source;         ///< Mount source, e.g. "/dev/sda1" or "server:/export".
+    std::string mount_point;    ///< Where the file system is mounted.
+    std::string options;        ///< Mount and super block options, comma separated.
+    bool remote = false;        ///< Files can change on another host.
+    bool events = true;         ///< Local change events see every write.
+    std::chrono::milliseconds min_interval{0}; ///< Attribute cache lifetime; 0 if uncached.
+};
+
+/**
+ * @brief Classifies the file system holding @p path.
+ *
+ * @details
+ * Types that are not recognized count as local unless the mount looks
+ * remote (a FUSE type, or a "host:" or "//host" source).
+ *
+ * @param path Any path on the file system; symlinks are followed.
+ * @return The classification, or std::nullopt if @p path cannot be stat'ed.
+ */
+std::optional<FilesystemInfo> probe_filesystem(const std::string &path);
+
+#endif // FSPROBE_HPP
@@ -0,0 +1,781 @@
+/**
+ * @file inotifyengine.cpp
+ * @brief Implementation file for InotifyEngine.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "inotifyengine.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "churnstats.hpp"
+#include "pagealloc.hpp"
+
+namespace
+{
+    /// Events that can indicate a change to a file inside a watched directory,
+    /// plus the directory itself being renamed away.
+    constexpr std::uint32_t WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                                         IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                         IN_MOVED_TO | IN_MOVE_SELF;
+}
+
+/**
+ * @brief Returns the process-wide engine.
+ *
+ * @details
+ * Like the watch registry, the engine is never destroyed so watches with
+ * static storage duration can unregister during program exit.
+ *
+ * @return Reference to the singleton instance.
+ */
+InotifyEngine &InotifyEngine::instance()
+{
+    static InotifyEngine *engine = new InotifyEngine();
+    return *engine;
+}
+
+/**
+ * @brief Sets the shard layout before first use.
+ *
+ * @param shards Number of inotify instances (clamped to 1..256).
+ * @param pin_readers Pin each reader thread to a core.
+ * @return true if applied, false if shards already exist.
+ */
+bool InotifyEngine::configure(std::size_t shards, bool pin_readers)
+{
+    std::lock_guard<std::mutex> lock(config_mutex);
+    if (in_use)
+    {
+        return false;
+    }
+    configured_shards = std::clamp<std::size_t>(shards, 1, std::size_t{1} << SHARD_BITS);
+    pin = pin_readers;
+    return true;
+}
+
+/**
+ * @brief Number of shards.
+ *
+ * @return Shards in use, or the configured count before first use.
+ */
+std::size_t InotifyEngine::shard_count()
+{
+    std::lock_guard<std::mutex> lock(config_mutex);
+    return in_use ? shards.size() : configured_shards;
+}
+
+/**
+ * @brief Creates every shard and starts its reader thread.
+ *
+ * @details
+ * Runs once, on the first add(). A shard whose inotify instance cannot be
+ * created keeps fd == -1 and rejects registrations. The tables of a pinned
+ * shard are homed on its reader's NUMA node.
+ */
+void InotifyEngine::start_shards()
+{
+    std::lock_guard<std::mutex> lock(config_mutex);
+    in_use = true;
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < configured_shards; ++i)
+    {
+        auto shard = std::make_unique<Shard>(pin ? numa_node_of_cpu(i % cores) : -1);
+        shard->index = i;
+        shard->fd = inotify_init1(IN_CLOEXEC);
+        if (shard->fd >= 0)
+        {
+            shard->reader = std::thread(&InotifyEngine::reader_loop, this, std::ref(*shard));
+            if (pin)
+            {
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(i % cores, &cpus);
+                pthread_setaffinity_np(shard->reader.native_handle(), sizeof(cpus), &cpus);
+            }
+        }
+        shards.push_back(std::move(shard));
+    }
+}
+
+/**
+ * @brief Registers interest in a file.
+ *
+ * @details
+ * The file's directory picks the shard, so every file in one directory
+ * shares that directory's single inotify watch.
+ *
+ * @param path Path to the file; symlinks are resolved.
+ * @param notify Function invoked on every event naming the file.
+ * @return Token for remove(), or 0 on failure.
+ */
+InotifyEngine::Token InotifyEngine::add(const std::string &path, std::function<void()> notify)
+{
+    std::error_code ec;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(path, ec);
+    if (ec || !resolved.has_filename())
+    {
+        return 0;
+    }
+    std::string dir = resolved.parent_path().string();
+    std::string name = resolved.filename().string();
+
+    std::call_once(started, &InotifyEngine::start_shards, this);
+
+    Shard &shard = *shards[mix_hash(std::hash<std::string>()(dir)) % shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const int wd = acquire_dir(shard, dir);
+    if (wd < 0)
+    {
+        return 0;
+    }
+
+    Token token = ((next_token.fetch_add(1) + 1) << SHARD_BITS) | shard.index;
+    RouteKey key{wd, std::move(name)};
+    shard.routes[key].push_back(Route{token, std::move(notify)});
+    shard.tokens[token] = std::make_pair(std::move(key), std::move(dir));
+    return token;
+}
+
+/**
+ * @brief Registers interest in every entry of a directory.
+ *
+ * @details
+ * The directory is hashed to a shard exactly like the files inside it,
+ * so both kinds of registration share one inotify watch. The token maps
+ * to a route key with an empty name, which no file route can have.
+ *
+ * @param dir Path to the directory; symlinks are resolved.
+ * @param notify Function invoked with the entry name.
+ * @return Token for remove(), or 0 on failure.
+ */
+InotifyEngine::Token InotifyEngine::add_directory(const std::string &dir,
+                                                  std::function<void(std::string_view)> notify)
+{
+    std::error_code ec;
+    std::string resolved = std::filesystem::weakly_canonical(dir, ec).string();
+    if (ec || resolved.empty())
+    {
+        return 0;
+    }
+
+    std::call_once(started, &InotifyEngine::start_shards, this);
+
+    Shard &shard = *shards[mix_hash(std::hash<std::string>()(resolved)) % shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const int wd = acquire_dir(shard, resolved);
+    if (wd < 0)
+    {
+        return 0;
+    }
+
+    Token token = ((next_token.fetch_add(1) + 1) << SHARD_BITS) | shard.index;
+    shard.dir_routes[wd].push_back(DirRoute{token, std::move(notify)});
+    shard.tokens[token] = std::make_pair(RouteKey{wd, std::string()}, std::move(resolved));
+    return token;
+}
+
+/**
+ * @brief Adds a reference to the watch on @p dir.
+ *
+ * @param shard Shard owning the directory.
+ * @param dir Resolved directory path.
+ * @return The watch descriptor, or -1 on failure.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+int InotifyEngine::acquire_dir(Shard &shard, const std::string &dir)
+{
+    const int wd = hold_dir(shard, dir);
+    if (wd < 0)
+    {
+        return -1;
+    }
+    DirWatch &dw = *shard.dirs.find(wd);
+
+    if (Detached *orphans = shard.detached.find(dir))
+    {
+        Detached moved = std::move(*orphans);
+        shard.detached.erase(dir);
+        for (auto &entry : moved.files)
+        {
+            shard.tokens.find(entry.second.token)->first.wd = wd;
+            entry.second.notify();
+            shard.routes[RouteKey{wd, std::move(entry.first)}].push_back(std::move(entry.second));
+            ++dw.refs;
+        }
+        for (auto &route : moved.dirs)
+        {
+            shard.tokens.find(route.token)->first.wd = wd;
+            route.notify(std::string_view());
+            shard.dir_routes[wd].push_back(std::move(route));
+            ++dw.refs;
+        }
+        disarm(shard, dir, moved.sentinel);
+    }
+    return wd;
+}
+
+/**
+ * @brief Adds a kernel watch on a directory, or a reference to it.
+ *
+ * @param shard Shard owning the directory.
+ * @param dir Directory path.
+ * @return The watch descriptor, or -1 on failure.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+int InotifyEngine::hold_dir(Shard &shard, const std::string &dir)
+{
+    if (shard.fd < 0)
+    {
+        return -1;
+    }
+
+    // The kernel returns the existing descriptor for a directory it already
+    // watches, whichever path reaches it, so references are counted per wd.
+    const int wd = inotify_add_watch(shard.fd, dir.c_str(), WATCH_MASK);
+    if (wd < 0)
+    {
+        return -1;
+    }
+    DirWatch &dw = shard.dirs[wd];
+    if (dw.refs == 0)
+    {
+        dw.path = dir;
+    }
+    ++dw.refs;
+    return wd;
+}
+
+/**
+ * @brief Drops a reference to a directory watch.
+ *
+ * @param shard Shard owning the watch.
+ * @param wd Watch descriptor.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+void InotifyEngine::release_dir(Shard &shard, int wd)
+{
+    if (auto *dw = shard.dirs.find(wd))
+    {
+        if (--dw->refs == 0)
+        {
+            inotify_rm_watch(shard.fd, wd);
+            shard.dirs.erase(wd);
+        }
+    }
+}
+
+/**
+ * @brief Re-attaches a detached directory, or waits for it to be created.
+ *
+ * @details
+ * The sentinel holds a reference on the ancestor's watch like any
+ * registration, so it shares the watch with files registered there. If
+ * the missing entry appeared before the sentinel was in place no event
+ * will report it, so it is checked for once the watch exists. A path that
+ * exists but cannot be watched (permissions, watch limit) is left
+ * detached.
+ *
+ * @param shard Shard owning the detached registrations.
+ * @param dir Detached directory path; must have no sentinel.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+void InotifyEngine::rearm(Shard &shard, const std::string &dir)
+{
+    // acquire_dir() re-attaches everything parked under dir; drop the
+    // reference it takes for a registration of its own.
+    const int wd = acquire_dir(shard, dir);
+    if (wd >= 0)
+    {
+        release_dir(shard, wd);
+        return;
+    }
+
+    std::filesystem::path below(dir);
+    while (errno == ENOENT && below.has_relative_path())
+    {
+        const std::filesystem::path above = below.parent_path();
+        const int parent = hold_dir(shard, above.string());
+        if (parent < 0)
+        {
+            below = above;
+            continue;
+        }
+        std::string name = below.filename().string();
+        shard.detached.find(dir)->sentinel = parent;
+        shard.awaiting[parent].push_back(Awaited{name, dir});
+
+        std::error_code ec;
+        if (std::filesystem::exists(below, ec))
+        {
+            advance(shard, parent, name);
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Drops the sentinel of a detached directory.
+ *
+ * @param shard Shard owning the detached registrations.
+ * @param dir Detached directory path.
+ * @param sentinel Its ancestor watch, or -1 for none.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+void InotifyEngine::disarm(Shard &shard, const std::string &dir, int sentinel)
+{
+    if (sentinel < 0)
+    {
+        return;
+    }
+    if (auto *waiting = shard.awaiting.find(sentinel))
+    {
+        for (auto it = waiting->begin(); it != waiting->end(); ++it)
+        {
+            if (it->dir == dir)
+            {
+                waiting->erase(it);
+                break;
+            }
+        }
+        if (waiting->empty())
+        {
+            shard.awaiting.erase(sentinel);
+        }
+    }
+    release_dir(shard, sentinel);
+}
+
+/**
+ * @brief Re-arms the directories waiting on an ancestor for an entry.
+ *
+ * @details
+ * Each is re-armed before its reference on @p wd is dropped, so a
+ * directory still missing a level further down keeps the ancestor's
+ * watch instead of removing and adding it again.
+ *
+ * @param shard Shard owning the watch.
+ * @param wd Ancestor watch descriptor.
+ * @param name Entry created in the ancestor; empty for every waiting directory.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+void InotifyEngine::advance(Shard &shard, int wd, std::string_view name)
+{
+    auto *waiting = shard.awaiting.find(wd);
+    if (!waiting)
+    {
+        return;
+    }
+    std::vector<std::string> ready;
+    for (auto it = waiting->begin(); it != waiting->end();)
+    {
+        if (name.empty() || it->name == name)
+        {
+            ready.push_back(std::move(it->dir));
+            it = waiting->erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (waiting->empty())
+    {
+        shard.awaiting.erase(wd);
+    }
+
+    for (const auto &dir : ready)
+    {
+        if (Detached *orphans = shard.detached.find(dir))
+        {
+            orphans->sentinel = -1;
+            rearm(shard, dir);
+        }
+        release_dir(shard, wd);
+    }
+}
+
+/**
+ * @brief Moves every registration under a dropped watch to the detached table.
+ *
+ * @details
+ * The watch is gone from the kernel, so its descriptor is purged from
+ * every table; a later watch may reuse the number. Each registration is
+ * filed under its own directory path, so a registration made through
+ * another path to the same directory is re-attached by that path.
+ *
+ * @param shard Shard owning the watch.
+ * @param wd Descriptor the kernel dropped.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+void InotifyEngine::detach_dir(Shard &shard, int wd)
+{
+    if (!shard.dirs.find(wd))
+    {
+        // Already released by remove().
+        return;
+    }
+
+    auto park = [&shard](Token token) -> Detached & {
+        auto *entry = shard.tokens.find(token);
+        entry->first.wd = -1;
+        return shard.detached[entry->second];
+    };
+
+    std::vector<std::string> names;
+    shard.routes.for_each([&](const RouteKey &key, std::vector<Route> &) {
+        if (key.wd == wd)
+        {
+            names.push_back(key.name);
+        }
+    });
+    RouteKey key{wd, std::string()};
+    for (auto &name : names)
+    {
+        key.name = std::move(name);
+        for (auto &route : *shard.routes.find(key))
+        {
+            park(route.token).files.emplace_back(key.name, std::move(route));
+        }
+        shard.routes.erase(key);
+    }
+    if (auto *targets = shard.dir_routes.find(wd))
+    {
+        for (auto &route : *targets)
+        {
+            park(route.token).dirs.push_back(std::move(route));
+        }
+        shard.dir_routes.erase(wd);
+    }
+    if (auto *waiting = shard.awaiting.find(wd))
+    {
+        // Sentinels on this watch are gone with it.
+        for (const auto &entry : *waiting)
+        {
+            if (Detached *orphans = shard.detached.find(entry.dir))
+            {
+                orphans->sentinel = -1;
+            }
+        }
+        shard.awaiting.erase(wd);
+    }
+    shard.dirs.erase(wd);
+
+    std::vector<std::string> unarmed;
+    shard.detached.for_each([&unarmed](const std::string &dir, Detached &orphans) {
+        if (orphans.sentinel < 0)
+        {
+            unarmed.push_back(dir);
+        }
+    });
+    for (const auto &dir : unarmed)
+    {
+        rearm(shard, dir);
+    }
+}
+
+/**
+ * @brief Drops a registration.
+ *
+ * @param token Token returned by add().
+ */
+void InotifyEngine::remove(Token token)
+{
+    const std::size_t index = token & ((Token{1} << SHARD_BITS) - 1);
+    if (token == 0 || index >= shards.size())
+    {
+        return;
+    }
+    Shard &shard = *shards[index];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto *entry = shard.tokens.find(token);
+    if (!entry)
+    {
+        return;
+    }
+    RouteKey key = std::move(entry->first);
+    std::string dir = std::move(entry->second);
+    shard.tokens.erase(token);
+
+    if (key.wd < 0)
+    {
+        // Detached: the kernel watch is already gone.
+        if (auto *orphans = shard.detached.find(dir))
+        {
+            auto &files = orphans->files;
+            for (auto it = files.begin(); it != files.end(); ++it)
+            {
+                if (it->second.token == token)
+                {
+                    files.erase(it);
+                    break;
+                }
+            }
+            auto &dirs = orphans->dirs;
+            for (auto it = dirs.begin(); it != dirs.end(); ++it)
+            {
+                if (it->token == token)
+                {
+                    dirs.erase(it);
+                    break;
+                }
+            }
+            if (files.empty() && dirs.empty())
+            {
+                disarm(shard, dir, orphans->sentinel);
+                shard.detached.erase(dir);
+            }
+        }
+        return;
+    }
+
+    if (key.name.empty())
+    {
+        if (auto *targets = shard.dir_routes.find(key.wd))
+        {
+            for (auto it = targets->begin(); it != targets->end(); ++it)
+            {
+                if (it->token == token)
+                {
+                    targets->erase(it);
+                    break;
+                }
+            }
+            if (targets->empty())
+            {
+                shard.dir_routes.erase(key.wd);
+            }
+        }
+    }
+    else if (auto *targets = shard.routes.find(key))
+    {
+        for (auto it = targets->begin(); it != targets->end(); ++it)
+        {
+            if (it->token == token)
+            {
+                targets->erase(it);
+                break;
+            }
+        }
+        if (targets->empty())
+        {
+            shard.routes.erase(key);
+        }
+    }
+
+    release_dir(shard, key.wd);
+}
+
+/**
+ * @brief Whether a registration still has a live directory watch.
+ *
+ * @param token Token returned by add() or add_directory().
+ * @return false if @p token is detached or unknown.
+ */
+bool InotifyEngine::attached(Token token)
+{
+    const std::size_t index = token & ((Token{1} << SHARD_BITS) - 1);
+    if (token == 0 || index >= shards.size())
+    {
+        return false;
+    }
+    Shard &shard = *shards[index];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto *entry = shard.tokens.find(token);
+    return entry && entry->first.wd >= 0;
+}
+
+/**
+ * @brief Number of registered (directory, name) routes.
+ *
+ * @return Count of distinct routes across all shards.
+ */
+std::size_t InotifyEngine::route_count()
+{
+    {
+        std::lock_guard<std::mutex> lock(config_mutex);
+        if (!in_use)
+        {
+            return 0;
+        }
+    }
+
+    std::size_t total = 0;
+    for (auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->routes.size();
+    }
+    return total;
+}
+
+/**
+ * @brief Counts every event the engine reads into @p stats.
+ *
+ * @param stats Statistics to feed, or nullptr to stop counting.
+ */
+void InotifyEngine::set_churn_stats(std::shared_ptr<ChurnStats> stats)
+{
+    std::atomic_store(&churn, std::move(stats));
+}
+
+/**
+ * @brief Reads and routes events until the descriptor fails.
+ *
+ * @param shard Shard whose descriptor this thread reads.
+ */
+void InotifyEngine::reader_loop(Shard &shard)
+{
+    alignas(struct inotify_event) char buffer[64 * 1024];
+
+    while (true)
+    {
+        ssize_t len = ::read(shard.fd, buffer, sizeof(buffer));
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        route_events(shard, buffer, static_cast<std::size_t>(len));
+    }
+}
+
+/**
+ * @brief Routes one buffer of raw inotify events to their targets.
+ *
+ * @details
+ * Only the shard's own mutex is taken, so shards route in parallel.
+ *
+ * @param shard Shard the events were read from.
+ * @param buffer Start of the events.
+ * @param length Number of valid bytes.
+ */
+void InotifyEngine::route_events(Shard &shard, const char *buffer, std::size_t length)
+{
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const std::shared_ptr<ChurnStats> stats = std::atomic_load(&churn);
+
+    // Reuse one key (and path) so routing does not allocate per event.
+    RouteKey key;
+    std::string path;
+    for (std::size_t off = 0; off < length;)
+    {
+        const auto *ev = reinterpret_cast<const struct inotify_event *>(buffer + off);
+        off += sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW)
+        {
+            // Events were lost; wake everyone and let them re-check, and
+            // look again for directories that may have been created.
+            notify_all(shard, -1);
+            std::vector<int> sentinels;
+            shard.awaiting.for_each([&sentinels](const int &wd, std::vector<Awaited> &) {
+                sentinels.push_back(wd);
+            });
+            for (int wd : sentinels)
+            {
+                advance(shard, wd, std::string_view());
+            }
+            continue;
+        }
+        if (ev->mask & (IN_IGNORED | IN_MOVE_SELF))
+        {
+            // The directory went away or now lives under another name; its
+            // routes re-check and are detached until the path exists again.
+            // A renamed directory's watch is removed first so re-arming gets
+            // a fresh one if another directory already took the path.
+            notify_all(shard, ev->wd);
+            if ((ev->mask & IN_MOVE_SELF) && shard.dirs.find(ev->wd))
+            {
+                inotify_rm_watch(shard.fd, ev->wd);
+            }
+            detach_dir(shard, ev->wd);
+            continue;
+        }
+        if (ev->len == 0)
+        {
+            continue;
+        }
+
+        key.wd = ev->wd;
+        key.name.assign(ev->name);
+        if (stats)
+        {
+            if (const DirWatch *dir = shard.dirs.find(ev->wd))
+            {
+                path.assign(dir->path).append(1, '/').append(key.name);
+                stats->record(path);
+            }
+        }
+        if (auto *targets = shard.routes.find(key))
+        {
+            for (const auto &route : *targets)
+            {
+                route.notify();
+            }
+        }
+        if (auto *targets = shard.dir_routes.find(ev->wd))
+        {
+            for (const auto &route : *targets)
+            {
+                route.notify(key.name);
+            }
+        }
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+        {
+            advance(shard, ev->wd, key.name);
+        }
+    }
+}
+
+/**
+ * @brief Notifies every route under a directory.
+ *
+ * @param shard Shard owning the routes.
+ * @param wd Directory watch descriptor, or -1 for all routes.
+ *
+ * @note Caller must hold the shard's mutex.
+ */
+void InotifyEngine::notify_all(Shard &shard, int wd)
+{
+    shard.routes.for_each([wd](const RouteKey &key, std::vector<Route> &targets) {
+        if (wd < 0 || key.wd == wd)
+        {
+            for (const auto &route : targets)
+            {
+                route.notify();
+            }
+        }
+    });
+    shard.dir_routes.for_each([wd](const int &dir_wd, std::vector<DirRoute> &targets) {
+        if (wd < 0 || dir_wd == wd)
+        {
+            for (const auto &route : targets)
+            {
+                route.notify(std::string_view());
+            }
+        }
+    });
+}
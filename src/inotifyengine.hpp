@@ -0,0 +1,371 @@
+/**
+ * @file inotifyengine.hpp
+ * @brief Event-driven change notification backend built on Linux inotify.
+ *
+ * @details
+ * The engine watches the parent directory of each registered file, so
+ * in-place writes, atomic rename-over replacements, deletion and
+ * re-creation are all observed. Every kernel event is routed from its
+ * watch descriptor and entry name to the registered targets through a
+ * flat open-addressing table (FlatHashMap), keeping the per-event cost
+ * to one hash and one group probe regardless of the number of watches.
+ *
+ * When a watched directory is deleted or renamed away, its registrations
+ * wait on the nearest ancestor that still exists and are re-attached as
+ * soon as the path is created again, so watches need no periodic checks.
+ *
+ * Under heavy write churn a single descriptor read by a single thread
+ * becomes the bottleneck, so the engine can be split into shards. Each
+ * shard owns its own inotify instance, reader thread (optionally pinned
+ * to a core) and routing tables; directories are assigned to shards by
+ * hash, and events go straight from a shard to its watches without any
+ * engine-wide lock. A pinned shard keeps its routing tables on the NUMA
+ * node of its reader's core (see MemoryOptions::numa_local).
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef INOTIFYENGINE_HPP
+#define INOTIFYENGINE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "flathashmap.hpp"
+
+class ChurnStats;
+
+/**
+ * @struct RouteKey
+ * @brief Identifies a directory entry as seen by inotify.
+ */
+struct RouteKey
+{
+    int wd = -1;      ///< Watch descriptor of the parent directory.
+    std::string name; ///< Entry name within that directory.
+
+    bool operator==(const RouteKey &other) const
+    {
+        return wd == other.wd && name == other.name;
+    }
+};
+
+/**
+ * @struct RouteKeyHash
+ * @brief Hash functor for RouteKey.
+ */
+struct RouteKeyHash
+{
+    std::size_t operator()(const RouteKey &key) const
+    {
+        return std::hash<std::string_view>()(key.name) ^
+               (static_cast<std::size_t>(key.wd) * 0x9E3779B97F4A7C15ULL);
+    }
+};
+
+/**
+ * @class InotifyEngine
+ * @brief Shared inotify instances that wake watches when their file changes.
+ *
+ * @details
+ * Targets register a notification function per file path. The engine
+ * invokes it from its reader thread whenever an event names the file;
+ * the function is expected to be short and non-blocking (typically it
+ * just wakes the owning watch).
+ */
+class InotifyEngine
+{
+public:
+    /// Handle returned by add() and accepted by remove().
+    using Token = std::uint64_t;
+
+    /**
+     * @brief Returns the process-wide engine.
+     */
+    static InotifyEngine &instance();
+
+    /**
+     * @brief Sets the number of shards and whether readers are pinned.
+     *
+     * @details
+     * Must be called before the first file is registered; the shard layout
+     * is fixed from then on. Reader thread @c i is pinned to core
+     * @c i modulo the number of online cores.
+     *
+     * @param shards Number of inotify instances (at least 1).
+     * @param pin_readers Pin each reader thread to its own core.
+     * @return true if applied, false if the engine is already in use.
+     */
+    bool configure(std::size_t shards, bool pin_readers = true);
+
+    /**
+     * @brief Number of shards in use (or configured, before first use).
+     */
+    std::size_t shard_count();
+
+    /**
+     * @brief Registers interest in a file.
+     *
+     * @param path Path to the file; symlinks are resolved.
+     * @param notify Function invoked on every event naming the file.
+     * @return Token for remove(), or 0 if inotify is unavailable or the
+     *         parent directory could not be watched.
+     */
+    Token add(const std::string &path, std::function<void()> notify);
+
+    /**
+     * @brief Registers interest in every entry of a directory.
+     *
+     * @details
+     * @p notify is invoked with the entry's name for each event naming an
+     * entry of @p dir, and with an empty name when events were lost or
+     * the directory itself went away, meaning its whole contents must be
+     * re-checked. The directory shares its inotify watch with files
+     * registered through add().
+     *
+     * @param dir Path to the directory; symlinks are resolved.
+     * @param notify Function invoked with the entry name.
+     * @return Token for remove(), or 0 on failure.
+     */
+    Token add_directory(const std::string &dir, std::function<void(std::string_view)> notify);
+
+    /**
+     * @brief Drops a registration made with add().
+     *
+     * @details
+     * After remove() returns, @p notify is not called again.
+     *
+     * @param token Token returned by add().
+     */
+    void remove(Token token);
+
+    /**
+     * @brief Whether a registration still has a live directory watch.
+     *
+     * @details
+     * When a watched directory is deleted, renamed away or unmounted, the
+     * registrations under it are told to re-check and kept detached. The
+     * engine then watches the nearest existing ancestor for the missing
+     * path, level by level, and re-attaches them (telling them to re-check
+     * again) once the directory exists; registering the path again also
+     * re-attaches them.
+     *
+     * @param token Token returned by add() or add_directory().
+     * @return false if @p token is detached or unknown.
+     */
+    bool attached(Token token);
+
+    /**
+     * @brief Number of (directory, name) routes currently registered.
+     */
+    std::size_t route_count();
+
+    /**
+     * @brief Counts every event the engine reads into @p stats.
+     *
+     * @details
+     * Each event naming an entry of a watched directory is recorded under
+     * the entry's full path, whether or not a watch asked for that file,
+     * so busy neighbours of watched files show up too. Pass nullptr to
+     * stop counting.
+     *
+     * @param stats Statistics to feed, shared with the caller.
+     */
+    void set_churn_stats(std::shared_ptr<ChurnStats> stats);
+
+private:
+    /**
+     * @brief A registered notification target.
+     */
+    struct Route
+    {
+        Token token;                 ///< Registration handle.
+        std::function<void()> notify; ///< Wake-up function.
+    };
+
+    /**
+     * @brief A registered whole-directory target.
+     */
+    struct DirRoute
+    {
+        Token token;                                 ///< Registration handle.
+        std::function<void(std::string_view)> notify; ///< Called with the entry name.
+    };
+
+    /**
+     * @brief Reference-counted inotify watch on a directory.
+     *
+     * @details
+     * The kernel keeps one watch per directory inode, so several paths to
+     * the same directory share one of these.
+     */
+    struct DirWatch
+    {
+        std::string path;     ///< First path the directory was registered under.
+        std::size_t refs = 0; ///< Registrations using this watch.
+    };
+
+    /**
+     * @brief Registrations whose directory watch was dropped by the kernel.
+     */
+    struct Detached
+    {
+        std::vector<std::pair<std::string, Route>> files; ///< Entry name and target.
+        std::vector<DirRoute> dirs;                        ///< Whole-directory targets.
+        int sentinel = -1; ///< Watch on the nearest existing ancestor, or -1.
+    };
+
+    /**
+     * @brief A detached directory waiting for an entry of an ancestor.
+     */
+    struct Awaited
+    {
+        std::string name; ///< Missing entry of the watched ancestor.
+        std::string dir;  ///< Detached directory path below it.
+    };
+
+    /**
+     * @brief One inotify instance with its reader and routing tables.
+     */
+    struct Shard
+    {
+        /**
+         * @brief Creates the shard's tables on @p numa_node (-1 for no preference).
+         */
+        explicit Shard(int numa_node)
+            : routes(16, numa_node), dirs(16, numa_node), dir_routes(16, numa_node),
+              tokens(16, numa_node), detached(16, numa_node), awaiting(16, numa_node)
+        {
+        }
+
+        std::size_t index = 0;                  ///< Position in the shard array.
+        int fd = -1;                            ///< inotify descriptor.
+        std::thread reader;                     ///< Reader thread, started on first add().
+        std::mutex mutex;                       ///< Guards this shard's tables.
+        FlatHashMap<RouteKey, std::vector<Route>, RouteKeyHash> routes; ///< (wd, name) to targets.
+        FlatHashMap<int, DirWatch> dirs;        ///< Watch descriptor to directory watch.
+        FlatHashMap<int, std::vector<DirRoute>> dir_routes; ///< Whole-directory targets.
+        FlatHashMap<Token, std::pair<RouteKey, std::string>> tokens; ///< Token to route and directory.
+        FlatHashMap<std::string, Detached> detached; ///< Directory path to detached registrations.
+        FlatHashMap<int, std::vector<Awaited>> awaiting; ///< Ancestor watch to directories below it.
+    };
+
+    /// Low bits of a token that hold the shard index.
+    static constexpr unsigned SHARD_BITS = 8;
+
+    InotifyEngine() = default;
+
+    /**
+     * @brief Creates the shards on first use with the configured layout.
+     */
+    void start_shards();
+
+    /**
+     * @brief Adds a reference to the watch on @p dir in @p shard.
+     *
+     * @details
+     * Registrations detached from an earlier watch on the same path are
+     * re-attached and notified.
+     *
+     * @return The watch descriptor, or -1 on failure.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    int acquire_dir(Shard &shard, const std::string &dir);
+
+    /**
+     * @brief Adds a kernel watch on @p dir, or a reference to the existing one.
+     *
+     * @return The watch descriptor, or -1 on failure.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    int hold_dir(Shard &shard, const std::string &dir);
+
+    /**
+     * @brief Drops a reference to @p wd, removing the kernel watch with the last.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    void release_dir(Shard &shard, int wd);
+
+    /**
+     * @brief Re-attaches the registrations parked under @p dir, or waits for it.
+     *
+     * @details
+     * If @p dir exists it is watched again; otherwise a sentinel watch is
+     * placed on its nearest existing ancestor.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    void rearm(Shard &shard, const std::string &dir);
+
+    /**
+     * @brief Drops the sentinel watch of the detached directory @p dir.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    void disarm(Shard &shard, const std::string &dir, int sentinel);
+
+    /**
+     * @brief Re-arms every directory waiting on @p wd for the entry @p name.
+     *
+     * @param name Entry that appeared; empty for every waiting directory.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    void advance(Shard &shard, int wd, std::string_view name);
+
+    /**
+     * @brief Moves every registration under @p wd to the detached table.
+     *
+     * @details
+     * Called when the kernel has dropped the watch (IN_IGNORED) or the
+     * directory was renamed away (IN_MOVE_SELF). Every detached directory
+     * without a sentinel is re-armed afterwards.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    void detach_dir(Shard &shard, int wd);
+
+    /**
+     * @brief Reader thread body; blocks on the shard's descriptor.
+     */
+    void reader_loop(Shard &shard);
+
+    /**
+     * @brief Routes one buffer of raw inotify events.
+     *
+     * @param shard Shard the events were read from.
+     * @param buffer Start of the events.
+     * @param length Number of valid bytes.
+     */
+    void route_events(Shard &shard, const char *buffer, std::size_t length);
+
+    /**
+     * @brief Notifies every route under @p wd, or all routes if @p wd < 0.
+     *
+     * @note Caller must hold the shard's mutex.
+     */
+    void notify_all(Shard &shard, int wd);
+
+    std::once_flag started;                 ///< Guards start_shards().
+    std::mutex config_mutex;                ///< Guards the configuration below.
+    bool in_use = false;                    ///< Set once shards exist.
+    std::size_t configured_shards = 1;      ///< Requested shard count.
+    bool pin = false;                       ///< Pin reader threads to cores.
+    std::vector<std::unique_ptr<Shard>> shards; ///< Fixed after start_shards().
+    std::atomic<Token> next_token{0};       ///< Source of tokens.
+    std::shared_ptr<ChurnStats> churn;      ///< Optional event counter; accessed atomically.
+};
+
+#endif // INOTIFYENGINE_HPP
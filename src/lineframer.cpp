@@ -0,0 +1,196 @@
+/**
+ * @file lineframer.cpp
+ * @brief Implementation file for find_delimiter() and LineFramer.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "lineframer.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINEFRAMER_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    /**
+     * @brief Portable scan, eight bytes at a time.
+     *
+     * @details
+     * XOR with the broadcast delimiter turns matching bytes into zero;
+     * the classic has-zero-byte test then flags them.
+     */
+    const char *find_swar(const char *p, const char *end, char delim)
+    {
+        constexpr std::uint64_t ONES = 0x0101010101010101ULL;
+        constexpr std::uint64_t HIGHS = 0x8080808080808080ULL;
+        const std::uint64_t pattern = ONES * static_cast<unsigned char>(delim);
+
+        for (; end - p >= 8; p += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            word ^= pattern;
+            std::uint64_t found = (word - ONES) & ~word & HIGHS;
+            if (found)
+            {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                return p + (__builtin_ctzll(found) >> 3);
+#else
+                return p + (__builtin_clzll(found) >> 3);
+#endif
+            }
+        }
+        for (; p < end; ++p)
+        {
+            if (*p == delim)
+                return p;
+        }
+        return end;
+    }
+
+#if defined(LINEFRAMER_X86)
+    /**
+     * @brief SSE2 scan, sixteen bytes at a time.
+     */
+    __attribute__((target("sse2")))
+    const char *find_sse2(const char *p, const char *end, char delim)
+    {
+        const __m128i pattern = _mm_set1_epi8(delim);
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern));
+            if (mask)
+                return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        return find_swar(p, end, delim);
+    }
+
+    /**
+     * @brief AVX2 scan, thirty-two bytes at a time.
+     */
+    __attribute__((target("avx2")))
+    const char *find_avx2(const char *p, const char *end, char delim)
+    {
+        const __m256i pattern = _mm256_set1_epi8(delim);
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            unsigned mask = static_cast<unsigned>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, pattern)));
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+        return find_sse2(p, end, delim);
+    }
+#elif defined(__ARM_NEON)
+    /**
+     * @brief NEON scan, sixteen bytes at a time.
+     *
+     * @details
+     * Narrowing the comparison result by four bits per byte yields a
+     * 64-bit mask whose trailing zero count locates the first match.
+     */
+    const char *find_neon(const char *p, const char *end, char delim)
+    {
+        const uint8x16_t pattern = vdupq_n_u8(static_cast<std::uint8_t>(delim));
+        for (; end - p >= 16; p += 16)
+        {
+            uint8x16_t chunk = vld1q_u8(reinterpret_cast<const std::uint8_t *>(p));
+            uint8x16_t eq = vceqq_u8(chunk, pattern);
+            std::uint64_t mask = vget_lane_u64(
+                vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+            if (mask)
+                return p + (__builtin_ctzll(mask) >> 2);
+        }
+        return find_swar(p, end, delim);
+    }
+#endif
+
+    using FindFn = const char *(*)(const char *, const char *, char);
+
+    /**
+     * @brief Implementation chosen for this machine, with its name.
+     */
+    struct Scanner
+    {
+        FindFn find;      ///< Scan function.
+        const char *isa;  ///< Instruction set it uses.
+    };
+
+    /**
+     * @brief Picks the widest scan the CPU supports, once.
+     */
+    const Scanner &scanner()
+    {
+        static const Scanner chosen = [] {
+#if defined(LINEFRAMER_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return Scanner{find_avx2, "avx2"};
+            if (__builtin_cpu_supports("sse2"))
+                return Scanner{find_sse2, "sse2"};
+            return Scanner{find_swar, "swar"};
+#elif defined(__ARM_NEON)
+            return Scanner{find_neon, "neon"};
+#else
+            return Scanner{find_swar, "swar"};
+#endif
+        }();
+        return chosen;
+    }
+}
+
+/**
+ * @brief Finds the first occurrence of @p delim in [begin, end).
+ *
+ * @param begin Start of the range.
+ * @param end End of the range.
+ * @param delim Byte to look for.
+ * @return Pointer to the byte, or @p end if absent.
+ */
+const char *find_delimiter(const char *begin, const char *end, char delim)
+{
+    return scanner().find(begin, end, delim);
+}
+
+/**
+ * @brief Name of the instruction set in use.
+ *
+ * @return "avx2", "sse2", "neon" or "swar".
+ */
+const char *delimiter_scan_isa()
+{
+    return scanner().isa;
+}
+
+/**
+ * @brief Frames complete lines.
+ *
+ * @param data Start of the bytes.
+ * @param length Number of bytes.
+ * @param lines Receives views into @p data.
+ * @return Offset just past the last terminator.
+ */
+std::size_t LineFramer::frame(const char *data, std::size_t length, LineBatch &lines) const
+{
+    const FindFn find = scanner().find;
+    const char *const end = data + length;
+    const char *line = data;
+
+    for (const char *hit = find(line, end, delim); hit != end; hit = find(line, end, delim))
+    {
+        lines.emplace_back(line, static_cast<std::size_t>(hit - line));
+        line = hit + 1;
+    }
+    return static_cast<std::size_t>(line - data);
+}
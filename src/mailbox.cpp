@@ -0,0 +1,125 @@
+/**
+ * @file mailbox.cpp
+ * @brief Implementation file for Mailbox and MailboxChannel.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "mailbox.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Creates a channel.
+ *
+ * @param overflow Task run on the home thread in place of dropped posts.
+ * @param capacity Tasks held before coalescing.
+ */
+MailboxChannel::MailboxChannel(std::function<void()> overflow, std::size_t capacity)
+    : overflow(std::move(overflow)),
+      tasks(capacity)
+{
+}
+
+/**
+ * @brief Queues a task for the home thread.
+ *
+ * @param task Task to run on the home thread.
+ */
+void MailboxChannel::post(std::function<void()> task)
+{
+    if (!tasks.push(std::move(task)))
+    {
+        overflowed.store(true, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief Runs every queued task, then the overflow task if posts were dropped.
+ *
+ * @return Number of tasks run.
+ */
+std::size_t MailboxChannel::drain()
+{
+    std::size_t ran = 0;
+    std::function<void()> task;
+    while (tasks.pop(task))
+    {
+        task();
+        task = nullptr;
+        ++ran;
+    }
+    if (overflowed.exchange(false, std::memory_order_acq_rel) && overflow)
+    {
+        overflow();
+        ++ran;
+    }
+    return ran;
+}
+
+/**
+ * @brief Returns the calling thread's mailbox.
+ *
+ * @return Thread-local instance.
+ */
+Mailbox &Mailbox::this_thread()
+{
+    thread_local Mailbox mailbox;
+    return mailbox;
+}
+
+/**
+ * @brief Opens a channel on the calling thread.
+ *
+ * @param overflow Task run once in place of posts dropped on overflow.
+ * @param capacity Tasks held before coalescing.
+ * @return The channel.
+ */
+std::shared_ptr<MailboxChannel> Mailbox::open(std::function<void()> overflow,
+                                              std::size_t capacity)
+{
+    auto channel = std::make_shared<MailboxChannel>(std::move(overflow), capacity);
+    this_thread().channels.push_back(channel);
+    return channel;
+}
+
+/**
+ * @brief Drains the calling thread's channels.
+ *
+ * @details
+ * A channel held only by the mailbox has no producer left and is pruned.
+ * Once a channel's count drops to one it cannot rise again, so the check
+ * is safe without further synchronization.
+ *
+ * @return Number of tasks run.
+ */
+std::size_t Mailbox::drain()
+{
+    auto &channels = this_thread().channels;
+    channels.erase(std::remove_if(channels.begin(), channels.end(),
+                                  [](const std::shared_ptr<MailboxChannel> &c) {
+                                      return c.use_count() == 1;
+                                  }),
+                   channels.end());
+
+    std::size_t delivered = 0;
+    // Index loop: a task may open new channels on this thread.
+    for (std::size_t i = 0; i < channels.size(); ++i)
+    {
+        auto channel = channels[i];
+        delivered += channel->drain();
+    }
+    return delivered;
+}
+
+/**
+ * @brief Number of open channels on the calling thread.
+ *
+ * @return Channel count, including ones not yet pruned.
+ */
+std::size_t Mailbox::channel_count()
+{
+    return this_thread().channels.size();
+}
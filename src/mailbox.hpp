@@ -0,0 +1,118 @@
+/**
+ * @file mailbox.hpp
+ * @brief Per-thread mailboxes for delivering callbacks on a home thread.
+ *
+ * @details
+ * Subsystems built as single-threaded actors want their change handlers
+ * to run on their own thread. A home-thread subscription is registered
+ * from that thread; each change detected by the watch is posted into a
+ * lock-free SPSC channel owned by the thread's Mailbox, and the thread
+ * runs the handlers whenever it calls Mailbox::drain(). Handlers are
+ * therefore confined to one thread and need no locking, and a burst of
+ * changes is delivered as one batch.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "spscring.hpp"
+
+/**
+ * @class MailboxChannel
+ * @brief One subscription's queue from a watch thread to a home thread.
+ *
+ * @details
+ * The watch thread is the only producer and the home thread the only
+ * consumer. Each post carries a task to run on the home thread. If the
+ * ring fills up before the home thread drains it, further posts are
+ * coalesced into a single run of the channel's overflow task rather than
+ * lost; for change notifications one extra run covers any number of
+ * missed ones.
+ */
+class MailboxChannel
+{
+public:
+    /**
+     * @brief Creates a channel.
+     *
+     * @param overflow Task run on the home thread in place of dropped posts.
+     * @param capacity Tasks held before coalescing.
+     */
+    MailboxChannel(std::function<void()> overflow, std::size_t capacity);
+
+    /**
+     * @brief Queues a task for the home thread (producer side).
+     *
+     * @details
+     * Never blocks. A full ring sets the overflow flag instead.
+     *
+     * @param task Task to run on the home thread.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * @brief Runs every queued task (consumer side).
+     *
+     * @return Number of tasks run.
+     */
+    std::size_t drain();
+
+private:
+    std::function<void()> overflow;               ///< Runs on the home thread only.
+    SpscRing<std::function<void()>> tasks;        ///< Posted tasks.
+    std::atomic<bool> overflowed{false};          ///< Set when a post found the ring full.
+};
+
+/**
+ * @class Mailbox
+ * @brief The calling thread's set of home-thread channels.
+ */
+class Mailbox
+{
+public:
+    /**
+     * @brief Opens a channel drained by the calling thread.
+     *
+     * @param overflow Task run once in place of posts dropped on overflow.
+     * @param capacity Tasks held before coalescing.
+     * @return The channel; the producer keeps it and calls post().
+     */
+    static std::shared_ptr<MailboxChannel> open(std::function<void()> overflow,
+                                                std::size_t capacity = 64);
+
+    /**
+     * @brief Runs every pending task on the calling thread.
+     *
+     * @details
+     * Channels whose producer side has gone away (the subscription was
+     * removed) are discarded without running their pending tasks.
+     *
+     * @return Number of tasks run.
+     */
+    static std::size_t drain();
+
+    /**
+     * @brief Number of open channels on the calling thread.
+     */
+    static std::size_t channel_count();
+
+private:
+    /**
+     * @brief The calling thread's mailbox.
+     */
+    static Mailbox &this_thread();
+
+    std::vector<std::shared_ptr<MailboxChannel>> channels; ///< Owned by this thread only.
+};
+
+#endif // MAILBOX_HPP
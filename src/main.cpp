@@ -135,6 +135,9 @@ int main()
 
     // Start monitoring the file
     MonitorState state = monitor.filemon(testFileName, onFileChanged);
+    monitor.add_callback([] {
+        std::cout << "[Callback] Second subscriber notified." << std::endl;
+    });
     monitor.setPriority(SCHED_RR, 10);
 
     if (state == MonitorState::FILE_NOT_FOUND)
@@ -0,0 +1,241 @@
+/**
+ * @file mappedfile.cpp
+ * @brief Implementation file for MappedFile and MappingSlot.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "mappedfile.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @brief Maps a file read-only.
+ *
+ * @details
+ * The fingerprint is taken from the open descriptor, so it describes the
+ * inode that was mapped even if the path is replaced meanwhile. The
+ * mapping is private, and the descriptor is checked again once it is in
+ * place: if the file changed while it was being mapped (a truncation
+ * would leave pages that fault), it is copied instead. The descriptor is
+ * closed right away; the mapping keeps the inode alive.
+ *
+ * @param path Path to the file.
+ * @return The mapping, or nullptr on failure.
+ */
+std::shared_ptr<const MappedFile> MappedFile::map(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    auto version = FileFingerprint::capture(fd);
+    if (!version)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *addr = nullptr;
+    if (version->size > 0)
+    {
+        addr = ::mmap(nullptr, version->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        auto after = FileFingerprint::capture(fd);
+        if (!after || *after != *version)
+        {
+            ::munmap(addr, version->size);
+            auto result = read_copy(fd, *version);
+            ::close(fd);
+            return result;
+        }
+    }
+    ::close(fd);
+
+    const auto length = static_cast<std::size_t>(version->size);
+    return std::shared_ptr<const MappedFile>(new MappedFile(addr, length, length, *version));
+}
+
+/**
+ * @brief Reads a file into private anonymous memory.
+ *
+ * @param path Path to the file.
+ * @return The copy, or nullptr on failure.
+ */
+std::shared_ptr<const MappedFile> MappedFile::copy(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    auto version = FileFingerprint::capture(fd);
+    std::shared_ptr<const MappedFile> result;
+    if (version)
+    {
+        result = read_copy(fd, *version);
+    }
+    ::close(fd);
+    return result;
+}
+
+/**
+ * @brief Reads an open file into anonymous memory.
+ *
+ * @details
+ * Reads at most version.size bytes and stops early at end of file. The
+ * fingerprint recorded is the one taken before reading, so a file that
+ * changed during the read does not match it and is copied again on the
+ * next refresh.
+ *
+ * @param fd Open descriptor.
+ * @param version Fingerprint taken before reading.
+ * @return The copy, or nullptr on failure.
+ */
+std::shared_ptr<const MappedFile> MappedFile::read_copy(int fd, const FileFingerprint &version)
+{
+    const auto size = static_cast<std::size_t>(version.size);
+    if (size == 0)
+    {
+        return std::shared_ptr<const MappedFile>(new MappedFile(nullptr, 0, 0, version));
+    }
+
+    void *addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    std::size_t done = 0;
+    while (done < size)
+    {
+        ssize_t got = ::pread(fd, static_cast<char *>(addr) + done, size - done,
+                              static_cast<off_t>(done));
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got < 0)
+        {
+            ::munmap(addr, size);
+            return nullptr;
+        }
+        if (got == 0)
+        {
+            break;
+        }
+        done += static_cast<std::size_t>(got);
+    }
+    ::mprotect(addr, size, PROT_READ);
+    return std::shared_ptr<const MappedFile>(new MappedFile(addr, done, size, version));
+}
+
+/**
+ * @brief Wraps an existing mapping.
+ *
+ * @param addr Mapping start, nullptr for an empty file.
+ * @param length Readable bytes.
+ * @param mapped Bytes to unmap.
+ * @param version File state when mapped.
+ */
+MappedFile::MappedFile(void *addr, std::size_t length, std::size_t mapped,
+                       const FileFingerprint &version)
+    : addr(addr), length(length), mapped(mapped), version(version)
+{
+}
+
+/**
+ * @brief Unmaps the file.
+ */
+MappedFile::~MappedFile()
+{
+    if (addr)
+    {
+        ::munmap(addr, mapped);
+    }
+}
+
+/**
+ * @brief Sets the file to map.
+ *
+ * @param path Path to the file, or empty to stop mapping.
+ */
+void MappingSlot::set_path(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path != file_name)
+    {
+        copy_only = false;
+    }
+    file_name = path;
+}
+
+/**
+ * @brief Maps the file again if it changed.
+ *
+ * @return true if a new mapping was published.
+ */
+bool MappingSlot::refresh()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file_name.empty())
+    {
+        return false;
+    }
+
+    auto old = std::atomic_load(&mapping);
+    if (old)
+    {
+        auto now = FileFingerprint::capture(file_name);
+        if (now && *now == old->fingerprint())
+        {
+            return false;
+        }
+        const FileFingerprint &was = old->fingerprint();
+        if (now && now->dev == was.dev && now->ino == was.ino && now->size < was.size)
+        {
+            // Truncated in place: further mappings of it could fault.
+            copy_only = true;
+        }
+    }
+
+    auto next = copy_only ? MappedFile::copy(file_name) : MappedFile::map(file_name);
+    if (!next)
+    {
+        return false;
+    }
+    std::atomic_store(&mapping, std::move(next));
+    return true;
+}
+
+/**
+ * @brief Drops the published mapping.
+ */
+void MappingSlot::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::atomic_store(&mapping, std::shared_ptr<const MappedFile>());
+}
+
+/**
+ * @brief Returns the newest mapping.
+ *
+ * @return The mapping, or nullptr if none is published.
+ */
+std::shared_ptr<const MappedFile> MappingSlot::current() const
+{
+    return std::atomic_load(&mapping);
+}
@@ -0,0 +1,162 @@
+/**
+ * @file mappedfile.hpp
+ * @brief Read-only memory mappings of a watched file, swapped on change.
+ *
+ * @details
+ * A MappedFile is one read-only mmap() of one version of a file. Readers
+ * hold it through a std::shared_ptr, so a mapping stays valid for as long
+ * as anyone is reading it and is unmapped as soon as the last reader
+ * lets go. A MappingSlot publishes the newest mapping: each refresh maps
+ * the current file and swaps it in atomically, without disturbing readers
+ * of older versions.
+ *
+ * The mapping is backed by the page cache, so it is only a stable
+ * snapshot when writers replace the file (write a new file, rename it over
+ * the old one). A file modified in place is seen modified through existing
+ * mappings too.
+ *
+ * Truncation is worse: touching a mapped page past the new end of file
+ * raises SIGBUS and kills the process. map() re-checks the file after
+ * mapping it and falls back to copy() if it changed meanwhile, and a
+ * MappingSlot that sees its file shrink in place switches to copies for
+ * good. A reader already holding a mapping when the file is truncated is
+ * still exposed, so files that may be truncated should be read through
+ * copy() (or MonitorFile::load()) instead.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "fingerprint.hpp"
+
+/**
+ * @class MappedFile
+ * @brief Immutable read-only mapping of one version of a file.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Maps @p path read-only.
+     *
+     * @param path Path to the file.
+     * @return The mapping, or nullptr if the file cannot be opened or mapped.
+     */
+    static std::shared_ptr<const MappedFile> map(const std::string &path);
+
+    /**
+     * @brief Reads @p path into private anonymous memory.
+     *
+     * @details
+     * Costs a copy but cannot fault if the file is later truncated.
+     *
+     * @param path Path to the file.
+     * @return The copy, or nullptr if the file cannot be opened or read.
+     */
+    static std::shared_ptr<const MappedFile> copy(const std::string &path);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief First byte of the mapping, or nullptr for an empty file.
+     */
+    const char *data() const { return static_cast<const char *>(addr); }
+
+    /**
+     * @brief Length of the mapping in bytes.
+     */
+    std::size_t size() const { return length; }
+
+    /**
+     * @brief The mapping as a string view.
+     */
+    std::string_view view() const { return std::string_view(data(), length); }
+
+    /**
+     * @brief Version of the file that was mapped.
+     */
+    const FileFingerprint &fingerprint() const { return version; }
+
+private:
+    MappedFile(void *addr, std::size_t length, std::size_t mapped,
+               const FileFingerprint &version);
+
+    /**
+     * @brief Reads an open file into anonymous memory.
+     *
+     * @param fd Open descriptor, positioned anywhere.
+     * @param version Fingerprint taken before reading.
+     * @return The copy, or nullptr on failure.
+     */
+    static std::shared_ptr<const MappedFile> read_copy(int fd, const FileFingerprint &version);
+
+    void *addr;              ///< Mapping start, nullptr when empty.
+    std::size_t length;      ///< Readable bytes.
+    std::size_t mapped;      ///< Bytes to unmap.
+    FileFingerprint version; ///< File state when mapped.
+};
+
+/**
+ * @class MappingSlot
+ * @brief Holds the newest mapping of a file for lock-free readers.
+ */
+class MappingSlot
+{
+public:
+    /**
+     * @brief Sets the file to map; takes effect on the next refresh().
+     *
+     * @param path Path to the file, or empty to stop mapping.
+     */
+    void set_path(const std::string &path);
+
+    /**
+     * @brief Maps the file again if it changed since the current mapping.
+     *
+     * @details
+     * If the file cannot be mapped the previous mapping is kept. Once the
+     * file has been seen to shrink without being replaced, later versions
+     * are copied rather than mapped.
+     *
+     * @return true if a new mapping was published.
+     */
+    bool refresh();
+
+    /**
+     * @brief Drops the published mapping.
+     *
+     * @details
+     * Readers holding it keep it until they release it.
+     */
+    void reset();
+
+    /**
+     * @brief Returns the newest mapping, or nullptr if none.
+     */
+    std::shared_ptr<const MappedFile> current() const;
+
+private:
+    std::mutex mutex;                          ///< Serializes set_path() and refresh().
+    std::string file_name;                     ///< File to map; empty when disabled.
+    std::shared_ptr<const MappedFile> mapping; ///< Published mapping; accessed atomically.
+    bool copy_only = false;                    ///< Set once the file was truncated in place.
+};
+
+#endif // MAPPEDFILE_HPP
@@ -0,0 +1,347 @@
+/**
+ * @file mergedtail.cpp
+ * @brief Implementation file for MergedTail.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "mergedtail.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    /**
+     * @brief Reads @p count decimal digits at @p p.
+     *
+     * @return The value, or -1 if any character is not a digit.
+     */
+    int read_digits(const char *p, std::size_t count)
+    {
+        int value = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            unsigned d = static_cast<unsigned char>(p[i]) - '0';
+            if (d > 9)
+                return -1;
+            value = value * 10 + static_cast<int>(d);
+        }
+        return value;
+    }
+
+    /**
+     * @brief Days since 1970-01-01 of a proleptic Gregorian date.
+     *
+     * @details
+     * Howard Hinnant's days_from_civil, which needs no tables or libc.
+     */
+    std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d)
+    {
+        y -= m <= 2;
+        const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+    }
+}
+
+/**
+ * @brief Parses a fixed-format timestamp at the start of @p text.
+ *
+ * @param text Text starting with the timestamp.
+ * @return Nanoseconds since the Unix epoch, or std::nullopt.
+ */
+std::optional<std::int64_t> parse_timestamp(std::string_view text)
+{
+    // YYYY-MM-DDTHH:MM:SS
+    constexpr std::size_t BASE = 19;
+    if (text.size() < BASE)
+        return std::nullopt;
+
+    const char *p = text.data();
+    if (p[4] != '-' || p[7] != '-' || (p[10] != 'T' && p[10] != ' ') || p[13] != ':' ||
+        p[16] != ':')
+        return std::nullopt;
+
+    const int year = read_digits(p, 4);
+    const int month = read_digits(p + 5, 2);
+    const int day = read_digits(p + 8, 2);
+    const int hour = read_digits(p + 11, 2);
+    const int minute = read_digits(p + 14, 2);
+    const int second = read_digits(p + 17, 2);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23 ||
+        minute < 0 || minute > 59 || second < 0 || second > 60)
+        return std::nullopt;
+
+    std::int64_t fraction = 0;
+    if (text.size() > BASE && (p[BASE] == '.' || p[BASE] == ','))
+    {
+        std::size_t digits = 0;
+        for (std::size_t i = BASE + 1; i < text.size() && digits < 9; ++i, ++digits)
+        {
+            unsigned d = static_cast<unsigned char>(p[i]) - '0';
+            if (d > 9)
+                break;
+            fraction = fraction * 10 + d;
+        }
+        for (; digits < 9; ++digits)
+            fraction *= 10;
+    }
+
+    const std::int64_t days = days_from_civil(year, static_cast<unsigned>(month),
+                                              static_cast<unsigned>(day));
+    const std::int64_t seconds = days * 86400 + hour * 3600 + minute * 60 + second;
+    return seconds * 1000000000LL + fraction;
+}
+
+/**
+ * @brief Creates an empty merge.
+ *
+ * @param sink Receives the ordered lines.
+ * @param window Reorder window.
+ * @param timestamp_offset Bytes before the timestamp in each line.
+ */
+MergedTail::MergedTail(Sink sink, std::chrono::milliseconds window, std::size_t timestamp_offset)
+    : sink(std::move(sink)),
+      window_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(window).count()),
+      timestamp_offset(timestamp_offset)
+{
+}
+
+/**
+ * @brief Stops following every file.
+ *
+ * @details
+ * Monitors are stopped before anything else is torn down, and without
+ * holding the lock their callbacks take.
+ */
+MergedTail::~MergedTail()
+{
+    std::vector<std::unique_ptr<Source>> owned;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        owned.swap(sources);
+        heap.clear();
+    }
+    for (auto &source : owned)
+    {
+        source->monitor->stop();
+    }
+}
+
+/**
+ * @brief Starts following @p path.
+ *
+ * @param path Log file to add.
+ * @param from_end Skip its existing contents.
+ * @return Index of the file, or std::nullopt if it could not be monitored.
+ */
+std::optional<std::size_t> MergedTail::add(const std::string &path, bool from_end)
+{
+    auto source = std::make_unique<Source>();
+    source->monitor = std::make_unique<MonitorFile>();
+    if (source->monitor->filemon(path) != MonitorState::MONITORING)
+    {
+        return std::nullopt;
+    }
+
+    std::size_t index;
+    MonitorFile *monitor = source->monitor.get();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        index = sources.size();
+        sources.push_back(std::move(source));
+    }
+
+    const SubscriptionId id = monitor->add_tail_callback(
+        [this, index](const LineBatch &batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ingest(index, batch);
+            release(false);
+        },
+        from_end);
+    if (id == 0)
+    {
+        // The slot stays, but with no lines it never affects the watermark.
+        monitor->stop();
+        return std::nullopt;
+    }
+    return index;
+}
+
+/**
+ * @brief Releases every buffered line, in order.
+ */
+void MergedTail::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    release(true);
+}
+
+/**
+ * @brief Lines currently buffered across all files.
+ *
+ * @return Number of unreleased lines.
+ */
+std::size_t MergedTail::buffered()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t total = 0;
+    for (const auto &source : sources)
+    {
+        total += source->lines.size() - source->next;
+    }
+    return total;
+}
+
+/**
+ * @brief Buffers a batch of lines from @p index.
+ *
+ * @details
+ * Reclaims the arena once everything in it was released, or shifts the
+ * unreleased tail down once more than half of it is dead, so the arena
+ * and index stop growing after warm-up.
+ *
+ * @param index Source the batch was read from.
+ * @param batch Lines just read.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+void MergedTail::ingest(std::size_t index, const LineBatch &batch)
+{
+    if (batch.empty() || index >= sources.size())
+        return;
+    Source &src = *sources[index];
+
+    if (src.next == src.lines.size())
+    {
+        src.arena.clear();
+        src.lines.clear();
+        src.next = 0;
+    }
+    else if (src.next > src.lines.size() / 2)
+    {
+        const std::size_t base = src.lines[src.next].offset;
+        std::memmove(src.arena.data(), src.arena.data() + base, src.arena.size() - base);
+        src.arena.resize(src.arena.size() - base);
+        src.lines.erase(src.lines.begin(), src.lines.begin() + static_cast<std::ptrdiff_t>(src.next));
+        for (auto &line : src.lines)
+        {
+            line.offset -= base;
+        }
+        src.next = 0;
+    }
+
+    for (std::string_view text : batch)
+    {
+        std::optional<std::int64_t> ts;
+        if (text.size() > timestamp_offset)
+        {
+            ts = parse_timestamp(text.substr(timestamp_offset));
+        }
+        if (ts)
+        {
+            // Never step backwards within one file, so its own order holds.
+            src.latest = src.seen ? std::max(src.latest, *ts) : *ts;
+            src.seen = true;
+        }
+
+        const std::size_t offset = src.arena.size();
+        src.arena.insert(src.arena.end(), text.begin(), text.end());
+        src.lines.push_back(Line{src.latest, offset, text.size()});
+    }
+
+    if (!src.queued)
+    {
+        src.queued = true;
+        heap.push_back(index);
+        std::push_heap(heap.begin(), heap.end(),
+                       [this](std::size_t a, std::size_t b) { return later(a, b); });
+    }
+}
+
+/**
+ * @brief Releases lines up to the watermark, or all when @p all.
+ *
+ * @details
+ * The watermark is the oldest newest-timestamp across files, raised to
+ * at most the reorder window behind the newest. Every file has already
+ * delivered everything up to it, so no line older than the watermark can
+ * still arrive from them. Files that have not produced a timestamp yet are
+ * left out until they do; their first lines are released as soon as they
+ * arrive if they are older than the watermark.
+ *
+ * @param all Release everything regardless of the watermark.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+void MergedTail::release(bool all)
+{
+    std::int64_t watermark = std::numeric_limits<std::int64_t>::max();
+    if (!all)
+    {
+        std::int64_t oldest = std::numeric_limits<std::int64_t>::max();
+        std::int64_t newest = std::numeric_limits<std::int64_t>::min();
+        for (const auto &source : sources)
+        {
+            // A file that never produced a timestamp (or could not be
+            // opened) would otherwise pin the watermark.
+            if (source->seen)
+            {
+                oldest = std::min(oldest, source->latest);
+                newest = std::max(newest, source->latest);
+            }
+        }
+        if (newest == std::numeric_limits<std::int64_t>::min())
+            return;
+        watermark = std::max(oldest, newest - window_ns);
+    }
+
+    auto order = [this](std::size_t a, std::size_t b) { return later(a, b); };
+    while (!heap.empty())
+    {
+        const std::size_t index = heap.front();
+        Source &src = *sources[index];
+        const Line &line = src.lines[src.next];
+        if (line.timestamp > watermark)
+            break;
+
+        std::pop_heap(heap.begin(), heap.end(), order);
+        heap.pop_back();
+        ++src.next;
+        if (src.next < src.lines.size())
+        {
+            heap.push_back(index);
+            std::push_heap(heap.begin(), heap.end(), order);
+        }
+        else
+        {
+            src.queued = false;
+        }
+
+        if (sink)
+        {
+            sink(std::string_view(src.arena.data() + line.offset, line.length), index,
+                 line.timestamp);
+        }
+    }
+}
+
+/**
+ * @brief Heap order: earliest head line first, ties by source index.
+ *
+ * @return true if @p a should come after @p b.
+ */
+bool MergedTail::later(std::size_t a, std::size_t b) const
+{
+    const Source &sa = *sources[a];
+    const Source &sb = *sources[b];
+    const std::int64_t ta = sa.lines[sa.next].timestamp;
+    const std::int64_t tb = sb.lines[sb.next].timestamp;
+    return ta != tb ? ta > tb : a > b;
+}
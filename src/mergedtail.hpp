@@ -0,0 +1,164 @@
+/**
+ * @file mergedtail.hpp
+ * @brief Merges the lines of many tailed logs into one timestamp-ordered stream.
+ *
+ * @details
+ * Each file is followed by its own MonitorFile. Appended lines are copied
+ * into a per-file byte arena and indexed by the timestamp parsed from
+ * their first bytes; lines without a timestamp inherit the previous one,
+ * so continuation lines stay with their entry. A binary heap over the
+ * head line of every file performs the K-way merge.
+ *
+ * Lines are released once they are older than a watermark: the oldest
+ * "latest timestamp" across files, but never more than the reorder window
+ * behind the newest. A file that stops writing therefore delays the
+ * stream by at most the window, and one that has not produced a
+ * timestamp yet (or cannot be read) does not delay it at all. flush()
+ * releases everything.
+ *
+ * Arenas and indexes are reused, so steady-state merging allocates
+ * nothing per line.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef MERGEDTAIL_HPP
+#define MERGEDTAIL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "monitorfile.hpp"
+
+/**
+ * @brief Parses a fixed-format timestamp at the start of @p text.
+ *
+ * @details
+ * Accepts @c YYYY-MM-DD, a single separator (@c 'T' or space) and
+ * @c HH:MM:SS, optionally followed by @c '.' or @c ',' and up to nine
+ * fraction digits. Time zone suffixes are ignored; times are read as UTC.
+ * Each field is read at a fixed position, with no locale or allocation.
+ *
+ * @param text Text starting with the timestamp.
+ * @return Nanoseconds since the Unix epoch, or std::nullopt if @p text
+ *         does not start with a timestamp.
+ */
+std::optional<std::int64_t> parse_timestamp(std::string_view text);
+
+/**
+ * @class MergedTail
+ * @brief K-way, timestamp-ordered merge of tailed files.
+ *
+ * @details
+ * The sink is called with an internal lock held, so lines arrive one at
+ * a time and in order even though files are read on different threads.
+ */
+class MergedTail
+{
+public:
+    /// Receives each line, the index of its file and its timestamp.
+    using Sink = std::function<void(std::string_view line, std::size_t source,
+                                    std::int64_t timestamp_ns)>;
+
+    /**
+     * @brief Creates an empty merge.
+     *
+     * @param sink Receives the ordered lines; views are valid only during the call.
+     * @param window Reorder window, in timestamp time.
+     * @param timestamp_offset Bytes before the timestamp in each line.
+     */
+    explicit MergedTail(Sink sink,
+                        std::chrono::milliseconds window = std::chrono::milliseconds(2000),
+                        std::size_t timestamp_offset = 0);
+
+    /**
+     * @brief Stops following every file; buffered lines are dropped.
+     */
+    ~MergedTail();
+
+    MergedTail(const MergedTail &) = delete;
+    MergedTail &operator=(const MergedTail &) = delete;
+
+    /**
+     * @brief Starts following @p path.
+     *
+     * @param path Log file to add.
+     * @param from_end Skip its existing contents (true) or merge them too.
+     * @return Index of the file in the stream, or std::nullopt if it
+     *         could not be monitored.
+     */
+    std::optional<std::size_t> add(const std::string &path, bool from_end = true);
+
+    /**
+     * @brief Releases every buffered line, in order.
+     */
+    void flush();
+
+    /**
+     * @brief Lines currently buffered across all files.
+     */
+    std::size_t buffered();
+
+private:
+    /**
+     * @brief Position of one buffered line in its file's arena.
+     */
+    struct Line
+    {
+        std::int64_t timestamp; ///< Parsed or inherited timestamp.
+        std::size_t offset;     ///< Start in the arena.
+        std::size_t length;     ///< Length in bytes.
+    };
+
+    /**
+     * @brief One followed file and its buffered lines.
+     */
+    struct Source
+    {
+        std::unique_ptr<MonitorFile> monitor;   ///< Follows the file.
+        std::vector<char> arena;                ///< Bytes of buffered lines.
+        std::vector<Line> lines;                ///< Buffered lines, oldest first.
+        std::size_t next = 0;                   ///< First unreleased entry in @ref lines.
+        std::int64_t latest = 0;                ///< Timestamp of the newest line seen.
+        bool seen = false;                      ///< Whether any timestamp was seen.
+        bool queued = false;                    ///< Whether the source is in the heap.
+    };
+
+    /**
+     * @brief Buffers a batch of lines from @p source.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void ingest(std::size_t source, const LineBatch &batch);
+
+    /**
+     * @brief Releases lines up to the watermark, or all when @p all.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void release(bool all);
+
+    /**
+     * @brief Heap order: earliest head line first, ties by source index.
+     */
+    bool later(std::size_t a, std::size_t b) const;
+
+    const Sink sink;                        ///< Ordered line consumer.
+    const std::int64_t window_ns;           ///< Reorder window.
+    const std::size_t timestamp_offset;     ///< Bytes before each timestamp.
+    std::mutex mutex;                       ///< Guards everything below.
+    std::vector<std::unique_ptr<Source>> sources; ///< Followed files.
+    std::vector<std::size_t> heap;          ///< Sources with buffered lines.
+};
+
+#endif // MERGEDTAIL_HPP
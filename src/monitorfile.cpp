@@ -8,17 +8,26 @@
  */
 
 #include "monitorfile.hpp"
-#include <iostream>
+
+#include <algorithm>
+
+#include "mailbox.hpp"
+#include "watchregistry.hpp"
 
 /**
  * @brief Constructs the MonitorFile object.
  *
- * Initializes monitoring flags and polling interval.
+ * Initializes the polling interval and an empty subscriber list.
  */
 MonitorFile::MonitorFile()
-    : stop_monitoring(false),
-      polling_interval(std::chrono::seconds(1)),
-      monitoring_state(MonitorState::NOT_MONITORING)
+    : polling_interval(std::chrono::seconds(1)),
+      backend(MonitorBackend::AUTO),
+      idle_state(MonitorState::NOT_MONITORING),
+      subscribers(std::make_shared<CallbackList>()),
+      activity(std::make_shared<ActivityList>()),
+      confirm(std::make_shared<ActivityList>()),
+      mapping(std::make_shared<MappingSlot>()),
+      content(std::make_shared<std::shared_ptr<SharedContent>>())
 {
 }
 
@@ -42,31 +51,57 @@ MonitorFile::~MonitorFile()
  */
 MonitorState MonitorFile::filemon(const std::string &fileName, std::function<void()> cb)
 {
+    detach();
+
     std::unique_lock<std::shared_mutex> lock(mutex);
 
-    if (monitoring_thread.joinable())
+    file_name = fileName;
+    if (mapping_enabled)
     {
-        stop();
+        mapping->set_path(fileName);
+        mapping->refresh();
     }
-
-    if (!fs::exists(fileName))
+    if (cb)
     {
-        monitoring_state.store(MonitorState::FILE_NOT_FOUND);
-        return MonitorState::FILE_NOT_FOUND;
+        primary_id = subscribers->replace(primary_id, ignore_token(std::move(cb)));
     }
 
-    file_name = fileName;
-    org_time = fs::last_write_time(file_name);
-    stable_checks = 0;
-    monitoring_state.store(MonitorState::MONITORING);
-
-    if (cb)
+    auto identity = FileIdentity::of(fileName);
+    if (!identity)
     {
-        callback = std::move(cb);
+        idle_state = MonitorState::FILE_NOT_FOUND;
+        return MonitorState::FILE_NOT_FOUND;
     }
 
-    stop_monitoring.store(false);
-    monitoring_thread = std::thread(&MonitorFile::monitor_loop, this);
+    watch = WatchRegistry::instance().acquire(fileName, *identity, polling_interval, backend);
+    std::atomic_store(content.get(), watch->content_cache());
+    // The listener holds the subscriber list, not this handle, so a dispatch
+    // racing with destruction never touches a dead MonitorFile.
+    listener_id = watch->subscribe([subs = subscribers, slot = mapping](const CancelToken &token) {
+        // Publish the new mapping first so callbacks already see it.
+        slot->refresh();
+        auto snapshot = subs->snapshot();
+        for (const auto &sub : *snapshot)
+        {
+            if (token.cancelled())
+                break;
+            sub.func(token);
+        }
+    });
+    activity_id = watch->subscribe_activity([acts = activity](const std::string &path) {
+        auto snapshot = acts->snapshot();
+        for (const auto &act : *snapshot)
+        {
+            act.func(path);
+        }
+    });
+    confirm_id = watch->subscribe_confirm([hooks = confirm](const std::string &path) {
+        auto snapshot = hooks->snapshot();
+        for (const auto &hook : *snapshot)
+        {
+            hook.func(path);
+        }
+    });
 
     return MonitorState::MONITORING;
 }
@@ -88,21 +123,18 @@ MonitorState MonitorFile::filemon(const std::string &fileName, std::function<voi
  * @note
  * - Requires appropriate system privileges (e.g., `CAP_SYS_NICE`) to apply real-time policies.
  * - This function should be called after the monitoring thread has started.
+ * - The thread is shared with every handle watching the same file.
  */
 bool MonitorFile::setPriority(int schedPolicy, int priority)
 {
-    // Ensure that the server thread is running.
-    if (!monitoring_thread.joinable())
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    // Ensure that the monitoring thread is running.
+    if (!watch)
     {
         return false;
     }
 
-    sched_param sch_params;
-    sch_params.sched_priority = priority;
-    // Attempt to apply the scheduling policy and priority
-    int ret = pthread_setschedparam(monitoring_thread.native_handle(), schedPolicy, &sch_params);
-
-    return (ret == 0);
+    return watch->set_priority(schedPolicy, priority);
 }
 
 /**
@@ -110,22 +142,68 @@ bool MonitorFile::setPriority(int schedPolicy, int priority)
  */
 void MonitorFile::stop()
 {
-    bool expected = false;
-    if (!stop_monitoring.compare_exchange_strong(expected, true))
-    {
-        return;
-    }
+    detach();
+}
 
+/**
+ * @brief Detaches from the shared watch.
+ *
+ * @details
+ * Removes this handle's listener (waiting for an in-flight dispatch to
+ * finish) and drops the reference; the last handle to let go stops the
+ * watch's thread, then waits for speculative loads and tail reads still
+ * running. The waits happen outside the handle lock so callbacks may still
+ * query this handle while it is being stopped.
+ */
+void MonitorFile::detach()
+{
+    std::shared_ptr<Watch> old_watch;
+    SubscriptionId old_listener = 0;
+    SubscriptionId old_activity = 0;
+    SubscriptionId old_confirm = 0;
     {
         std::unique_lock<std::shared_mutex> lock(mutex);
-        monitoring_state.store(MonitorState::NOT_MONITORING);
+        old_watch = std::move(watch);
+        watch.reset();
+        old_listener = listener_id;
+        listener_id = 0;
+        old_activity = activity_id;
+        activity_id = 0;
+        old_confirm = confirm_id;
+        confirm_id = 0;
+        idle_state = MonitorState::NOT_MONITORING;
+        std::atomic_store(content.get(), std::shared_ptr<SharedContent>());
     }
 
-    cv.notify_all();
+    if (old_watch)
+    {
+        old_watch->unsubscribe_activity(old_activity);
+        old_watch->unsubscribe_confirm(old_confirm);
+        old_watch->unsubscribe(old_listener);
+    }
 
-    if (monitoring_thread.joinable())
+    // No activity reaches the loads and followers now; wait for any still
+    // running.
+    std::vector<std::shared_ptr<SpeculativeLoad>> loads;
+    std::vector<std::shared_ptr<TailFollower>> tails;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto &entry : speculative)
+        {
+            loads.push_back(entry.second);
+        }
+        for (const auto &entry : followers)
+        {
+            tails.push_back(entry.second);
+        }
+    }
+    for (const auto &spec : loads)
+    {
+        spec->stop();
+    }
+    for (const auto &tail : tails)
     {
-        monitoring_thread.join();
+        tail->stop();
     }
 }
 
@@ -138,7 +216,47 @@ void MonitorFile::set_polling_interval(std::chrono::milliseconds interval)
 {
     std::unique_lock<std::shared_mutex> lock(mutex);
     polling_interval = interval;
-    cv.notify_all();
+    if (watch)
+    {
+        watch->set_polling_interval(interval);
+    }
+}
+
+/**
+ * @brief Selects the change notification backend.
+ *
+ * @param new_backend Backend to use.
+ */
+void MonitorFile::set_backend(MonitorBackend new_backend)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    backend = new_backend;
+    if (watch)
+    {
+        watch->set_backend(new_backend);
+    }
+}
+
+/**
+ * @brief Gets the backend in use.
+ *
+ * @return The watch's effective backend, or the configured one when idle.
+ */
+MonitorBackend MonitorFile::get_backend()
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return watch ? watch->get_backend() : backend;
+}
+
+/**
+ * @brief Gets the file system behind an AUTO selection.
+ *
+ * @return The watch's probe result, or std::nullopt when idle.
+ */
+std::optional<FilesystemInfo> MonitorFile::get_filesystem()
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return watch ? watch->filesystem() : std::nullopt;
 }
 
 /**
@@ -149,7 +267,7 @@ void MonitorFile::set_polling_interval(std::chrono::milliseconds interval)
 MonitorState MonitorFile::get_state()
 {
     std::shared_lock<std::shared_mutex> lock(mutex);
-    return monitoring_state;
+    return watch ? watch->get_state() : idle_state;
 }
 
 /**
@@ -160,86 +278,489 @@ MonitorState MonitorFile::get_state()
 void MonitorFile::set_callback(std::function<void()> func)
 {
     std::unique_lock<std::shared_mutex> lock(mutex);
-    callback = std::move(func);
+    if (!func)
+    {
+        subscribers->remove(primary_id);
+        primary_id = 0;
+        return;
+    }
+    primary_id = subscribers->replace(primary_id, ignore_token(std::move(func)));
 }
 
 /**
- * @brief Runs the monitoring loop to detect file changes.
+ * @brief Adds a subscriber to be called when the file changes.
+ *
+ * @param func The callback function.
+ * @return Identifier to pass to remove_callback().
  */
-void MonitorFile::monitor_loop()
+SubscriptionId MonitorFile::add_callback(std::function<void()> func)
 {
-    std::unique_lock<std::shared_mutex> lock(mutex);
-    // Initialize last_reported_time so we never treat the very first timestamp
-    // as “new” when it's actually just our starting point.
-    fs::file_time_type last_reported_time = org_time.value();
+    return subscribers->add(ignore_token(std::move(func)));
+}
 
-    // This flag tracks whether we've seen a write > org_time yet.
-    bool change_detected = false;
-    stable_checks = 0;
+/**
+ * @brief Adds a subscriber that receives a cancellation token.
+ *
+ * @param func The callback function.
+ * @return Identifier to pass to remove_callback().
+ */
+SubscriptionId MonitorFile::add_cancellable_callback(std::function<void(const CancelToken &)> func)
+{
+    return subscribers->add(std::move(func));
+}
 
-    while (!stop_monitoring.load())
-    {
-        // wait_for returns true if predicate (stop) becomes true
-        cv.wait_for(lock, polling_interval, [this] {
-            return stop_monitoring.load();
-        });
-        if (stop_monitoring.load())
+/**
+ * @brief Adds a subscriber that receives the file's new contents.
+ *
+ * @param func Callback receiving the contents.
+ * @return Identifier to pass to remove_callback().
+ */
+SubscriptionId MonitorFile::add_content_callback(std::function<void(const FileContent &)> func)
+{
+    return subscribers->add([cache = content, func = std::move(func)](const CancelToken &token) {
+        // The watch's cache, so handles sharing the watch share one read.
+        auto shared = std::atomic_load(cache.get());
+        if (!shared)
+        {
             return;
+        }
+        if (auto data = shared->get(token))
+        {
+            func(*data);
+        }
+    });
+}
+
+/**
+ * @brief Adds a subscriber that receives lines appended to the file.
+ *
+ * @details
+ * The reader runs on a TailFollower registered through add_follower().
+ *
+ * @param sink Receives batches of complete lines.
+ * @param from_end Skip the existing contents.
+ * @param registry Optional persistent position store.
+ * @return Identifier to pass to remove_callback(), or 0 if not monitoring.
+ */
+SubscriptionId MonitorFile::add_tail_callback(TailReader::Sink sink, bool from_end,
+                                              std::shared_ptr<TailRegistry> registry)
+{
+    std::string path;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        path = file_name;
+    }
+    if (path.empty())
+    {
+        return 0;
+    }
+
+    auto reader = std::make_shared<TailReader>(path, from_end);
+    reader->set_registry(std::move(registry));
+    auto follower = std::make_shared<TailFollower>(
+        [reader, sink = std::move(sink)](bool) { reader->poll(sink); });
+    return add_follower(std::move(follower));
+}
+
+/**
+ * @brief Adds a subscriber that receives whole multi-line records.
+ *
+ * @param starts Recognizes the first line of a record.
+ * @param sink Receives each record.
+ * @param from_end Skip the existing contents.
+ * @return Identifier to pass to remove_callback(), or 0 if not monitoring.
+ */
+SubscriptionId MonitorFile::add_record_callback(PrefixMatcher starts, RecordAssembler::Sink sink,
+                                                bool from_end)
+{
+    std::string path;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        path = file_name;
+    }
+    if (path.empty())
+    {
+        return 0;
+    }
+
+    auto reader = std::make_shared<TailReader>(path, from_end);
+    auto assembler = std::make_shared<RecordAssembler>(std::move(starts), std::move(sink));
+    auto feed = [assembler](const LineBatch &lines) { assembler->feed(lines); };
 
-        if (!fs::exists(file_name))
+    // Feeding and flushing both happen on the follower, so they never race.
+    return add_follower(std::make_shared<TailFollower>([reader, assembler, feed](bool settled) {
+        reader->poll(feed);
+        if (settled)
         {
-            monitoring_state.store(MonitorState::FILE_NOT_FOUND);
-            continue;
+            assembler->flush();
         }
+    }));
+}
 
-        // release lock while we sleep to allow set_polling_interval / stop()
-        lock.unlock();
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        lock.lock();
+/**
+ * @brief Adds a subscriber that follows the file through a shared UringReader.
+ *
+ * @details
+ * The step holds a membership whose destructor removes the file from the
+ * reader, so the file stops being read once the follower is gone.
+ *
+ * @param reader Reader shared between monitors.
+ * @param sink Receives this file's lines.
+ * @param from_end Skip the existing contents.
+ * @return Identifier to pass to remove_callback(), or 0 if not monitoring.
+ */
+SubscriptionId MonitorFile::add_uring_tail_callback(std::shared_ptr<UringReader> reader,
+                                                    UringReader::Sink sink, bool from_end)
+{
+    std::string path;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        path = file_name;
+    }
+    if (path.empty() || !reader || !reader->add(path, from_end, std::move(sink)))
+    {
+        return 0;
+    }
 
-        auto last_write = fs::last_write_time(file_name);
+    struct Membership
+    {
+        std::shared_ptr<UringReader> reader;
+        std::string path;
+        ~Membership() { reader->remove(path); }
+    };
+    auto membership = std::make_shared<Membership>();
+    membership->reader = std::move(reader);
+    membership->path = path;
 
-        if (!change_detected)
+    // Every file of the reader is read; each is handed to its own sink.
+    return add_follower(std::make_shared<TailFollower>(
+        [membership](bool) { membership->reader->poll(UringReader::Sink()); }));
+}
+
+/**
+ * @brief Adds a trigger that fires on patterns in appended lines.
+ *
+ * @details
+ * Lines framed from one read are adjacent in the reader's buffer, so each
+ * run of adjacent lines is scanned as one block and matches are mapped
+ * back to their line by binary search.
+ *
+ * @param matcher Compiled patterns.
+ * @param on_match Called per occurrence.
+ * @param from_end Skip the existing contents.
+ * @return Identifier to pass to remove_callback(), or 0 if not monitoring.
+ */
+SubscriptionId MonitorFile::add_trigger_callback(
+    std::shared_ptr<const MultiMatcher> matcher,
+    std::function<void(std::size_t pattern, std::string_view line)> on_match, bool from_end)
+{
+    auto scan = [matcher, on_match = std::move(on_match)](const LineBatch &lines) {
+        std::size_t first = 0;
+        while (first < lines.size())
         {
-            // Haven't seen any write > org_time yet
-            if (last_write > org_time.value())
+            std::size_t last = first;
+            while (last + 1 < lines.size() &&
+                   lines[last + 1].data() == lines[last].data() + lines[last].size() + 1)
             {
-                change_detected = true;
-                org_time = last_write;
-                stable_checks = 0;      // start counting stability from here
+                ++last;
             }
-            // ELSE: still no change — keep waiting
-            continue;
+
+            const char *begin = lines[first].data();
+            const char *end = lines[last].data() + lines[last].size();
+            auto run_begin = lines.begin() + static_cast<std::ptrdiff_t>(first);
+            auto run_end = lines.begin() + static_cast<std::ptrdiff_t>(last + 1);
+            matcher->scan(std::string_view(begin, static_cast<std::size_t>(end - begin)),
+                          [&](std::size_t pattern, std::size_t offset) {
+                              const char *at = begin + offset;
+                              auto line = std::upper_bound(
+                                  run_begin, run_end, at,
+                                  [](const char *p, std::string_view l) { return p < l.data(); });
+                              on_match(pattern, *(line - 1));
+                          });
+            first = last + 1;
         }
+    };
+    return add_tail_callback(std::move(scan), from_end);
+}
+
+/**
+ * @brief Adds a subscriber that receives the byte ranges each change touched.
+ *
+ * @details
+ * The map of the previous version is kept with the subscriber; a change
+ * whose comparison fails (file gone) keeps the old map so the next
+ * successful one reports everything since.
+ *
+ * @param func Receives the changed ranges.
+ * @param block_size Granularity of the comparison.
+ * @param mode Page-cache treatment of the reads.
+ * @return Identifier to pass to remove_callback(), or 0 if not monitoring.
+ */
+SubscriptionId MonitorFile::add_region_callback(std::function<void(const std::vector<ByteRange> &)> func,
+                                                std::size_t block_size, ReadMode mode)
+{
+    std::string path;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        path = file_name;
+    }
+    if (path.empty())
+    {
+        return 0;
+    }
+
+    struct State
+    {
+        std::mutex mutex;
+        RegionMap map;
+        std::vector<ByteRange> changed;
+    };
+    auto state = std::make_shared<State>();
+    if (auto initial = map_regions(path, block_size, nullptr, mode))
+    {
+        state->map = std::move(*initial);
+    }
+    else
+    {
+        state->map.block_size = block_size;
+    }
+
+    return subscribers->add([state, path, mode, func = std::move(func)](const CancelToken &) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto next = diff_regions(state->map, path, state->changed, nullptr, mode);
+        if (!next)
+        {
+            return;
+        }
+        state->map = std::move(*next);
+        if (!state->changed.empty())
+        {
+            func(state->changed);
+        }
+    });
+}
 
-        // Once we've detected a write, watch for stable intervals
-        if (last_write > org_time.value())
+/**
+ * @brief Snapshots every confirmed version of the file into @p store.
+ *
+ * @details
+ * The confirm entry captures and records the snapshot; the regular entry,
+ * registered under the same id, reports the newest one from the dispatch
+ * thread.
+ *
+ * @param store Where snapshots are kept.
+ * @param func Optional; receives the path of the newest snapshot.
+ * @return Identifier to pass to remove_callback().
+ */
+SubscriptionId MonitorFile::add_snapshot_callback(std::shared_ptr<SnapshotStore> store,
+                                                  std::function<void(const std::string &)> func)
+{
+    struct Latest
+    {
+        std::mutex mutex;
+        std::optional<std::string> path;
+    };
+    auto latest = std::make_shared<Latest>();
+
+    SubscriptionId id = subscribers->add([latest, func = std::move(func)](const CancelToken &) {
+        std::optional<std::string> taken;
         {
-            // file changed again before stabilizing
-            org_time = last_write;
-            stable_checks = 0;
+            std::lock_guard<std::mutex> lock(latest->mutex);
+            taken.swap(latest->path);
         }
-        else
+        if (taken && func)
         {
-            // file unchanged since last write
-            if (++stable_checks >= 3 && last_write != last_reported_time)
+            func(*taken);
+        }
+    });
+    confirm->add_as(id, [store = std::move(store), latest](const std::string &path) {
+        if (auto snapshot = store->capture(path))
+        {
+            std::lock_guard<std::mutex> lock(latest->mutex);
+            latest->path = std::move(snapshot);
+        }
+    });
+    return id;
+}
+
+/**
+ * @brief Adds a subscriber delivered through the calling thread's mailbox.
+ *
+ * @details
+ * The monitor thread only posts into the channel; @p func is invoked by
+ * Mailbox::drain() on the thread that called this function.
+ *
+ * @param func The callback function.
+ * @return Identifier to pass to remove_callback().
+ */
+SubscriptionId MonitorFile::add_home_callback(std::function<void()> func)
+{
+    auto handler = std::make_shared<std::function<void()>>(std::move(func));
+    auto channel = Mailbox::open([handler] { (*handler)(); });
+    return subscribers->add([channel, handler](const CancelToken &) {
+        channel->post([handler] { (*handler)(); });
+    });
+}
+
+/**
+ * @brief Removes a subscriber.
+ *
+ * @param id Identifier returned when the subscriber was added.
+ * @return true if the subscriber was removed.
+ */
+bool MonitorFile::remove_callback(SubscriptionId id)
+{
+    activity->remove(id);
+    confirm->remove(id);
+    bool removed = subscribers->remove(id);
+
+    std::shared_ptr<SpeculativeLoad> spec;
+    std::shared_ptr<TailFollower> follower;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (auto it = speculative.begin(); it != speculative.end(); ++it)
+        {
+            if (it->first == id)
             {
-                last_reported_time = last_write;
-                monitoring_state.store(MonitorState::FILE_CHANGED);
-
-                // invoke callback outside the lock
-                if (callback)
-                {
-                    lock.unlock();
-                    callback();
-                    lock.lock();
-                }
-
-                // reset for the next change
-                monitoring_state.store(MonitorState::MONITORING);
-                stable_checks = 0;
-                change_detected = false;
+                spec = std::move(it->second);
+                speculative.erase(it);
+                break;
             }
         }
+        for (auto it = followers.begin(); it != followers.end(); ++it)
+        {
+            if (it->first == id)
+            {
+                follower = std::move(it->second);
+                followers.erase(it);
+                break;
+            }
+        }
+    }
+    // A notification already under way may still call begin() or wake();
+    // close() makes that a no-op.
+    if (spec)
+    {
+        spec->close();
+    }
+    if (follower)
+    {
+        follower->close();
+    }
+    return removed;
+}
+
+/**
+ * @brief Reads the monitored file without observing a partial write.
+ *
+ * @param options Retry policy.
+ * @return The contents and matching fingerprint, or std::nullopt.
+ */
+std::optional<FileContent> MonitorFile::load(const LoadOptions &options) const
+{
+    std::string path;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        path = file_name;
+    }
+    if (path.empty())
+    {
+        return std::nullopt;
+    }
+    return load_file(path, options);
+}
+
+/**
+ * @brief Enables or disables the managed mapping.
+ *
+ * @param enable true to keep a mapping, false to drop it.
+ * @return true if a mapping is available after the call.
+ */
+bool MonitorFile::enable_mapping(bool enable)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    mapping_enabled = enable;
+    if (!enable)
+    {
+        mapping->set_path(std::string());
+        mapping->reset();
+        return false;
+    }
+    mapping->set_path(file_name);
+    mapping->refresh();
+    return mapping->current() != nullptr;
+}
+
+/**
+ * @brief Returns the newest mapping of the monitored file.
+ *
+ * @return The mapping, or nullptr if none is published.
+ */
+std::shared_ptr<const MappedFile> MonitorFile::mapped() const
+{
+    return mapping->current();
+}
+
+/**
+ * @brief Registers a speculative load/commit pair.
+ *
+ * @details
+ * The pair appears in both subscriber lists under one identifier: the
+ * activity entry starts attempts during debouncing and the regular entry
+ * commits on confirmation.
+ *
+ * @param load Type-erased load function.
+ * @param commit Type-erased commit function.
+ * @return Identifier to pass to remove_callback().
+ */
+SubscriptionId MonitorFile::add_speculative(SpeculativeLoad::LoadFn load,
+                                            SpeculativeLoad::CommitFn commit)
+{
+    auto spec = std::make_shared<SpeculativeLoad>(std::move(load), std::move(commit));
+    SubscriptionId id = subscribers->add([spec](const CancelToken &token) {
+        spec->confirm(token);
+    });
+    activity->add_as(id, [spec](const std::string &path) { spec->begin(path); });
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    speculative.emplace_back(id, std::move(spec));
+    return id;
+}
+
+/**
+ * @brief Registers a tail follower.
+ *
+ * @details
+ * Like add_speculative(), the follower appears in both subscriber lists
+ * under one identifier; both entries only wake it, so the polling thread
+ * never reads the file or runs a sink.
+ *
+ * @param follower Follower running the subscriber's reads.
+ * @return Identifier to pass to remove_callback().
+ */
+SubscriptionId MonitorFile::add_follower(std::shared_ptr<TailFollower> follower)
+{
+    SubscriptionId id = subscribers->add([follower](const CancelToken &) {
+        follower->wake(true);
+    });
+    activity->add_as(id, [follower](const std::string &) { follower->wake(false); });
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    followers.emplace_back(id, std::move(follower));
+    return id;
+}
+
+/**
+ * @brief Adapts a plain callback to the token-taking signature.
+ *
+ * @param func Callback taking no arguments.
+ * @return Wrapper that ignores the token, or an empty function.
+ */
+MonitorFile::Callback MonitorFile::ignore_token(std::function<void()> func)
+{
+    if (!func)
+    {
+        return nullptr;
     }
+    return [func = std::move(func)](const CancelToken &) { func(); };
 }
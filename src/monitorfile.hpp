@@ -14,28 +14,27 @@
 #ifndef MONITORFILE_HPP
 #define MONITORFILE_HPP
 
-#include <atomic>
 #include <chrono>
-#include <condition_variable>
-#include <filesystem>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <shared_mutex>
-#include <thread>
+#include <string>
+#include <utility>
+#include <vector>
 
-namespace fs = std::filesystem;
-
-/**
- * @enum MonitorState
- * @brief Represents the possible states of the file monitoring process.
- */
-enum class MonitorState
-{
-    NOT_MONITORING, ///< Monitoring has been stopped.
-    MONITORING,     ///< Monitoring is active, file exists, no recent changes.
-    FILE_NOT_FOUND, ///< The file does not exist.
-    FILE_CHANGED    ///< The file was modified and has stabilized.
-};
+#include "contentloader.hpp"
+#include "mappedfile.hpp"
+#include "multimatcher.hpp"
+#include "recordassembler.hpp"
+#include "regiondiff.hpp"
+#include "snapshotstore.hpp"
+#include "speculativeload.hpp"
+#include "subscriberlist.hpp"
+#include "tailfollower.hpp"
+#include "tailreader.hpp"
+#include "uringreader.hpp"
+#include "watch.hpp"
 
 /**
  * @class MonitorFile
@@ -43,7 +42,12 @@ enum class MonitorState
  *
  * @details
  * Periodically checks the modification timestamp of a given file and reports
- * changes after a stable period. Can trigger a callback when a change is detected.
+ * changes after a stable period. Any number of callbacks can subscribe; one
+ * detected change is fanned out to all of them.
+ *
+ * MonitorFile is a handle onto a shared Watch. Handles that refer to the
+ * same file by device and inode, whatever path was used to open it, share
+ * one polling thread and one detection.
  */
 class MonitorFile
 {
@@ -71,12 +75,17 @@ public:
      *
      * @note
      * If a callback is not provided here, it can be set later using set_callback().
+     * If another MonitorFile already watches the same file (same device and
+     * inode), this handle attaches to that watch instead of starting a new one.
      */
     MonitorState filemon(const std::string &fileName, std::function<void()> cb = nullptr);
 
     /**
      * @brief Sets the scheduling policy and priority of the monitor thread.
      *
+     * @details
+     * The thread is shared by every handle watching the same file.
+     *
      * @param schedPolicy The thread scheduling policy (e.g., SCHED_FIFO).
      * @param priority The priority value for the thread.
      * @return true if the scheduling parameters were successfully applied.
@@ -90,7 +99,9 @@ public:
      * @brief Stops the file monitoring thread.
      *
      * @details
-     * Signals the monitoring loop to exit and joins the background thread.
+     * Detaches this handle from its watch. The background thread is
+     * stopped and joined once no other handle uses the watch. No callback
+     * of this handle runs after stop() returns.
      */
     void stop();
 
@@ -99,10 +110,44 @@ public:
      *
      * @param interval Polling interval in milliseconds.
      *
-     * @note Default polling interval is implementation-defined.
+     * @note Default polling interval is implementation-defined. Handles
+     * sharing a watch share its interval; the most recent call wins.
      */
     void set_polling_interval(std::chrono::milliseconds interval);
 
+    /**
+     * @brief Selects how changes are noticed.
+     *
+     * @details
+     * MonitorBackend::INOTIFY and MonitorBackend::FANOTIFY sleep until the
+     * kernel reports activity on the file instead of polling.
+     * MonitorBackend::AUTO picks per file system: an event backend on
+     * local ones, and polling on NFS, CIFS, FUSE and other mounts where
+     * writes from elsewhere raise no events, with the polling interval
+     * raised to at least the mount's attribute cache lifetime. Handles
+     * sharing a watch share its backend; the most recent call wins.
+     *
+     * @param backend Backend to use; defaults to MonitorBackend::AUTO.
+     */
+    void set_backend(MonitorBackend backend);
+
+    /**
+     * @brief Retrieves the backend in use.
+     *
+     * @return The effective backend of the watch; never AUTO while
+     *         monitoring. This is POLLING when an event backend was
+     *         requested but the file could not be registered.
+     */
+    MonitorBackend get_backend();
+
+    /**
+     * @brief Retrieves the file system AUTO based its choice on.
+     *
+     * @return The probe result, or std::nullopt when not monitoring, when
+     *         another backend was selected, or when the probe failed.
+     */
+    std::optional<FilesystemInfo> get_filesystem();
+
     /**
      * @brief Retrieves the current monitoring state.
      *
@@ -113,30 +158,328 @@ public:
     /**
      * @brief Sets a callback function to be called when the file changes.
      *
+     * @details
+     * Replaces the callback previously installed by set_callback() or
+     * filemon(). Subscribers added with add_callback() are not affected.
+     * Passing an empty function removes the callback.
+     *
      * @param func Callback function taking no arguments.
      */
     void set_callback(std::function<void()> func);
 
-private:
     /**
-     * @brief Internal thread function that runs the monitoring loop.
+     * @brief Adds a subscriber to be called when the file changes.
+     *
+     * @details
+     * Every subscriber is invoked once per detected change, in the order
+     * they were added. Adding or removing subscribers never blocks a
+     * dispatch in progress; a dispatch that has already started uses the
+     * subscriber set as it was when the change was confirmed.
+     *
+     * @param func Callback function taking no arguments.
+     * @return Identifier to pass to remove_callback().
+     */
+    SubscriptionId add_callback(std::function<void()> func);
+
+    /**
+     * @brief Adds a subscriber that can abandon stale work.
+     *
+     * @details
+     * Callbacks run on the watch's dispatch thread, so detection continues
+     * while they run. If a newer change is confirmed before @p func
+     * returns, the token it was given reports cancelled(); @p func may
+     * return early and is then invoked again right away for the newer
+     * change.
+     *
+     * @param func Callback taking the token for the change it handles.
+     * @return Identifier to pass to remove_callback().
+     */
+    SubscriptionId add_cancellable_callback(std::function<void(const CancelToken &)> func);
+
+    /**
+     * @brief Adds a subscriber whose load overlaps the debounce wait.
+     *
+     * @details
+     * @p load starts on the subscriber's worker thread as soon as a change
+     * is first seen, while the monitor is still waiting for the file to
+     * settle. Only the newest attempt is queued behind the one running.
+     * When the change is confirmed, @p commit receives the speculative
+     * result if the file's fingerprint is unchanged since the load
+     * started; otherwise @p load runs again on the dispatch thread first.
+     * Activity during the wait cancels the running attempt through its
+     * token. Results from cancelled attempts are never committed.
+     *
+     * @tparam T Result type of the load; must be move constructible.
+     * @param load Reads and parses the file; should poll the token.
+     * @param commit Publishes a result; runs on the dispatch thread.
+     * @return Identifier to pass to remove_callback().
+     */
+    template <typename T>
+    SubscriptionId add_speculative_callback(std::function<T(const CancelToken &)> load,
+                                            std::function<void(T &)> commit)
+    {
+        return add_speculative(
+            [load = std::move(load)](const CancelToken &token) -> std::shared_ptr<void> {
+                T value = load(token);
+                if (token.cancelled())
+                    return nullptr;
+                return std::make_shared<T>(std::move(value));
+            },
+            [commit = std::move(commit)](const std::shared_ptr<void> &result) {
+                commit(*std::static_pointer_cast<T>(result));
+            });
+    }
+
+    /**
+     * @brief Adds a subscriber that receives the file's new contents.
+     *
+     * @details
+     * The file is read once per change, with load(), and every content
+     * subscriber of every handle watching the file receives the same
+     * immutable buffer. Subscribers are
+     * skipped for a change whose contents could not be read consistently.
+     *
+     * @param func Callback receiving the contents.
+     * @return Identifier to pass to remove_callback().
+     */
+    SubscriptionId add_content_callback(std::function<void(const FileContent &)> func);
+
+    /**
+     * @brief Adds a subscriber that receives lines appended to the file.
+     *
+     * @details
+     * A TailReader follows the file monitored by the last filemon() call.
+     * Appended data is read as soon as activity is seen, without waiting
+     * for the file to settle, and again when the change is confirmed. The
+     * reads and @p sink run on a TailFollower thread owned by the
+     * subscriber, never on the watch's threads, so a slow sink delays no
+     * change detection. The views in each batch point into the reader's
+     * buffer and are valid only during the call.
+     *
+     * With a @p registry, progress is saved after every batch and a
+     * restarted process resumes where the previous one stopped; @p from_end
+     * then only applies to files the registry does not know.
+     *
+     * @param sink Receives batches of complete lines.
+     * @param from_end Skip the existing contents (true) or deliver them first.
+     * @param registry Optional persistent position store.
+     * @return Identifier to pass to remove_callback(), or 0 if no file is
+     *         being monitored.
+     */
+    SubscriptionId add_tail_callback(TailReader::Sink sink, bool from_end = true,
+                                     std::shared_ptr<TailRegistry> registry = nullptr);
+
+    /**
+     * @brief Adds a subscriber that receives whole multi-line records.
+     *
+     * @details
+     * Appended lines are followed as with add_tail_callback() and grouped
+     * by a RecordAssembler: a line accepted by @p starts begins a record,
+     * any other line continues the current one. The final record of a
+     * burst is emitted once the change is confirmed, i.e. after the file
+     * has been quiet for the debounce window. Reads and @p sink run on the
+     * subscriber's TailFollower thread.
+     *
+     * @param starts Recognizes the first line of a record.
+     * @param sink Receives each record; the view is valid only during the call.
+     * @param from_end Skip the existing contents (true) or deliver them first.
+     * @return Identifier to pass to remove_callback(), or 0 if no file is
+     *         being monitored.
+     */
+    SubscriptionId add_record_callback(PrefixMatcher starts, RecordAssembler::Sink sink,
+                                       bool from_end = true);
+
+    /**
+     * @brief Adds a subscriber that follows the file through a shared UringReader.
      *
      * @details
-     * Compares the file's last modification time periodically and detects
-     * stabilized changes. Executes callback if change is confirmed.
+     * The file is added to @p reader with @p sink as its own sink, and
+     * activity or a confirmed change polls @p reader on the subscriber's
+     * TailFollower thread. One poll reads every file the reader follows in
+     * a single batch, so monitors sharing a reader read all of their files
+     * together; each @p sink therefore runs on the follower of whichever
+     * monitor triggered the poll, one poll at a time. The file leaves
+     * @p reader when the subscriber is removed.
+     *
+     * @param reader Reader shared between monitors.
+     * @param sink Receives batches of this file's lines; the views are
+     *        valid only during the call.
+     * @param from_end Skip the existing contents (true) or deliver them first.
+     * @return Identifier to pass to remove_callback(), or 0 if no file is
+     *         being monitored or @p reader already follows it.
+     */
+    SubscriptionId add_uring_tail_callback(std::shared_ptr<UringReader> reader,
+                                           UringReader::Sink sink, bool from_end = true);
+
+    /**
+     * @brief Adds a trigger that fires on patterns in appended lines.
+     *
+     * @details
+     * Only bytes appended since the previous check are scanned, each batch
+     * in a single pass of @p matcher over the read buffer. @p on_match
+     * receives the index of the pattern (see MultiMatcher::pattern()) and
+     * the line it starts in, once per occurrence. Threading is as for
+     * add_tail_callback().
+     *
+     * @param matcher Compiled patterns; may be shared between monitors.
+     * @param on_match Called per occurrence; the view is valid only during the call.
+     * @param from_end Skip the existing contents (true) or scan them first.
+     * @return Identifier to pass to remove_callback(), or 0 if no file is
+     *         being monitored.
+     */
+    SubscriptionId add_trigger_callback(std::shared_ptr<const MultiMatcher> matcher,
+                                        std::function<void(std::size_t pattern,
+                                                           std::string_view line)> on_match,
+                                        bool from_end = true);
+
+    /**
+     * @brief Adds a subscriber that receives the byte ranges each change touched.
+     *
+     * @details
+     * The current version is mapped when the callback is added. Each
+     * confirmed change is compared against the previous version with
+     * diff_regions(), which only hashes blocks the extent layout cannot
+     * prove unchanged. Changes that touched no block are not reported.
+     *
+     * @param func Receives the changed ranges, merged and in order.
+     * @param block_size Granularity of the comparison in bytes.
+     * @param mode Page-cache treatment of the reads; ReadMode::AUTO keeps
+     *        hashing a huge file from evicting the service's cached data.
+     * @return Identifier to pass to remove_callback(), or 0 if no file is
+     *         being monitored.
+     */
+    SubscriptionId add_region_callback(std::function<void(const std::vector<ByteRange> &)> func,
+                                       std::size_t block_size = 1 << 20,
+                                       ReadMode mode = ReadMode::CACHED);
+
+    /**
+     * @brief Snapshots every confirmed version of the file into @p store.
+     *
+     * @details
+     * The snapshot is taken on the polling thread the moment the change is
+     * confirmed, before subscribers run and before the file is checked
+     * again, so no version is skipped even when dispatches coalesce. On
+     * copy-on-write file systems it is a reflink and copies no data.
+     * @p func then runs on the dispatch thread with the newest snapshot.
+     *
+     * @param store Where snapshots are kept; may be shared between monitors.
+     * @param func Optional; receives the path of the newest snapshot.
+     * @return Identifier to pass to remove_callback().
+     */
+    SubscriptionId add_snapshot_callback(std::shared_ptr<SnapshotStore> store,
+                                         std::function<void(const std::string &)> func = nullptr);
+
+    /**
+     * @brief Adds a subscriber that runs on the calling (home) thread.
+     *
+     * @details
+     * Each detected change is posted into a lock-free SPSC mailbox owned
+     * by the calling thread instead of running @p func on the monitor
+     * thread. The home thread runs pending callbacks when it calls
+     * Mailbox::drain(), at a point of its choosing, so @p func never needs
+     * to lock anything it shares with that thread.
+     *
+     * @param func Callback function taking no arguments.
+     * @return Identifier to pass to remove_callback().
+     */
+    SubscriptionId add_home_callback(std::function<void()> func);
+
+    /**
+     * @brief Reads the monitored file without observing a partial write.
+     *
+     * @details
+     * Meant for use inside callbacks in place of a plain read followed by a
+     * safety sleep. See load_file() for the retry behavior.
+     *
+     * @param options Retry policy.
+     * @return The contents and the fingerprint they correspond to, or
+     *         std::nullopt if no file is set or it kept changing.
+     */
+    std::optional<FileContent> load(const LoadOptions &options = {}) const;
+
+    /**
+     * @brief Keeps a read-only memory mapping of the monitored file.
+     *
+     * @details
+     * While enabled, every confirmed change maps the new version of the
+     * file and publishes it before any callback runs. Readers of older
+     * versions keep their mapping until they release it. Best suited to
+     * files that writers replace rather than modify in place; a reader
+     * touching a mapping of a file truncated in place gets SIGBUS (see
+     * mappedfile.hpp), after which the monitor copies instead of mapping.
+     *
+     * @param enable true to keep a mapping, false to drop it.
+     * @return true if a mapping is available after the call.
+     */
+    bool enable_mapping(bool enable = true);
+
+    /**
+     * @brief Returns the newest mapping of the monitored file.
+     *
+     * @return The mapping, or nullptr if mapping is disabled or failed.
+     */
+    std::shared_ptr<const MappedFile> mapped() const;
+
+    /**
+     * @brief Removes a subscriber added with any of the add_*callback() functions.
+     *
+     * @details
+     * For a speculative subscriber, waits for a load still running in the
+     * background, so its load function is not called after this returns.
+     *
+     * @param id Identifier returned when the subscriber was added.
+     * @return true if the subscriber was found and removed.
+     */
+    bool remove_callback(SubscriptionId id);
+
+private:
+    /**
+     * @brief Detaches from the current watch, if any.
+     *
+     * @note Caller must not hold @ref mutex.
+     */
+    void detach();
+
+    using Callback = std::function<void(const CancelToken &)>;
+    using CallbackList = SubscriberList<Callback>;
+    using ActivityList = SubscriberList<Watch::ActivityListener>;
+
+    /**
+     * @brief Registers a type-erased speculative load/commit pair.
+     */
+    SubscriptionId add_speculative(SpeculativeLoad::LoadFn load, SpeculativeLoad::CommitFn commit);
+
+    /**
+     * @brief Registers a follower that runs a tail subscriber's reads.
+     */
+    SubscriptionId add_follower(std::shared_ptr<TailFollower> follower);
+
+    /**
+     * @brief Adapts a plain callback to the token-taking signature.
      */
-    void monitor_loop();
+    static Callback ignore_token(std::function<void()> func);
 
-    std::string file_name;                      ///< Path of the file being monitored.
-    std::optional<fs::file_time_type> org_time; ///< Last known modification timestamp.
-    std::thread monitoring_thread;              ///< Thread for running monitor loop.
-    std::atomic<bool> stop_monitoring;          ///< Signals monitoring loop to terminate.
+    std::string file_name;                      ///< Path passed to filemon().
+    std::shared_ptr<Watch> watch;               ///< Shared watch, empty when not monitoring.
+    SubscriptionId listener_id = 0;             ///< This handle's listener on the watch.
+    SubscriptionId activity_id = 0;             ///< This handle's activity listener.
+    SubscriptionId confirm_id = 0;              ///< This handle's confirm listener.
     std::chrono::milliseconds polling_interval; ///< Interval between file checks.
-    std::atomic<MonitorState> monitoring_state; ///< Tracks current monitor state.
-    std::function<void()> callback;             ///< Optional callback on file change.
-    mutable std::shared_mutex mutex;            ///< Protects shared access to file state.
-    std::condition_variable_any cv;             ///< Condition variable for timing/sleep.
-    int stable_checks = 0;                      ///< Counts stable intervals before confirming change.
+    MonitorBackend backend;                     ///< Backend for newly created watches.
+    MonitorState idle_state;                    ///< State reported while detached.
+    std::shared_ptr<CallbackList> subscribers;  ///< Callbacks invoked on file change.
+    std::shared_ptr<ActivityList> activity;     ///< Speculative loads, keyed like subscribers.
+    std::shared_ptr<ActivityList> confirm;      ///< Run at confirmation, keyed like subscribers.
+    std::shared_ptr<MappingSlot> mapping;       ///< Published mapping of the file.
+    std::shared_ptr<std::shared_ptr<SharedContent>>
+        content;                                ///< Attached watch's content cache; atomic access.
+    bool mapping_enabled = false;               ///< Set by enable_mapping().
+    SubscriptionId primary_id = 0;              ///< Subscriber slot owned by set_callback().
+    std::vector<std::pair<SubscriptionId, std::shared_ptr<SpeculativeLoad>>>
+        speculative;                            ///< Loads from add_speculative(), stopped on detach.
+    std::vector<std::pair<SubscriptionId, std::shared_ptr<TailFollower>>>
+        followers;                              ///< Tail readers' threads, stopped on detach.
+    mutable std::shared_mutex mutex;            ///< Protects handle state.
 };
 
 #endif // MONITORFILE_HPP
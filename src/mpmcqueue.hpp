@@ -0,0 +1,154 @@
+/**
+ * @file mpmcqueue.hpp
+ * @brief Bounded lock-free multi-producer/multi-consumer queue.
+ *
+ * @details
+ * Dmitry Vyukov's bounded MPMC design: every cell carries a sequence
+ * number that tells producers and consumers whether the cell is free or
+ * full for their lap, so each push or pop costs one compare-and-swap on
+ * the shared index plus one store to the cell. The enqueue and dequeue
+ * indices live on separate cache lines. Large queues take their cells
+ * from PageAllocator.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef MPMCQUEUE_HPP
+#define MPMCQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "pagealloc.hpp"
+
+/**
+ * @class MpmcQueue
+ * @brief Fixed-capacity MPMC queue.
+ *
+ * @tparam T Element type; must be default constructible and movable.
+ */
+template <typename T>
+class MpmcQueue
+{
+public:
+    /**
+     * @brief Creates a queue.
+     *
+     * @param capacity Requested capacity, rounded up to a power of two.
+     * @param numa_node Node for the cells, or -1 for the calling thread's.
+     */
+    explicit MpmcQueue(std::size_t capacity, int numa_node = -1)
+        : cells(round_up(capacity), PageAllocator<Cell>(numa_node))
+    {
+        const std::size_t cap = cells.size();
+        mask = cap - 1;
+        for (std::size_t i = 0; i < cap; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    /**
+     * @brief Appends an element.
+     *
+     * @param value Element to append; left untouched on failure.
+     * @return false if the queue is full.
+     */
+    bool push(T &value)
+    {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest available element.
+     *
+     * @param out Receives the element.
+     * @return false if the queue is empty.
+     */
+    bool pop(T &out)
+    {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->value);
+        cell->value = T();
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Number of slots.
+     */
+    std::size_t capacity() const { return mask + 1; }
+
+private:
+    /**
+     * @brief One slot with its lap sequence number.
+     */
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence; ///< Lap marker for this slot.
+        T value;                           ///< Stored element.
+    };
+
+    static std::size_t round_up(std::size_t capacity)
+    {
+        std::size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        return cap;
+    }
+
+    std::vector<Cell, PageAllocator<Cell>> cells;        ///< Slot storage.
+    std::size_t mask = 0;                                ///< Capacity minus one.
+    alignas(64) std::atomic<std::size_t> enqueue_pos{0}; ///< Next slot to push.
+    alignas(64) std::atomic<std::size_t> dequeue_pos{0}; ///< Next slot to pop.
+};
+
+#endif // MPMCQUEUE_HPP
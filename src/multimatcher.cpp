@@ -0,0 +1,343 @@
+/**
+ * @file multimatcher.cpp
+ * @brief Implementation file for MultiMatcher.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "multimatcher.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MULTIMATCHER_X86 1
+#endif
+
+namespace
+{
+    /// Which kernel scan() dispatches to.
+    enum class Kernel
+    {
+        SCALAR,
+        SSSE3,
+        AVX2
+    };
+
+    /**
+     * @brief Picks the widest kernel the CPU supports, once.
+     */
+    Kernel kernel()
+    {
+        static const Kernel chosen = [] {
+#if defined(MULTIMATCHER_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return Kernel::AVX2;
+            if (__builtin_cpu_supports("ssse3"))
+                return Kernel::SSSE3;
+#endif
+            return Kernel::SCALAR;
+        }();
+        return chosen;
+    }
+}
+
+/**
+ * @brief Compiles the patterns.
+ *
+ * @details
+ * Patterns are sorted by their filter prefix and cut into eight groups of
+ * consecutive patterns, so patterns sharing a prefix share a bucket and
+ * the nibble tables stay selective.
+ *
+ * @param list Literal patterns.
+ */
+MultiMatcher::MultiMatcher(std::vector<std::string> list)
+{
+    for (auto &p : list)
+    {
+        if (!p.empty())
+            patterns.push_back(std::move(p));
+    }
+    if (patterns.empty())
+    {
+        return;
+    }
+
+    std::size_t shortest = patterns.front().size();
+    for (const auto &p : patterns)
+        shortest = std::min(shortest, p.size());
+    prefix = std::min(shortest, MAX_PREFIX);
+
+    std::vector<std::uint32_t> order(patterns.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return patterns[a].compare(0, prefix, patterns[b], 0, prefix) < 0;
+    });
+
+    for (std::size_t rank = 0; rank < order.size(); ++rank)
+    {
+        const std::string &p = patterns[order[rank]];
+        const auto bit = static_cast<std::uint8_t>(1u << (rank * BUCKETS / order.size()));
+        for (std::size_t k = 0; k < prefix; ++k)
+        {
+            const auto c = static_cast<unsigned char>(p[k]);
+            low[k][c & 0x0F] |= bit;
+            high[k][c >> 4] |= bit;
+        }
+    }
+
+    for (std::uint32_t i = 0; i < patterns.size(); ++i)
+    {
+        by_prefix[prefix_key(patterns[i].data())].push_back(i);
+    }
+}
+
+/**
+ * @brief Key of the filter prefix bytes at @p p.
+ *
+ * @param p Start of at least @ref prefix bytes.
+ * @return The bytes packed into an integer.
+ */
+std::uint32_t MultiMatcher::prefix_key(const char *p) const
+{
+    std::uint32_t key = 0;
+    for (std::size_t k = 0; k < prefix; ++k)
+    {
+        key = (key << 8) | static_cast<unsigned char>(p[k]);
+    }
+    return key;
+}
+
+/**
+ * @brief Name of the instruction set in use.
+ *
+ * @return "avx2", "ssse3" or "scalar".
+ */
+const char *MultiMatcher::isa()
+{
+    switch (kernel())
+    {
+    case Kernel::AVX2:
+        return "avx2";
+    case Kernel::SSSE3:
+        return "ssse3";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * @brief Reports every occurrence of every pattern in @p text.
+ *
+ * @param text Bytes to scan.
+ * @param on_match Called once per occurrence.
+ * @return Number of occurrences.
+ */
+std::size_t MultiMatcher::scan(std::string_view text, const MatchFn &on_match) const
+{
+    if (patterns.empty() || text.size() < prefix)
+    {
+        return 0;
+    }
+
+    // Last position where the filter prefix fits.
+    const std::size_t end = text.size() - prefix + 1;
+    switch (kernel())
+    {
+    case Kernel::AVX2:
+        return scan_avx2(text, 0, end, on_match);
+    case Kernel::SSSE3:
+        return scan_ssse3(text, 0, end, on_match);
+    default:
+        return scan_scalar(text, 0, end, on_match);
+    }
+}
+
+/**
+ * @brief Verifies a filtered candidate position.
+ *
+ * @param text Text being scanned.
+ * @param pos Candidate start.
+ * @param on_match Called per matching pattern.
+ * @return Number of patterns matching at @p pos.
+ */
+std::size_t MultiMatcher::verify(std::string_view text, std::size_t pos,
+                                 const MatchFn &on_match) const
+{
+    const std::vector<std::uint32_t> *candidates = by_prefix.find(prefix_key(text.data() + pos));
+    if (!candidates)
+    {
+        return 0;
+    }
+
+    std::size_t found = 0;
+    for (std::uint32_t i : *candidates)
+    {
+        const std::string &p = patterns[i];
+        if (p.size() <= text.size() - pos &&
+            std::memcmp(text.data() + pos + prefix, p.data() + prefix, p.size() - prefix) == 0)
+        {
+            on_match(i, pos);
+            ++found;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Filters and verifies positions one byte at a time.
+ *
+ * @param text Text being scanned.
+ * @param from First position.
+ * @param to One past the last position.
+ * @param on_match Called per occurrence.
+ * @return Number of occurrences.
+ */
+std::size_t MultiMatcher::scan_scalar(std::string_view text, std::size_t from, std::size_t to,
+                                      const MatchFn &on_match) const
+{
+    const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+    std::size_t found = 0;
+    for (std::size_t pos = from; pos < to; ++pos)
+    {
+        std::uint8_t mask = 0xFF;
+        for (std::size_t k = 0; k < prefix && mask; ++k)
+        {
+            const unsigned char c = bytes[pos + k];
+            mask &= low[k][c & 0x0F] & high[k][c >> 4];
+        }
+        if (mask)
+        {
+            found += verify(text, pos, on_match);
+        }
+    }
+    return found;
+}
+
+#if defined(MULTIMATCHER_X86)
+/**
+ * @brief Teddy filter, sixteen positions per step.
+ *
+ * @param text Text being scanned.
+ * @param from First position.
+ * @param to One past the last position.
+ * @param on_match Called per occurrence.
+ * @return Number of occurrences.
+ */
+__attribute__((target("ssse3")))
+std::size_t MultiMatcher::scan_ssse3(std::string_view text, std::size_t from, std::size_t to,
+                                     const MatchFn &on_match) const
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i lo[MAX_PREFIX];
+    __m128i hi[MAX_PREFIX];
+    for (std::size_t k = 0; k < prefix; ++k)
+    {
+        lo[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low[k].data()));
+        hi[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high[k].data()));
+    }
+
+    std::size_t found = 0;
+    std::size_t pos = from;
+    for (; pos + 16 <= to; pos += 16)
+    {
+        __m128i mask = _mm_set1_epi8(static_cast<char>(0xFF));
+#pragma GCC unroll 3
+        for (std::size_t k = 0; k < prefix; ++k)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + pos + k));
+            __m128i l = _mm_shuffle_epi8(lo[k], _mm_and_si128(chunk, nibble));
+            __m128i h = _mm_shuffle_epi8(hi[k], _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble));
+            mask = _mm_and_si128(mask, _mm_and_si128(l, h));
+        }
+
+        auto hits = static_cast<unsigned>(
+            ~_mm_movemask_epi8(_mm_cmpeq_epi8(mask, _mm_setzero_si128())) & 0xFFFF);
+        while (hits)
+        {
+            found += verify(text, pos + __builtin_ctz(hits), on_match);
+            hits &= hits - 1;
+        }
+    }
+    return found + scan_scalar(text, pos, to, on_match);
+}
+
+/**
+ * @brief Teddy filter, thirty-two positions per step.
+ *
+ * @details
+ * VPSHUFB shuffles within each 128-bit lane, so the tables are broadcast
+ * to both lanes.
+ *
+ * @param text Text being scanned.
+ * @param from First position.
+ * @param to One past the last position.
+ * @param on_match Called per occurrence.
+ * @return Number of occurrences.
+ */
+__attribute__((target("avx2")))
+std::size_t MultiMatcher::scan_avx2(std::string_view text, std::size_t from, std::size_t to,
+                                    const MatchFn &on_match) const
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i lo[MAX_PREFIX];
+    __m256i hi[MAX_PREFIX];
+    for (std::size_t k = 0; k < prefix; ++k)
+    {
+        lo[k] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(low[k].data())));
+        hi[k] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(high[k].data())));
+    }
+
+    std::size_t found = 0;
+    std::size_t pos = from;
+    for (; pos + 32 <= to; pos += 32)
+    {
+        __m256i mask = _mm256_set1_epi8(static_cast<char>(0xFF));
+#pragma GCC unroll 3
+        for (std::size_t k = 0; k < prefix; ++k)
+        {
+            __m256i chunk =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text.data() + pos + k));
+            __m256i l = _mm256_shuffle_epi8(lo[k], _mm256_and_si256(chunk, nibble));
+            __m256i h = _mm256_shuffle_epi8(
+                hi[k], _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+            mask = _mm256_and_si256(mask, _mm256_and_si256(l, h));
+        }
+
+        auto hits = ~static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(mask, _mm256_setzero_si256())));
+        while (hits)
+        {
+            found += verify(text, pos + __builtin_ctz(hits), on_match);
+            hits &= hits - 1;
+        }
+    }
+    return found + scan_ssse3(text, pos, to, on_match);
+}
+#else
+/**
+ * @brief Scalar stand-in where SSSE3 does not exist.
+ */
+std::size_t MultiMatcher::scan_ssse3(std::string_view text, std::size_t from, std::size_t to,
+                                     const MatchFn &on_match) const
+{
+    return scan_scalar(text, from, to, on_match);
+}
+
+/**
+ * @brief Scalar stand-in where AVX2 does not exist.
+ */
+std::size_t MultiMatcher::scan_avx2(std::string_view text, std::size_t from, std::size_t to,
+                                    const MatchFn &on_match) const
+{
+    return scan_scalar(text, from, to, on_match);
+}
+#endif
@@ -0,0 +1,131 @@
+/**
+ * @file multimatcher.hpp
+ * @brief Vectorized search for many literal patterns at once.
+ *
+ * @details
+ * Watching logs for a few hundred error signatures with separate grep
+ * passes reads the data once per process and scans it once per pattern.
+ * A MultiMatcher scans it once for all patterns with a Teddy-style SIMD
+ * filter: the patterns are split into eight buckets, and for the first
+ * few bytes of every pattern a pair of nibble lookup tables records which
+ * buckets allow each byte value. PSHUFB turns sixteen (SSSE3) or
+ * thirty-two (AVX2) text bytes into bucket masks per instruction; only
+ * positions whose masks survive all prefix bytes are verified, through a
+ * hash of the prefix and a full comparison.
+ *
+ * The AVX2 and SSSE3 paths are chosen at run time on x86. Other targets
+ * run the same tables one byte at a time.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef MULTIMATCHER_HPP
+#define MULTIMATCHER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flathashmap.hpp"
+
+/**
+ * @class MultiMatcher
+ * @brief Compiled set of literal patterns.
+ *
+ * @details
+ * Immutable once built, so one matcher may be shared by any number of
+ * threads.
+ */
+class MultiMatcher
+{
+public:
+    /// Receives the index of the matching pattern and the match offset.
+    using MatchFn = std::function<void(std::size_t pattern, std::size_t offset)>;
+
+    /**
+     * @brief Compiles @p patterns.
+     *
+     * @param patterns Non-empty literal patterns; empty ones are ignored.
+     */
+    explicit MultiMatcher(std::vector<std::string> patterns);
+
+    /**
+     * @brief Reports every occurrence of every pattern in @p text.
+     *
+     * @details
+     * Matches are reported in order of their start offset;
+     * overlapping matches are all reported.
+     *
+     * @param text Bytes to scan.
+     * @param on_match Called once per occurrence.
+     * @return Number of occurrences.
+     */
+    std::size_t scan(std::string_view text, const MatchFn &on_match) const;
+
+    /**
+     * @brief Returns pattern @p index.
+     */
+    const std::string &pattern(std::size_t index) const { return patterns[index]; }
+
+    /**
+     * @brief Number of patterns.
+     */
+    std::size_t size() const { return patterns.size(); }
+
+    /**
+     * @brief Name of the instruction set scan() uses on this machine.
+     *
+     * @return "avx2", "ssse3" or "scalar".
+     */
+    static const char *isa();
+
+private:
+    /// Number of buckets; one bit each in a mask byte.
+    static constexpr std::size_t BUCKETS = 8;
+    /// Longest prefix the filter checks.
+    static constexpr std::size_t MAX_PREFIX = 3;
+
+    /**
+     * @brief Verifies a filtered candidate position.
+     *
+     * @return Number of patterns that match at @p pos.
+     */
+    std::size_t verify(std::string_view text, std::size_t pos, const MatchFn &on_match) const;
+
+    /**
+     * @brief Filters and verifies positions [from, to) one byte at a time.
+     */
+    std::size_t scan_scalar(std::string_view text, std::size_t from, std::size_t to,
+                            const MatchFn &on_match) const;
+
+    /**
+     * @brief Filters and verifies positions [from, to) with SIMD.
+     *
+     * @return Number of occurrences found.
+     */
+    std::size_t scan_ssse3(std::string_view text, std::size_t from, std::size_t to,
+                           const MatchFn &on_match) const;
+
+    /// @copydoc scan_ssse3
+    std::size_t scan_avx2(std::string_view text, std::size_t from, std::size_t to,
+                          const MatchFn &on_match) const;
+
+    /**
+     * @brief Key of the @ref prefix bytes at @p p.
+     */
+    std::uint32_t prefix_key(const char *p) const;
+
+    std::vector<std::string> patterns;                       ///< Patterns by index.
+    std::size_t prefix = 1;                                  ///< Bytes checked by the filter.
+    std::array<std::array<std::uint8_t, 16>, MAX_PREFIX> low{};  ///< Buckets by low nibble.
+    std::array<std::array<std::uint8_t, 16>, MAX_PREFIX> high{}; ///< Buckets by high nibble.
+    FlatHashMap<std::uint32_t, std::vector<std::uint32_t>> by_prefix; ///< Prefix to patterns.
+};
+
+#endif // MULTIMATCHER_HPP
@@ -0,0 +1,278 @@
+/**
+ * @file pagealloc.cpp
+ * @brief Implementation file for the huge-page and NUMA-aware allocator.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "pagealloc.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <string>
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    std::atomic<PagePolicy> page_policy{PagePolicy::DEFAULT}; ///< Current page policy.
+    std::atomic<bool> numa_binding{false};                    ///< Current numa_local.
+
+    std::size_t round_up(std::size_t n, std::size_t to)
+    {
+        return (n + to - 1) / to * to;
+    }
+
+    /**
+     * @brief Maps @p len bytes aligned to @p align, trimming the excess.
+     *
+     * @return The mapping, or MAP_FAILED.
+     */
+    void *map_aligned(std::size_t len, std::size_t align)
+    {
+        void *raw = ::mmap(nullptr, len + align, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+        {
+            return MAP_FAILED;
+        }
+        const auto start = reinterpret_cast<std::uintptr_t>(raw);
+        const std::uintptr_t aligned = round_up(start, align);
+        if (aligned > start)
+        {
+            ::munmap(raw, aligned - start);
+        }
+        const std::size_t tail = start + len + align - (aligned + len);
+        if (tail > 0)
+        {
+            ::munmap(reinterpret_cast<void *>(aligned + len), tail);
+        }
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    /**
+     * @brief Prefers @p node for the pages of [p, p + len).
+     */
+    void bind_to_node(void *p, std::size_t len, int node)
+    {
+        constexpr std::size_t BITS = sizeof(unsigned long) * 8;
+        unsigned long mask[16] = {};
+        if (node < 0 || static_cast<std::size_t>(node) >= BITS * 16)
+        {
+            return;
+        }
+        mask[node / BITS] = 1UL << (node % BITS);
+        // The kernel ignores the last bit of maxnode, hence the + 1.
+        ::syscall(__NR_mbind, p, len, MPOL_PREFERRED, mask, BITS * 16 + 1, 0);
+    }
+}
+
+/**
+ * @brief Sets the placement policy for blocks allocated from now on.
+ *
+ * @param options Policy to apply.
+ */
+void configure_memory(const MemoryOptions &options)
+{
+    page_policy.store(options.pages);
+    numa_binding.store(options.numa_local);
+}
+
+/**
+ * @brief Placement policy currently in effect.
+ *
+ * @return The options last passed to configure_memory().
+ */
+MemoryOptions memory_options()
+{
+    return MemoryOptions{page_policy.load(), numa_binding.load()};
+}
+
+/**
+ * @brief Size of one huge page.
+ *
+ * @return Hugepagesize from /proc/meminfo, or 2 MiB if unknown.
+ */
+std::size_t huge_page_size()
+{
+    static const std::size_t size = [] {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        std::size_t kib = 0;
+        while (meminfo >> key)
+        {
+            if (key == "Hugepagesize:" && meminfo >> kib && kib > 0)
+                return kib * 1024;
+            meminfo.ignore(256, '\n');
+        }
+        return std::size_t{2} << 20;
+    }();
+    return size;
+}
+
+/**
+ * @brief NUMA node of the CPU the calling thread runs on.
+ *
+ * @return The node, or -1 if unknown.
+ */
+int current_numa_node()
+{
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+    {
+        return -1;
+    }
+    return static_cast<int>(node);
+}
+
+/**
+ * @brief NUMA node a CPU belongs to.
+ *
+ * @details
+ * Reads the nodeN link in the CPU's sysfs directory.
+ *
+ * @param cpu CPU number.
+ * @return The node, or -1 if unknown.
+ */
+int numa_node_of_cpu(unsigned cpu)
+{
+    const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *d = ::opendir(dir.c_str());
+    if (!d)
+    {
+        return -1;
+    }
+    int node = -1;
+    while (const dirent *entry = ::readdir(d))
+    {
+        int n = 0;
+        if (std::sscanf(entry->d_name, "node%d", &n) == 1)
+        {
+            node = n;
+            break;
+        }
+    }
+    ::closedir(d);
+    return node;
+}
+
+/**
+ * @brief Number of NUMA nodes online.
+ *
+ * @details
+ * Parses the range list in /sys/devices/system/node/online, e.g. "0-1,3".
+ *
+ * @return At least 1.
+ */
+int numa_node_count()
+{
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (!(online >> list))
+    {
+        return 1;
+    }
+    int count = 0;
+    for (const char *p = list.c_str(); *p;)
+    {
+        int first = 0;
+        int last = 0;
+        int used = 0;
+        if (std::sscanf(p, "%d-%d%n", &first, &last, &used) != 2)
+        {
+            if (std::sscanf(p, "%d%n", &first, &used) != 1)
+                break;
+            last = first;
+        }
+        count += last - first + 1;
+        p += used;
+        if (*p != ',')
+            break;
+        ++p;
+    }
+    return count > 0 ? count : 1;
+}
+
+/**
+ * @brief Allocates a block under the current MemoryOptions.
+ *
+ * @details
+ * Blocks of at least one huge page are mapped, rounded up to whole huge
+ * pages and aligned to one, so every page of the block can be huge. Smaller
+ * blocks come from operator new.
+ *
+ * @param bytes Size of the block.
+ * @param align Required alignment.
+ * @param numa_node Node to bind to when numa_local is set; -1 for the
+ *        calling thread's node.
+ * @return The block; throws std::bad_alloc on failure.
+ */
+void *page_alloc(std::size_t bytes, std::size_t align, int numa_node)
+{
+    const std::size_t huge = huge_page_size();
+    if (bytes < huge)
+    {
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return ::operator new(bytes, std::align_val_t(align));
+        return ::operator new(bytes);
+    }
+
+    const std::size_t len = round_up(bytes, huge);
+    const PagePolicy policy = page_policy.load(std::memory_order_relaxed);
+    void *p = MAP_FAILED;
+    if (policy == PagePolicy::EXPLICIT)
+    {
+        p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (p == MAP_FAILED)
+    {
+        p = map_aligned(len, huge);
+        if (p == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        if (policy != PagePolicy::DEFAULT)
+        {
+            ::madvise(p, len, MADV_HUGEPAGE);
+        }
+    }
+
+    if (numa_binding.load(std::memory_order_relaxed))
+    {
+        // Bound before the first touch, so the pages are placed right away.
+        bind_to_node(p, len, numa_node >= 0 ? numa_node : current_numa_node());
+    }
+    return p;
+}
+
+/**
+ * @brief Releases a block from page_alloc().
+ *
+ * @param p The block.
+ * @param bytes Size passed to page_alloc().
+ * @param align Alignment passed to page_alloc().
+ */
+void page_free(void *p, std::size_t bytes, std::size_t align)
+{
+    const std::size_t huge = huge_page_size();
+    if (bytes < huge)
+    {
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(p, std::align_val_t(align));
+        else
+            ::operator delete(p);
+        return;
+    }
+    ::munmap(p, round_up(bytes, huge));
+}
@@ -0,0 +1,180 @@
+/**
+ * @file pagealloc.hpp
+ * @brief Huge-page and NUMA-aware backing for large tables and buffers.
+ *
+ * @details
+ * With a million watches the routing tables, the watch index and the
+ * event rings span hundreds of megabytes. Backed by 4 KiB pages, nearly
+ * every probe of a random slot misses the TLB, and on a multi-socket
+ * machine a shard's tables may sit on the far node from the reader
+ * thread that probes them.
+ *
+ * PageAllocator is the allocator behind FlatHashMap, SpscRing,
+ * MpmcQueue and the UringReader buffers. Blocks smaller than one huge
+ * page come from operator new as before. Larger blocks are mapped
+ * directly, aligned to a huge-page boundary, and set up according to the
+ * process-wide MemoryOptions:
+ *
+ * - PagePolicy::TRANSPARENT marks them MADV_HUGEPAGE, so the kernel backs
+ *   them with transparent huge pages when THP is in "madvise" mode.
+ * - PagePolicy::EXPLICIT maps them from the hugetlb pool (MAP_HUGETLB);
+ *   if the pool is empty it falls back to TRANSPARENT.
+ * - With numa_local set, each block is bound (MPOL_PREFERRED) to the node
+ *   of the thread that owns it: the node given to the allocator, or else
+ *   the node of the allocating thread.
+ *
+ * With the defaults, large blocks get base pages and no binding, as from
+ * malloc(). Options apply to blocks allocated after they are set, so
+ * configure_memory() belongs at startup, before the first watch is added.
+ * No libnuma is needed.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef PAGEALLOC_HPP
+#define PAGEALLOC_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+/**
+ * @enum PagePolicy
+ * @brief Page size used for large blocks.
+ */
+enum class PagePolicy
+{
+    DEFAULT,     ///< Base pages (or whatever THP "always" mode does).
+    TRANSPARENT, ///< madvise(MADV_HUGEPAGE) on each block.
+    EXPLICIT     ///< MAP_HUGETLB, falling back to TRANSPARENT.
+};
+
+/**
+ * @struct MemoryOptions
+ * @brief Process-wide placement policy for large blocks.
+ */
+struct MemoryOptions
+{
+    PagePolicy pages = PagePolicy::DEFAULT; ///< Page size policy.
+    bool numa_local = false;                ///< Bind blocks to the owner's node.
+};
+
+/**
+ * @brief Sets the placement policy for blocks allocated from now on.
+ *
+ * @param options Policy to apply.
+ */
+void configure_memory(const MemoryOptions &options);
+
+/**
+ * @brief Placement policy currently in effect.
+ */
+MemoryOptions memory_options();
+
+/**
+ * @brief Size of one huge page; blocks at least this large are mapped.
+ *
+ * @return Hugepagesize from /proc/meminfo, or 2 MiB if unknown.
+ */
+std::size_t huge_page_size();
+
+/**
+ * @brief NUMA node of the CPU the calling thread runs on.
+ *
+ * @return The node, or -1 if unknown.
+ */
+int current_numa_node();
+
+/**
+ * @brief NUMA node a CPU belongs to.
+ *
+ * @param cpu CPU number.
+ * @return The node, or -1 if unknown.
+ */
+int numa_node_of_cpu(unsigned cpu);
+
+/**
+ * @brief Number of NUMA nodes online.
+ *
+ * @return At least 1.
+ */
+int numa_node_count();
+
+/**
+ * @brief Allocates a block under the current MemoryOptions.
+ *
+ * @param bytes Size of the block.
+ * @param align Required alignment (a power of two).
+ * @param numa_node Node to bind to when numa_local is set; -1 for the
+ *        calling thread's node.
+ * @return The block; throws std::bad_alloc on failure.
+ */
+void *page_alloc(std::size_t bytes, std::size_t align, int numa_node = -1);
+
+/**
+ * @brief Releases a block from page_alloc().
+ *
+ * @param p The block.
+ * @param bytes Size passed to page_alloc().
+ * @param align Alignment passed to page_alloc().
+ */
+void page_free(void *p, std::size_t bytes, std::size_t align);
+
+/**
+ * @class PageAllocator
+ * @brief Standard allocator over page_alloc() with an optional home node.
+ *
+ * @details
+ * Any instance can free any other's blocks, so containers using it swap
+ * and move freely; the node only steers where new blocks go.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class PageAllocator
+{
+public:
+    using value_type = T;                      ///< Allocated type.
+    using is_always_equal = std::true_type;    ///< Blocks are interchangeable.
+
+    PageAllocator() = default;
+
+    /**
+     * @brief Creates an allocator whose blocks prefer @p numa_node.
+     *
+     * @param numa_node Home node, or -1 for the allocating thread's node.
+     */
+    explicit PageAllocator(int numa_node) : node(numa_node) {}
+
+    template <typename U>
+    PageAllocator(const PageAllocator<U> &other) : node(other.numa_node())
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(page_alloc(n * sizeof(T), alignof(T), node));
+    }
+
+    void deallocate(T *p, std::size_t n)
+    {
+        page_free(p, n * sizeof(T), alignof(T));
+    }
+
+    /**
+     * @brief Home node of new blocks, -1 for the allocating thread's.
+     */
+    int numa_node() const { return node; }
+
+    template <typename U>
+    bool operator==(const PageAllocator<U> &) const { return true; }
+
+    template <typename U>
+    bool operator!=(const PageAllocator<U> &) const { return false; }
+
+private:
+    int node = -1; ///< Home node.
+};
+
+#endif // PAGEALLOC_HPP
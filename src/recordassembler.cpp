@@ -0,0 +1,259 @@
+/**
+ * @file recordassembler.cpp
+ * @brief Implementation file for PrefixMatcher and RecordAssembler.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "recordassembler.hpp"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "contentloader.hpp"
+
+namespace
+{
+    /**
+     * @brief Checks whether pattern byte @p p accepts input byte @p c.
+     */
+    bool accepts(char p, unsigned char c)
+    {
+        if (p == '?')
+            return true;
+        if (p == '#')
+            return c >= '0' && c <= '9';
+        return static_cast<unsigned char>(p) == c;
+    }
+}
+
+/**
+ * @brief Compiles the patterns into a DFA by subset construction.
+ *
+ * @details
+ * An NFA state is a (pattern, position) pair; a DFA state is the sorted
+ * set of pairs still alive after the bytes read so far. Patterns are
+ * short, so the construction is cheap and happens once.
+ *
+ * @param patterns Record-start prefixes.
+ */
+PrefixMatcher::PrefixMatcher(const std::vector<std::string> &patterns)
+{
+    using Set = std::vector<std::pair<std::size_t, std::size_t>>;
+
+    std::map<Set, std::int32_t> ids;
+    std::vector<Set> work;
+
+    auto intern = [&](Set set) -> std::int32_t {
+        if (set.empty())
+            return DEAD;
+        auto it = ids.find(set);
+        if (it != ids.end())
+            return it->second;
+
+        auto id = static_cast<std::int32_t>(transitions.size());
+        bool accept = std::any_of(set.begin(), set.end(), [&](const auto &item) {
+            return item.second == patterns[item.first].size();
+        });
+        transitions.emplace_back();
+        transitions.back().fill(DEAD);
+        accepting.push_back(accept);
+        ids.emplace(set, id);
+        work.push_back(std::move(set));
+        return id;
+    };
+
+    Set start;
+    for (std::size_t i = 0; i < patterns.size(); ++i)
+    {
+        start.emplace_back(i, 0);
+    }
+    intern(start);
+
+    for (std::size_t state = 0; state < work.size(); ++state)
+    {
+        if (accepting[state])
+            continue; // matching is decided; no need to read further
+        for (int c = 0; c < 256; ++c)
+        {
+            Set next;
+            for (const auto &[pattern, pos] : work[state])
+            {
+                if (pos < patterns[pattern].size() &&
+                    accepts(patterns[pattern][pos], static_cast<unsigned char>(c)))
+                {
+                    next.emplace_back(pattern, pos + 1);
+                }
+            }
+            std::int32_t target = intern(std::move(next));
+            transitions[state][static_cast<std::size_t>(c)] = target;
+        }
+    }
+}
+
+/**
+ * @brief Checks whether @p line starts with any pattern.
+ *
+ * @param line Line to classify.
+ * @return true if a pattern matches a prefix of @p line.
+ */
+bool PrefixMatcher::matches(std::string_view line) const
+{
+    if (transitions.empty())
+    {
+        return false;
+    }
+
+    std::int32_t state = 0;
+    for (char c : line)
+    {
+        if (accepting[static_cast<std::size_t>(state)])
+            return true;
+        state = transitions[static_cast<std::size_t>(state)][static_cast<unsigned char>(c)];
+        if (state == DEAD)
+            return false;
+    }
+    return accepting[static_cast<std::size_t>(state)];
+}
+
+/**
+ * @brief Creates an assembler.
+ *
+ * @param starts Recognizes the first line of a record.
+ * @param sink Receives completed records.
+ * @param flush_after Age after which expire() emits an open record.
+ * @param delimiter Byte joining the lines of a record.
+ */
+RecordAssembler::RecordAssembler(PrefixMatcher starts, Sink sink,
+                                 std::chrono::milliseconds flush_after, char delimiter)
+    : starts(std::move(starts)), sink(std::move(sink)), flush_after(flush_after),
+      delim(delimiter)
+{
+}
+
+/**
+ * @brief Processes one batch of lines.
+ *
+ * @details
+ * The record in progress is tracked as a range over the caller's buffer
+ * for as long as its lines are adjacent there (separated by exactly one
+ * delimiter, as LineFramer produces them). It moves into the pooled
+ * buffer only if it is still open at the end of the batch or its lines
+ * are not adjacent.
+ *
+ * @param lines Lines in file order.
+ */
+void RecordAssembler::feed(const LineBatch &lines)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const char *begin = nullptr; // in-place range of the open record
+    const char *end = nullptr;
+
+    auto close = [&] {
+        if (begin)
+        {
+            sink(std::string_view(begin, static_cast<std::size_t>(end - begin)));
+            zero_copy.fetch_add(1, std::memory_order_relaxed);
+            begin = end = nullptr;
+        }
+        else if (pending)
+        {
+            emit_carried();
+        }
+    };
+
+    for (std::string_view line : lines)
+    {
+        const bool open = begin || pending;
+        if (!open || starts.matches(line))
+        {
+            close();
+            begin = line.data();
+            end = line.data() + line.size();
+        }
+        else if (begin && line.data() == end + 1 && *end == delim)
+        {
+            end = line.data() + line.size();
+        }
+        else
+        {
+            if (begin)
+            {
+                carry(std::string_view(begin, static_cast<std::size_t>(end - begin)));
+                begin = end = nullptr;
+            }
+            carry(line);
+        }
+    }
+
+    if (begin)
+    {
+        carry(std::string_view(begin, static_cast<std::size_t>(end - begin)));
+    }
+    if (!lines.empty() && pending)
+    {
+        touched = std::chrono::steady_clock::now();
+    }
+}
+
+/**
+ * @brief Emits the open record, if any.
+ */
+void RecordAssembler::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending)
+    {
+        emit_carried();
+    }
+}
+
+/**
+ * @brief Emits the open record if it has been idle long enough.
+ *
+ * @return true if a record was emitted.
+ */
+bool RecordAssembler::expire()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pending || std::chrono::steady_clock::now() - touched < flush_after)
+    {
+        return false;
+    }
+    emit_carried();
+    return true;
+}
+
+/**
+ * @brief Emits the carried record and returns its buffer to the pool.
+ */
+void RecordAssembler::emit_carried()
+{
+    std::unique_ptr<std::vector<char>> record = std::move(pending);
+    pending_pieces = 0;
+    sink(std::string_view(record->data(), record->size()));
+    copied.fetch_add(1, std::memory_order_relaxed);
+    BufferPool::instance().recycle(std::move(record));
+}
+
+/**
+ * @brief Appends a piece of the open record to the carried copy.
+ *
+ * @param piece One or more lines, already joined.
+ */
+void RecordAssembler::carry(std::string_view piece)
+{
+    if (!pending)
+    {
+        pending = BufferPool::instance().acquire(piece.size() + 256);
+    }
+    if (pending_pieces++ > 0)
+    {
+        pending->push_back(delim);
+    }
+    pending->insert(pending->end(), piece.begin(), piece.end());
+}
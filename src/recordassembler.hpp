@@ -0,0 +1,170 @@
+/**
+ * @file recordassembler.hpp
+ * @brief Joins continuation lines of tailed logs into whole records.
+ *
+ * @details
+ * Stack traces and other multi-line entries arrive from a TailReader as
+ * separate lines. A RecordAssembler starts a new record at every line
+ * accepted by a PrefixMatcher and appends all other lines to the record
+ * in progress.
+ *
+ * Records whose lines all sit in one read buffer are emitted as a single
+ * string_view over that buffer, without copying. Only a record still open
+ * when a batch ends is copied, into a pooled buffer, because the reader
+ * reuses its buffer for the next batch. The last record of a burst is
+ * emitted by flush() or, once it has been idle long enough, by expire().
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef RECORDASSEMBLER_HPP
+#define RECORDASSEMBLER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lineframer.hpp"
+
+/**
+ * @class PrefixMatcher
+ * @brief Deterministic automaton that recognizes record-start prefixes.
+ *
+ * @details
+ * Patterns are literal prefixes in which @c # matches any ASCII digit and
+ * @c ? matches any byte, e.g. @c "####-##-## " for an ISO date. All
+ * patterns are compiled into one DFA, so a line is classified in a single
+ * pass over at most the longest pattern's length, regardless of how many
+ * patterns there are.
+ */
+class PrefixMatcher
+{
+public:
+    /**
+     * @brief Compiles @p patterns.
+     *
+     * @param patterns Record-start prefixes; an empty pattern matches every line.
+     */
+    explicit PrefixMatcher(const std::vector<std::string> &patterns);
+
+    /**
+     * @brief Compiles @p patterns.
+     */
+    PrefixMatcher(std::initializer_list<std::string> patterns)
+        : PrefixMatcher(std::vector<std::string>(patterns))
+    {
+    }
+
+    /**
+     * @brief Checks whether @p line starts with any pattern.
+     *
+     * @param line Line to classify.
+     * @return true if a pattern matches a prefix of @p line.
+     */
+    bool matches(std::string_view line) const;
+
+    /**
+     * @brief Number of DFA states.
+     */
+    std::size_t state_count() const { return transitions.size(); }
+
+private:
+    /// Transition target meaning "no pattern can match any more".
+    static constexpr std::int32_t DEAD = -1;
+
+    std::vector<std::array<std::int32_t, 256>> transitions; ///< State by input byte.
+    std::vector<bool> accepting;                            ///< Whether a state has matched.
+};
+
+/**
+ * @class RecordAssembler
+ * @brief Groups lines into records by start-of-record patterns.
+ *
+ * @details
+ * Calls are serialized internally, so feed() and flush() may come from
+ * different threads.
+ */
+class RecordAssembler
+{
+public:
+    /// Receives each record, lines joined by the delimiter; valid only during the call.
+    using Sink = std::function<void(std::string_view record)>;
+
+    /**
+     * @brief Creates an assembler.
+     *
+     * @param starts Recognizes the first line of a record.
+     * @param sink Receives completed records.
+     * @param flush_after Age after which expire() emits an open record.
+     * @param delimiter Byte joining the lines of a record.
+     */
+    RecordAssembler(PrefixMatcher starts, Sink sink,
+                    std::chrono::milliseconds flush_after = std::chrono::milliseconds(500),
+                    char delimiter = '\n');
+
+    /**
+     * @brief Processes one batch of lines, as produced by a TailReader.
+     *
+     * @param lines Lines in file order.
+     */
+    void feed(const LineBatch &lines);
+
+    /**
+     * @brief Emits the open record, if any.
+     */
+    void flush();
+
+    /**
+     * @brief Emits the open record if no line was added for @c flush_after.
+     *
+     * @return true if a record was emitted.
+     */
+    bool expire();
+
+    /**
+     * @brief Records emitted in place, without copying.
+     */
+    std::uint64_t zero_copy_records() const { return zero_copy.load(); }
+
+    /**
+     * @brief Records emitted through the pooled buffer.
+     */
+    std::uint64_t copied_records() const { return copied.load(); }
+
+private:
+    /**
+     * @brief Emits the record carried over from an earlier batch.
+     */
+    void emit_carried();
+
+    /**
+     * @brief Appends a piece of the open record to the carried copy.
+     *
+     * @param piece One or more lines, already joined.
+     */
+    void carry(std::string_view piece);
+
+    const PrefixMatcher starts;                  ///< Start-of-record test.
+    const Sink sink;                             ///< Record consumer.
+    const std::chrono::milliseconds flush_after; ///< Idle time before expire() emits.
+    const char delim;                            ///< Line separator inside records.
+    std::mutex mutex;                            ///< Serializes all calls.
+    std::unique_ptr<std::vector<char>> pending;  ///< Carried record, pooled; null if none.
+    std::size_t pending_pieces = 0;              ///< Pieces in @ref pending.
+    std::chrono::steady_clock::time_point touched; ///< Last time @ref pending grew.
+    std::atomic<std::uint64_t> zero_copy{0};     ///< Records emitted in place.
+    std::atomic<std::uint64_t> copied{0};        ///< Records emitted from @ref pending.
+};
+
+#endif // RECORDASSEMBLER_HPP
@@ -0,0 +1,369 @@
+/**
+ * @file regiondiff.cpp
+ * @brief Implementation file for the extent-aware region diff.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "regiondiff.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "flathashmap.hpp"
+
+namespace
+{
+    /// Extents requested per FIEMAP call.
+    constexpr std::size_t FIEMAP_BATCH = 256;
+
+    /// Flags whose extents cannot be trusted to describe stable data.
+    constexpr std::uint32_t UNSTABLE = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC |
+                                       FIEMAP_EXTENT_UNWRITTEN | FIEMAP_EXTENT_ENCODED |
+                                       FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL |
+                                       FIEMAP_EXTENT_NOT_ALIGNED;
+
+    /// Hash of one block's bytes.
+    std::uint64_t hash_block(const char *data, std::size_t length)
+    {
+        return mix_hash(std::hash<std::string_view>()(std::string_view(data, length)));
+    }
+
+    /**
+     * @brief Reads all extents with FIEMAP.
+     *
+     * @return false if FIEMAP is not supported.
+     */
+    bool fiemap_extents(int fd, std::vector<FileExtent> &extents)
+    {
+        const std::size_t bytes = sizeof(struct fiemap) + FIEMAP_BATCH * sizeof(struct fiemap_extent);
+        std::unique_ptr<char[]> storage(new char[bytes]);
+        auto *map = reinterpret_cast<struct fiemap *>(storage.get());
+
+        std::uint64_t start = 0;
+        while (true)
+        {
+            std::fill(storage.get(), storage.get() + bytes, 0);
+            map->fm_start = start;
+            map->fm_length = FIEMAP_MAX_OFFSET - start;
+            // Write back first: a dirty block of a shared extent is only
+            // relocated at writeback, and until then still reports the
+            // shared location it is about to leave.
+            map->fm_flags = FIEMAP_FLAG_SYNC;
+            map->fm_extent_count = FIEMAP_BATCH;
+            if (::ioctl(fd, FS_IOC_FIEMAP, map) != 0)
+                return false;
+            if (map->fm_mapped_extents == 0)
+                return true;
+
+            for (std::uint32_t i = 0; i < map->fm_mapped_extents; ++i)
+            {
+                const struct fiemap_extent &e = map->fm_extents[i];
+                extents.push_back(FileExtent{e.fe_logical, e.fe_physical, e.fe_length, e.fe_flags});
+                start = e.fe_logical + e.fe_length;
+                if (e.fe_flags & FIEMAP_EXTENT_LAST)
+                    return true;
+            }
+        }
+    }
+
+    /**
+     * @brief Reads the data segments with SEEK_DATA/SEEK_HOLE.
+     *
+     * @return false if the file system rejects SEEK_DATA.
+     */
+    bool seek_extents(int fd, std::uint64_t size, std::vector<FileExtent> &extents)
+    {
+        off_t pos = 0;
+        while (static_cast<std::uint64_t>(pos) < size)
+        {
+            off_t data = ::lseek(fd, pos, SEEK_DATA);
+            if (data < 0)
+                return errno == ENXIO; // no more data past pos
+            off_t hole = ::lseek(fd, data, SEEK_HOLE);
+            if (hole < 0)
+                return false;
+            extents.push_back(FileExtent{static_cast<std::uint64_t>(data), 0,
+                                         static_cast<std::uint64_t>(hole - data), 0});
+            pos = hole;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Walks the extents of one map in block order.
+     *
+     * @details
+     * Blocks are visited in increasing order, so a cursor into the sorted
+     * extent list replaces a search per block.
+     */
+    class ExtentCursor
+    {
+    public:
+        explicit ExtentCursor(const std::vector<FileExtent> &extents)
+            : list(extents)
+        {
+        }
+
+        /// First extent ending after @p offset, or nullptr.
+        const FileExtent *at(std::uint64_t offset)
+        {
+            while (next < list.size() && list[next].logical + list[next].length <= offset)
+                ++next;
+            return next < list.size() ? &list[next] : nullptr;
+        }
+
+        /// Extent containing @p offset, searched from the cursor on.
+        const FileExtent *containing(std::uint64_t offset)
+        {
+            const FileExtent *e = at(offset);
+            return e && e->logical <= offset ? e : nullptr;
+        }
+
+    private:
+        const std::vector<FileExtent> &list;
+        std::size_t next = 0;
+    };
+
+    /**
+     * @brief Whether [lo, hi) holds no data at all.
+     */
+    bool is_hole(ExtentCursor &cursor, std::uint64_t lo, std::uint64_t hi)
+    {
+        const FileExtent *e = cursor.at(lo);
+        return !e || e->logical >= hi;
+    }
+
+    /**
+     * @brief Whether [lo, hi) still lies in the same shared extents as before.
+     *
+     * @details
+     * A write to an extent shared with a reflink copy is always placed
+     * somewhere else, so a range that is shared in both versions at the
+     * same physical location cannot have been written in between.
+     *
+     * @param now Cursor over the current extents.
+     * @param before Cursor over the previous extents.
+     */
+    bool same_shared(ExtentCursor &now, ExtentCursor &before, std::uint64_t lo, std::uint64_t hi)
+    {
+        std::uint64_t pos = lo;
+        while (pos < hi)
+        {
+            const FileExtent *a = now.containing(pos);
+            const FileExtent *b = before.containing(pos);
+            if (!a || !b || (a->flags & UNSTABLE) || (b->flags & UNSTABLE))
+                return false;
+            if (!(a->flags & FIEMAP_EXTENT_SHARED) || !(b->flags & FIEMAP_EXTENT_SHARED))
+                return false;
+            if (a->physical + (pos - a->logical) != b->physical + (pos - b->logical))
+                return false;
+            pos = std::min({hi, a->logical + a->length, b->logical + b->length});
+        }
+        return true;
+    }
+
+    /**
+     * @brief Appends [offset, offset + length) to @p ranges, merging neighbours.
+     */
+    void add_range(std::vector<ByteRange> &ranges, std::uint64_t offset, std::uint64_t length)
+    {
+        if (!ranges.empty() && ranges.back().offset + ranges.back().length == offset)
+            ranges.back().length += length;
+        else
+            ranges.push_back(ByteRange{offset, length});
+    }
+
+    /**
+     * @brief Maps @p path, comparing with @p previous.
+     *
+     * @details
+     * Holes are hashed as zeros without reading, and a block still in the
+     * same shared extents as in @p previous keeps its earlier hash; every
+     * other block holding data is read.
+     *
+     * @param path File to map.
+     * @param block_size Bytes per block.
+     * @param previous Earlier map, or nullptr for a full scan.
+     * @param changed Receives changed ranges when @p previous is set.
+     * @param stats Optional byte accounting.
+     * @param mode Page-cache treatment of the reads.
+     */
+    std::optional<RegionMap> scan(const std::string &path, std::size_t block_size,
+                                  const RegionMap *previous, std::vector<ByteRange> *changed,
+                                  RegionStats *stats, ReadMode mode)
+    {
+        auto reader = BlockReader::open(path, mode, block_size);
+        if (!reader)
+            return std::nullopt;
+        const int fd = reader->fd();
+        auto fp = FileFingerprint::capture(fd);
+        if (!fp)
+            return std::nullopt;
+
+        RegionMap map;
+        map.fingerprint = *fp;
+        map.size = fp->size;
+        map.block_size = block_size;
+        map.physical = read_extents(fd, map.size, map.extents);
+
+        // Reuse only a map of the same file whose blocks line up.
+        if (previous && (previous->block_size != block_size || previous->fingerprint.dev != fp->dev ||
+                         previous->fingerprint.ino != fp->ino))
+        {
+            previous = nullptr;
+        }
+
+        const std::size_t count = static_cast<std::size_t>((map.size + block_size - 1) / block_size);
+        map.blocks.resize(count);
+
+        std::vector<char> scratch; // zeros for holes, padding for short reads
+        std::optional<std::uint64_t> zero_hash;
+
+        const bool trust = previous && map.physical && previous->physical;
+        ExtentCursor holes(map.extents);
+        ExtentCursor now(map.extents);
+        ExtentCursor before(previous ? previous->extents : map.extents);
+        RegionStats local;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::uint64_t lo = static_cast<std::uint64_t>(i) * block_size;
+            const std::uint64_t hi = std::min<std::uint64_t>(map.size, lo + block_size);
+            const std::size_t length = static_cast<std::size_t>(hi - lo);
+            // The previous version had a block covering exactly [lo, hi).
+            const bool same_span = previous && i < previous->blocks.size() &&
+                                   std::min<std::uint64_t>(previous->size, lo + block_size) == hi;
+
+            if (is_hole(holes, lo, hi))
+            {
+                if (!zero_hash || length != block_size)
+                {
+                    scratch.assign(length, 0);
+                    zero_hash = hash_block(scratch.data(), length);
+                }
+                map.blocks[i] = *zero_hash;
+                local.skipped_holes += length;
+            }
+            else if (trust && same_span && same_shared(now, before, lo, hi))
+            {
+                map.blocks[i] = previous->blocks[i];
+                local.skipped_extents += length;
+                continue;
+            }
+            else
+            {
+                std::size_t got = 0;
+                const char *data = reader->read(lo, length, got);
+                if (!data)
+                    return std::nullopt;
+                if (got < length)
+                {
+                    // A file truncated under us hashes as zeros past the new end.
+                    scratch.assign(length, 0);
+                    std::copy(data, data + got, scratch.begin());
+                    data = scratch.data();
+                }
+                map.blocks[i] = hash_block(data, length);
+                local.hashed += length;
+            }
+
+            if (changed && previous && (!same_span || previous->blocks[i] != map.blocks[i]))
+            {
+                add_range(*changed, lo, length);
+            }
+        }
+
+        if (changed && previous && previous->size > map.size)
+        {
+            add_range(*changed, map.size, previous->size - map.size);
+        }
+        if (changed && !previous && map.size > 0)
+        {
+            add_range(*changed, 0, map.size);
+        }
+        if (stats)
+        {
+            stats->hashed += local.hashed;
+            stats->skipped_extents += local.skipped_extents;
+            stats->skipped_holes += local.skipped_holes;
+        }
+        return map;
+    }
+}
+
+/**
+ * @brief Reads the data extents of an open file.
+ *
+ * @param fd Open file descriptor.
+ * @param size File size in bytes.
+ * @param extents Receives the extents, sorted by offset.
+ * @return true if the extents carry physical offsets.
+ */
+bool read_extents(int fd, std::uint64_t size, std::vector<FileExtent> &extents)
+{
+    extents.clear();
+    if (fiemap_extents(fd, extents))
+    {
+        return true;
+    }
+    extents.clear();
+    if (!seek_extents(fd, size, extents))
+    {
+        extents.clear();
+        if (size > 0)
+            extents.push_back(FileExtent{0, 0, size, 0});
+    }
+    return false;
+}
+
+/**
+ * @brief Hashes every data block of @p path.
+ *
+ * @param path File to map.
+ * @param block_size Bytes per block.
+ * @param stats Optional byte accounting.
+ * @param mode Page-cache treatment of the reads.
+ * @return The map, or std::nullopt if the file cannot be read.
+ */
+std::optional<RegionMap> map_regions(const std::string &path, std::size_t block_size,
+                                     RegionStats *stats, ReadMode mode)
+{
+    block_size = std::max<std::size_t>(4096, (block_size + 4095) / 4096 * 4096);
+    return scan(path, block_size, nullptr, nullptr, stats, mode);
+}
+
+/**
+ * @brief Compares the current version of @p path with @p previous.
+ *
+ * @details
+ * If @p previous describes a different file (another inode, as after a
+ * rename-over) or a different block size, every block is hashed and the
+ * whole file is reported as changed.
+ *
+ * @param previous Map of the earlier version.
+ * @param path File to compare.
+ * @param changed Receives the changed ranges.
+ * @param stats Optional byte accounting.
+ * @param mode Page-cache treatment of the reads.
+ * @return Map of the current version, or std::nullopt.
+ */
+std::optional<RegionMap> diff_regions(const RegionMap &previous, const std::string &path,
+                                      std::vector<ByteRange> &changed, RegionStats *stats,
+                                      ReadMode mode)
+{
+    changed.clear();
+    const std::size_t block_size = previous.block_size ? previous.block_size : (1 << 20);
+    return scan(path, block_size, &previous, &changed, stats, mode);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file regiondiff.hpp
+ * @brief Finds the byte ranges that changed between versions of a large file.
+ *
+ * @details
+ * A RegionMap records a file's per-block hashes along with its extent
+ * layout, read with FIEMAP or, where that is not supported, with
+ * SEEK_DATA/SEEK_HOLE. When the next version is compared, blocks are
+ * hashed only where the layout cannot prove them unchanged:
+ *
+ * - Blocks entirely inside a hole are never read.
+ * - A block whose extents are shared with a reflink copy (for example a
+ *   SnapshotStore snapshot) in both versions, at the same physical
+ *   location, is reused without reading: btrfs and XFS never overwrite a
+ *   shared extent in place, so a write to it would have moved it.
+ *
+ * Unshared extents can be overwritten in place on any file system,
+ * preallocated ones even on btrfs, so their blocks are always hashed.
+ * FIEMAP is asked to write dirty data back first (FIEMAP_FLAG_SYNC):
+ * a shared block is only relocated at writeback, and freshly written
+ * data must not be mistaken for a hole. Writeback only costs what is
+ * dirty, which is what the comparison has to read anyway.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef REGIONDIFF_HPP
+#define REGIONDIFF_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fingerprint.hpp"
+#include "uncachedread.hpp"
+
+/**
+ * @struct FileExtent
+ * @brief One mapped range of a file.
+ */
+struct FileExtent
+{
+    std::uint64_t logical = 0;  ///< Offset in the file.
+    std::uint64_t physical = 0; ///< Offset on the device (0 if unknown).
+    std::uint64_t length = 0;   ///< Length in bytes.
+    std::uint32_t flags = 0;    ///< FIEMAP_EXTENT_* flags.
+};
+
+/**
+ * @struct ByteRange
+ * @brief A range of bytes reported as changed.
+ */
+struct ByteRange
+{
+    std::uint64_t offset = 0; ///< First byte.
+    std::uint64_t length = 0; ///< Number of bytes.
+};
+
+/**
+ * @struct RegionStats
+ * @brief Where the bytes of a comparison went.
+ */
+struct RegionStats
+{
+    std::uint64_t hashed = 0;          ///< Bytes read and hashed.
+    std::uint64_t skipped_extents = 0; ///< Bytes proven unchanged by shared extents.
+    std::uint64_t skipped_holes = 0;   ///< Bytes in holes, never read.
+};
+
+/**
+ * @struct RegionMap
+ * @brief Block hashes and layout of one version of a file.
+ */
+struct RegionMap
+{
+    FileFingerprint fingerprint;       ///< Version the map describes.
+    std::uint64_t size = 0;            ///< File size in bytes.
+    std::size_t block_size = 0;        ///< Bytes per hashed block.
+    std::vector<std::uint64_t> blocks; ///< Hash of each block.
+    std::vector<FileExtent> extents;   ///< Data extents, sorted by offset.
+    bool physical = false;             ///< Extents carry physical offsets (FIEMAP).
+};
+
+/**
+ * @brief Reads the data extents of an open file.
+ *
+ * @details
+ * Uses FIEMAP and falls back to SEEK_DATA/SEEK_HOLE, in which case the
+ * extents have no physical offsets. If neither works the whole file is
+ * reported as one extent of data.
+ *
+ * @param fd Open file descriptor.
+ * @param size File size in bytes.
+ * @param extents Receives the extents, sorted by offset.
+ * @return true if the extents carry physical offsets.
+ */
+bool read_extents(int fd, std::uint64_t size, std::vector<FileExtent> &extents);
+
+/**
+ * @brief Hashes every data block of @p path.
+ *
+ * @param path File to map.
+ * @param block_size Bytes per block; rounded up to a multiple of 4 KiB.
+ * @param stats Optional byte accounting.
+ * @param mode Page-cache treatment of the reads; see BlockReader.
+ * @return The map, or std::nullopt if the file cannot be read.
+ */
+std::optional<RegionMap> map_regions(const std::string &path, std::size_t block_size = 1 << 20,
+                                     RegionStats *stats = nullptr,
+                                     ReadMode mode = ReadMode::CACHED);
+
+/**
+ * @brief Compares the current version of @p path with @p previous.
+ *
+ * @param previous Map of the earlier version.
+ * @param path File to compare.
+ * @param changed Receives the changed ranges, merged and in order. A
+ *        shrunken file reports the removed tail past the new size.
+ * @param stats Optional byte accounting.
+ * @param mode Page-cache treatment of the reads; see BlockReader.
+ * @return Map of the current version, or std::nullopt if the file cannot
+ *         be read.
+ */
+std::optional<RegionMap> diff_regions(const RegionMap &previous, const std::string &path,
+                                      std::vector<ByteRange> &changed,
+                                      RegionStats *stats = nullptr,
+                                      ReadMode mode = ReadMode::CACHED);
+
+#endif // REGIONDIFF_HPP
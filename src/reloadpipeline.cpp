@@ -0,0 +1,324 @@
+/**
+ * @file reloadpipeline.cpp
+ * @brief Implementation file for ReloadPipeline.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "reloadpipeline.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+/**
+ * @brief Starts the stage workers.
+ *
+ * @param parse Parse function.
+ * @param publish Publish function.
+ * @param options Worker counts and queue size.
+ */
+ReloadPipeline::ReloadPipeline(ParseFn parse, PublishFn publish, const PipelineOptions &options)
+    : parse(std::move(parse)), publish(std::move(publish))
+{
+    const std::array<std::size_t, STAGE_COUNT> workers = {
+        options.verify_workers, options.load_workers, options.parse_workers,
+        options.publish_workers};
+
+    for (std::size_t i = 0; i < STAGE_COUNT; ++i)
+    {
+        stages[i] = std::make_unique<Stage>(options.queue_capacity);
+    }
+    for (std::size_t i = 0; i < STAGE_COUNT; ++i)
+    {
+        for (std::size_t w = 0; w < std::max<std::size_t>(1, workers[i]); ++w)
+        {
+            stages[i]->workers.emplace_back(&ReloadPipeline::worker, this, i);
+        }
+    }
+}
+
+/**
+ * @brief Stops and joins every worker.
+ */
+ReloadPipeline::~ReloadPipeline()
+{
+    stopping.store(true);
+    for (auto &stage : stages)
+    {
+        std::lock_guard<std::mutex> lock(stage->mutex);
+        stage->cv.notify_all();
+        stage->space.notify_all();
+    }
+    for (auto &stage : stages)
+    {
+        for (auto &t : stage->workers)
+        {
+            t.join();
+        }
+    }
+}
+
+/**
+ * @brief Queues a reload of @p path.
+ *
+ * @param path Path to the file.
+ * @return false if the verify queue is full.
+ */
+bool ReloadPipeline::submit(const std::string &path)
+{
+    auto job = std::make_unique<Job>();
+    job->path = path;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        job->sequence = ++paths[path].submitted;
+    }
+
+    in_flight.fetch_add(1);
+    Stage &stage = *stages[VERIFY];
+    // Counted before the push so a worker's decrement never precedes it.
+    stage.pending.fetch_add(1);
+    if (!stage.queue.push(job))
+    {
+        stage.pending.fetch_sub(1);
+        retire();
+        return false;
+    }
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    if (stage.sleepers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(stage.mutex);
+        stage.cv.notify_one();
+    }
+    return true;
+}
+
+/**
+ * @brief Submits @p path whenever @p monitor reports a change.
+ *
+ * @param monitor Monitor watching @p path.
+ * @param path Path to submit.
+ * @return Identifier to pass to MonitorFile::remove_callback().
+ */
+SubscriptionId ReloadPipeline::attach(MonitorFile &monitor, const std::string &path)
+{
+    return monitor.add_callback([this, path] { submit(path); });
+}
+
+/**
+ * @brief Blocks until every accepted reload has left the pipeline.
+ */
+void ReloadPipeline::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    idle_cv.wait(lock, [this] { return in_flight.load() == 0; });
+}
+
+/**
+ * @brief Returns the running totals.
+ *
+ * @return Snapshot of the counters.
+ */
+ReloadPipeline::Stats ReloadPipeline::stats() const
+{
+    Stats s;
+    s.submitted = submitted.load(std::memory_order_relaxed);
+    s.unchanged = unchanged.load(std::memory_order_relaxed);
+    s.failed = failed.load(std::memory_order_relaxed);
+    s.stale = stale.load(std::memory_order_relaxed);
+    s.published = published.load(std::memory_order_relaxed);
+    return s;
+}
+
+/**
+ * @brief Worker body: pops jobs, processes them and forwards survivors.
+ *
+ * @param index Stage served by this worker.
+ */
+void ReloadPipeline::worker(std::size_t index)
+{
+    Stage &stage = *stages[index];
+    std::unique_ptr<Job> job;
+
+    while (!stopping.load())
+    {
+        if (!stage.queue.pop(job))
+        {
+            // pending may be ahead of the queue while a push is under way;
+            // the wait then returns at once and the pop is retried.
+            std::unique_lock<std::mutex> lock(stage.mutex);
+            stage.sleepers.fetch_add(1);
+            stage.cv.wait(lock, [&] { return stopping.load() || stage.pending.load() > 0; });
+            stage.sleepers.fetch_sub(1);
+            continue;
+        }
+        stage.pending.fetch_sub(1);
+        stage.popped.fetch_add(1);
+        if (stage.blocked.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(stage.mutex);
+            stage.space.notify_one();
+        }
+
+        bool forward = false;
+        try
+        {
+            forward = process(index, *job);
+        }
+        catch (...)
+        {
+            failed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (forward && index + 1 < STAGE_COUNT && enqueue(index + 1, job))
+        {
+            continue;
+        }
+        job.reset();
+        retire();
+    }
+}
+
+/**
+ * @brief Runs one stage on a job.
+ *
+ * @param index Stage to run.
+ * @param job Job to process.
+ * @return true if the job moves on to the next stage.
+ */
+bool ReloadPipeline::process(std::size_t index, Job &job)
+{
+    switch (index)
+    {
+    case VERIFY:
+    {
+        auto fp = FileFingerprint::capture(job.path);
+        if (!fp)
+        {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(state_mutex);
+        const PathState &state = paths[job.path];
+        if (state.fingerprint && *state.fingerprint == *fp)
+        {
+            unchanged.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        job.fingerprint = *fp;
+        return true;
+    }
+
+    case LOAD:
+    {
+        job.content = load_file(job.path);
+        if (!job.content)
+        {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        job.fingerprint = job.content->fingerprint;
+        job.content_hash = mix_hash(std::hash<std::string_view>()(job.content->view()));
+
+        std::lock_guard<std::mutex> lock(state_mutex);
+        PathState &state = paths[job.path];
+        if (state.content_hash && *state.content_hash == job.content_hash)
+        {
+            // Touched but not modified; remember the version so the next
+            // submission is dropped at the verify stage.
+            state.fingerprint = job.fingerprint;
+            unchanged.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    case PARSE:
+        job.result = parse(job.path, *job.content);
+        job.content.reset(); // return the buffer to the pool early
+        if (!job.result)
+        {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+
+    case PUBLISH:
+    {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            PathState &state = paths[job.path];
+            if (job.sequence <= state.published)
+            {
+                stale.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            state.published = job.sequence;
+            state.fingerprint = job.fingerprint;
+            state.content_hash = job.content_hash;
+        }
+        publish(job.path, job.result);
+        published.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Queues a job for a stage, sleeping while the queue is full.
+ *
+ * @details
+ * Mirrors the idle wait in worker(): the pop count is read before each
+ * push, so a pop that lands before this producer is counted in
+ * @c blocked still fails the wait predicate and the push is retried.
+ *
+ * @param index Stage to queue for.
+ * @param job Job to queue; moved from on success.
+ * @return false if the pipeline stopped before the job was queued.
+ */
+bool ReloadPipeline::enqueue(std::size_t index, std::unique_ptr<Job> &job)
+{
+    Stage &stage = *stages[index];
+    stage.pending.fetch_add(1);
+    std::uint64_t seen = stage.popped.load();
+    while (!stage.queue.push(job))
+    {
+        {
+            std::unique_lock<std::mutex> lock(stage.mutex);
+            stage.blocked.fetch_add(1);
+            stage.space.wait(lock, [&] {
+                return stopping.load() || stage.popped.load() != seen;
+            });
+            stage.blocked.fetch_sub(1);
+        }
+        if (stopping.load())
+        {
+            stage.pending.fetch_sub(1);
+            return false;
+        }
+        seen = stage.popped.load();
+    }
+
+    if (stage.sleepers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(stage.mutex);
+        stage.cv.notify_one();
+    }
+    return true;
+}
+
+/**
+ * @brief Marks one job as having left the pipeline.
+ */
+void ReloadPipeline::retire()
+{
+    if (in_flight.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        idle_cv.notify_all();
+    }
+}
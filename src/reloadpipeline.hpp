@@ -0,0 +1,238 @@
+/**
+ * @file reloadpipeline.hpp
+ * @brief Staged verify/load/parse/publish pipeline for reloading many files.
+ *
+ * @details
+ * When many watched files change at once (a deploy, a configuration
+ * push), reloading them one after the other serializes their I/O and
+ * parsing. A ReloadPipeline splits every reload into four stages, each
+ * served by its own small set of worker threads and connected by bounded
+ * lock-free MPMC queues:
+ *
+ * 1. verify: fingerprint the file and drop it if it matches the version
+ *    last published;
+ * 2. load: read it with load_file() and drop it if the content hash
+ *    matches the version last published;
+ * 3. parse: run the user's parse function;
+ * 4. publish: hand the result to the user's publish function, discarding
+ *    results overtaken by a newer submission of the same file.
+ *
+ * Stages overlap, so file N+1 is being verified or read while file N is
+ * being parsed. A full queue stalls the stage feeding it, which bounds
+ * memory when submissions outpace parsing.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef RELOADPIPELINE_HPP
+#define RELOADPIPELINE_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "contentloader.hpp"
+#include "flathashmap.hpp"
+#include "monitorfile.hpp"
+#include "mpmcqueue.hpp"
+
+/**
+ * @struct PipelineOptions
+ * @brief Worker counts and queue size for a ReloadPipeline.
+ */
+struct PipelineOptions
+{
+    std::size_t queue_capacity = 256; ///< Slots per inter-stage queue.
+    std::size_t verify_workers = 1;   ///< Threads fingerprinting files.
+    std::size_t load_workers = 2;     ///< Threads reading files.
+    std::size_t parse_workers = 2;    ///< Threads running the parse function.
+    std::size_t publish_workers = 1;  ///< Threads running the publish function.
+};
+
+/**
+ * @class ReloadPipeline
+ * @brief Runs reloads of many files through overlapping stages.
+ *
+ * @details
+ * Parse results are type-erased as std::shared_ptr<void>, as with
+ * MonitorFile::add_speculative_callback(). Publishing is serialized per
+ * pipeline when the publish stage has a single worker (the default).
+ */
+class ReloadPipeline
+{
+public:
+    /// Parses loaded contents; may throw or return nullptr to reject them.
+    using ParseFn = std::function<std::shared_ptr<void>(const std::string &path,
+                                                        const FileContent &content)>;
+    /// Publishes a parsed result.
+    using PublishFn = std::function<void(const std::string &path,
+                                         const std::shared_ptr<void> &result)>;
+
+    /**
+     * @brief Running totals.
+     */
+    struct Stats
+    {
+        std::uint64_t submitted = 0; ///< Reloads accepted by submit().
+        std::uint64_t unchanged = 0; ///< Dropped because nothing changed.
+        std::uint64_t failed = 0;    ///< Dropped because reading or parsing failed.
+        std::uint64_t stale = 0;     ///< Dropped because a newer reload overtook them.
+        std::uint64_t published = 0; ///< Results handed to the publish function.
+    };
+
+    /**
+     * @brief Starts the stage workers.
+     *
+     * @param parse Parse function, run on parse workers.
+     * @param publish Publish function, run on publish workers.
+     * @param options Worker counts and queue size.
+     */
+    ReloadPipeline(ParseFn parse, PublishFn publish, const PipelineOptions &options = {});
+
+    /**
+     * @brief Stops the workers; reloads still queued are dropped.
+     */
+    ~ReloadPipeline();
+
+    ReloadPipeline(const ReloadPipeline &) = delete;
+    ReloadPipeline &operator=(const ReloadPipeline &) = delete;
+
+    /**
+     * @brief Queues a reload of @p path.
+     *
+     * @param path Path to the file.
+     * @return false if the verify queue is full.
+     */
+    bool submit(const std::string &path);
+
+    /**
+     * @brief Submits @p path whenever @p monitor reports a change.
+     *
+     * @details
+     * The pipeline must outlive the subscription; remove it with
+     * MonitorFile::remove_callback() before destroying the pipeline.
+     *
+     * @param monitor Monitor watching @p path.
+     * @param path Path to submit.
+     * @return Identifier to pass to MonitorFile::remove_callback().
+     */
+    SubscriptionId attach(MonitorFile &monitor, const std::string &path);
+
+    /**
+     * @brief Blocks until every accepted reload has left the pipeline.
+     */
+    void wait_idle();
+
+    /**
+     * @brief Returns the running totals.
+     */
+    Stats stats() const;
+
+private:
+    /**
+     * @brief One reload travelling through the stages.
+     */
+    struct Job
+    {
+        std::string path;                   ///< File being reloaded.
+        std::uint64_t sequence = 0;         ///< Submission order for @ref path.
+        FileFingerprint fingerprint;        ///< Version seen by verify.
+        std::optional<FileContent> content; ///< Contents read by load.
+        std::uint64_t content_hash = 0;     ///< Hash of @ref content.
+        std::shared_ptr<void> result;       ///< Output of parse.
+    };
+
+    /**
+     * @brief Last known state of one file.
+     */
+    struct PathState
+    {
+        std::uint64_t submitted = 0;                 ///< Sequence of the latest submission.
+        std::uint64_t published = 0;                 ///< Sequence of the latest publication.
+        std::optional<FileFingerprint> fingerprint;  ///< Version last published.
+        std::optional<std::uint64_t> content_hash;   ///< Content hash last published.
+    };
+
+    /**
+     * @brief Input queue and workers of one stage.
+     */
+    struct Stage
+    {
+        explicit Stage(std::size_t capacity) : queue(capacity) {}
+
+        MpmcQueue<std::unique_ptr<Job>> queue; ///< Jobs waiting for this stage.
+        std::vector<std::thread> workers;      ///< Threads serving the stage.
+        std::atomic<std::size_t> pending{0};   ///< Jobs queued or being pushed.
+        std::atomic<std::size_t> sleepers{0};  ///< Workers blocked on @ref cv.
+        std::atomic<std::uint64_t> popped{0};  ///< Jobs taken off @ref queue so far.
+        std::atomic<std::size_t> blocked{0};   ///< Producers blocked on @ref space.
+        std::mutex mutex;                      ///< Pairs with @ref cv and @ref space.
+        std::condition_variable cv;            ///< Wakes idle workers.
+        std::condition_variable space;         ///< Wakes producers waiting for a slot.
+    };
+
+    /// Stage positions.
+    enum StageIndex : std::size_t
+    {
+        VERIFY,
+        LOAD,
+        PARSE,
+        PUBLISH,
+        STAGE_COUNT
+    };
+
+    /**
+     * @brief Worker body for stage @p index.
+     */
+    void worker(std::size_t index);
+
+    /**
+     * @brief Runs stage @p index on @p job.
+     *
+     * @return true if the job moves on to the next stage.
+     */
+    bool process(std::size_t index, Job &job);
+
+    /**
+     * @brief Queues @p job for stage @p index, waiting while it is full.
+     *
+     * @return false if the pipeline stopped first.
+     */
+    bool enqueue(std::size_t index, std::unique_ptr<Job> &job);
+
+    /**
+     * @brief Marks one job as having left the pipeline.
+     */
+    void retire();
+
+    ParseFn parse;                                        ///< User parse function.
+    PublishFn publish;                                    ///< User publish function.
+    std::array<std::unique_ptr<Stage>, STAGE_COUNT> stages; ///< Stages in order.
+    std::atomic<bool> stopping{false};                    ///< Set by the destructor.
+
+    std::mutex state_mutex;                               ///< Guards @ref paths.
+    FlatHashMap<std::string, PathState> paths;            ///< Per-file history.
+
+    std::atomic<std::size_t> in_flight{0};                ///< Accepted, not yet retired.
+    std::mutex idle_mutex;                                ///< Pairs with @ref idle_cv.
+    std::condition_variable idle_cv;                      ///< Signalled when idle.
+
+    std::atomic<std::uint64_t> submitted{0};              ///< See Stats.
+    std::atomic<std::uint64_t> unchanged{0};              ///< See Stats.
+    std::atomic<std::uint64_t> failed{0};                 ///< See Stats.
+    std::atomic<std::uint64_t> stale{0};                  ///< See Stats.
+    std::atomic<std::uint64_t> published{0};              ///< See Stats.
+};
+
+#endif // RELOADPIPELINE_HPP
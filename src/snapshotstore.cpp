@@ -0,0 +1,322 @@
+/**
+ * @file snapshotstore.cpp
+ * @brief Implementation file for SnapshotStore.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "snapshotstore.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fingerprint.hpp"
+
+namespace
+{
+    /// Largest chunk passed to one copy_file_range() call.
+    constexpr std::size_t COPY_CHUNK = 64 << 20;
+
+    /// Buffer size of the read/write fallback.
+    constexpr std::size_t RW_CHUNK = 1 << 20;
+
+    /**
+     * @brief Closes a descriptor on scope exit.
+     */
+    struct FdGuard
+    {
+        int fd;
+        ~FdGuard()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    };
+
+    /**
+     * @brief Copies @p size bytes with copy_file_range().
+     *
+     * @return 1 on success, 0 if unsupported before anything was copied,
+     *         -1 on failure.
+     */
+    int copy_range(int in, int out, std::uint64_t size)
+    {
+        std::uint64_t done = 0;
+        while (done < size)
+        {
+            const std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(size - done, COPY_CHUNK));
+            ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, want, 0);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (done == 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                                  errno == EOPNOTSUPP))
+                    return 0;
+                return -1;
+            }
+            if (n == 0)
+                break; // source shrank; the fingerprint check catches it
+            done += static_cast<std::uint64_t>(n);
+        }
+        return 1;
+    }
+
+    /**
+     * @brief Copies @p size bytes through a user-space buffer.
+     *
+     * @return true on success.
+     */
+    bool copy_rw(int in, int out, std::uint64_t size)
+    {
+        std::vector<char> buffer(RW_CHUNK);
+        std::uint64_t offset = 0;
+        while (offset < size)
+        {
+            ssize_t n = ::pread(in, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return n == 0;
+            for (ssize_t written = 0; written < n;)
+            {
+                ssize_t w = ::pwrite(out, buffer.data() + written, static_cast<std::size_t>(n - written),
+                                     static_cast<off_t>(offset) + written);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w <= 0)
+                    return false;
+                written += w;
+            }
+            offset += static_cast<std::uint64_t>(n);
+        }
+        return true;
+    }
+
+    /// Length of the "<ctime>-<size>" stamp ending a snapshot name.
+    constexpr std::size_t STAMP = 20 + 1 + 20;
+
+    /**
+     * @brief Prefix shared by every snapshot of @p path.
+     *
+     * @details
+     * The file name keeps the store browsable; the key, an FNV-1a hash of
+     * the canonical path, keeps files with the same name in different
+     * directories apart. FNV-1a rather than std::hash so the key is the
+     * same in every run.
+     */
+    std::string snapshot_prefix(const std::string &path)
+    {
+        std::error_code ec;
+        std::filesystem::path full = std::filesystem::weakly_canonical(path, ec);
+        if (ec)
+            full = std::filesystem::absolute(path, ec).lexically_normal();
+
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for (unsigned char c : full.string())
+        {
+            h = (h ^ c) * 0x100000001b3ULL;
+        }
+        char key[24];
+        std::snprintf(key, sizeof(key), "@%016llx@", static_cast<unsigned long long>(h));
+        return std::filesystem::path(path).filename().string() + key;
+    }
+
+    /**
+     * @brief Snapshot name for version @p fp of the file with @p prefix.
+     *
+     * @details
+     * The change time leads, so names sort in version order even when a
+     * writer restores the modification time; with the size it tells such
+     * versions apart.
+     */
+    std::string snapshot_name(const std::string &prefix, const FileFingerprint &fp)
+    {
+        char stamp[48];
+        std::snprintf(stamp, sizeof(stamp), "%020lld-%020llu", static_cast<long long>(fp.ctime_ns),
+                      static_cast<unsigned long long>(fp.size));
+        return prefix + stamp;
+    }
+}
+
+/**
+ * @brief Copies @p source to a new file @p target, preferring a reflink.
+ *
+ * @param source File to copy.
+ * @param target Path of the copy; must not exist.
+ * @return The method used, or std::nullopt on failure.
+ */
+std::optional<CloneMethod> clone_file(const std::string &source, const std::string &target)
+{
+    FdGuard in{::open(source.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (in.fd < 0)
+        return std::nullopt;
+    struct stat st;
+    if (::fstat(in.fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return std::nullopt;
+    auto before = FileFingerprint::capture(in.fd);
+
+    const std::string partial = target + ".partial";
+    ::unlink(partial.c_str()); // left over from an interrupted copy
+    FdGuard out{::open(partial.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777)};
+    if (out.fd < 0)
+        return std::nullopt;
+
+    std::optional<CloneMethod> used;
+    if (::ioctl(out.fd, FICLONE, in.fd) == 0)
+    {
+        used = CloneMethod::REFLINK;
+    }
+    else
+    {
+        const int ranged = copy_range(in.fd, out.fd, static_cast<std::uint64_t>(st.st_size));
+        if (ranged > 0)
+            used = CloneMethod::COPY_RANGE;
+        else if (ranged == 0 && copy_rw(in.fd, out.fd, static_cast<std::uint64_t>(st.st_size)))
+            used = CloneMethod::READ_WRITE;
+    }
+
+    // A copy is only a snapshot if the source held still throughout.
+    auto after = FileFingerprint::capture(in.fd);
+    if (!used || !before || !after || *before != *after)
+    {
+        ::unlink(partial.c_str());
+        return std::nullopt;
+    }
+
+    const struct timespec times[2] = {st.st_atim, st.st_mtim};
+    ::futimens(out.fd, times);
+    if (::rename(partial.c_str(), target.c_str()) != 0)
+    {
+        ::unlink(partial.c_str());
+        return std::nullopt;
+    }
+    return used;
+}
+
+/**
+ * @brief Creates a store.
+ *
+ * @param options Directory and retention.
+ */
+SnapshotStore::SnapshotStore(SnapshotOptions options)
+    : options(std::move(options))
+{
+}
+
+/**
+ * @brief Snapshots the current version of @p path and prunes old ones.
+ *
+ * @details
+ * A version already in the store is not copied again. If the file keeps
+ * changing mid-copy the attempt is repeated, capturing whichever version
+ * holds still first.
+ *
+ * @param path File to snapshot.
+ * @return Path of the snapshot, or std::nullopt on failure.
+ */
+std::optional<std::string> SnapshotStore::capture(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::error_code ec;
+    std::filesystem::create_directories(options.directory, ec);
+
+    const std::string prefix = snapshot_prefix(path);
+    for (int attempt = 0; attempt < std::max(options.max_attempts, 1); ++attempt)
+    {
+        auto fp = FileFingerprint::capture(path);
+        if (!fp)
+            return std::nullopt;
+
+        const std::string target =
+            (std::filesystem::path(options.directory) / snapshot_name(prefix, *fp)).string();
+        if (std::filesystem::exists(target, ec))
+        {
+            return target;
+        }
+        if (auto used = clone_file(path, target))
+        {
+            // Only keep the name if the file held still from naming to copy;
+            // the change time rules out writes that restore mtime.
+            auto now = FileFingerprint::capture(path);
+            if (now && *now == *fp)
+            {
+                method.store(static_cast<int>(*used));
+                prune(path);
+                return target;
+            }
+            std::filesystem::remove(target, ec);
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Snapshots of @p path in the store, oldest first.
+ *
+ * @param path File the snapshots were taken of.
+ * @return Full paths of the snapshots.
+ */
+std::vector<std::string> SnapshotStore::list(const std::string &path) const
+{
+    const std::string prefix = snapshot_prefix(path);
+    std::vector<std::string> found;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(options.directory, ec))
+    {
+        const std::string file = entry.path().filename().string();
+        if (file.compare(0, prefix.size(), prefix) == 0 &&
+            file.size() == prefix.size() + STAMP) // skips ".partial" files
+        {
+            found.push_back(entry.path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+/**
+ * @brief Method used by the most recent successful capture.
+ *
+ * @return The method, or std::nullopt if nothing was captured yet.
+ */
+std::optional<CloneMethod> SnapshotStore::last_method() const
+{
+    const int m = method.load();
+    if (m < 0)
+        return std::nullopt;
+    return static_cast<CloneMethod>(m);
+}
+
+/**
+ * @brief Removes the oldest snapshots of @p path beyond the limit.
+ *
+ * @details
+ * Only snapshots of @p path itself are counted and removed, not those of
+ * other files with the same name.
+ *
+ * @param path File the snapshots were taken of.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+void SnapshotStore::prune(const std::string &path)
+{
+    if (options.keep == 0)
+        return;
+    std::vector<std::string> versions = list(path);
+    std::error_code ec;
+    for (std::size_t i = 0; i + options.keep < versions.size(); ++i)
+    {
+        std::filesystem::remove(versions[i], ec);
+    }
+}
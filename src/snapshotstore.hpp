@@ -0,0 +1,122 @@
+/**
+ * @file snapshotstore.hpp
+ * @brief Point-in-time copies of a file, taken by reflink where possible.
+ *
+ * @details
+ * On copy-on-write file systems (btrfs, XFS with reflink, bcachefs) a
+ * FICLONE ioctl makes the copy share every extent with the original, so
+ * a snapshot costs metadata only, however large the file. Elsewhere
+ * copy_file_range() lets the kernel copy without a round trip through
+ * user space (and NFS or CIFS copy on the server), and a plain read/write
+ * loop covers the rest.
+ *
+ * Snapshots are named after the source's path, change time and size, so
+ * the same version is never stored twice, files that share a name are
+ * kept apart, and names sort in version order.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef SNAPSHOTSTORE_HPP
+#define SNAPSHOTSTORE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @enum CloneMethod
+ * @brief How a snapshot's data was copied.
+ */
+enum class CloneMethod
+{
+    REFLINK,    ///< FICLONE; extents shared, no data copied.
+    COPY_RANGE, ///< copy_file_range(); copied in the kernel.
+    READ_WRITE  ///< Copied through a user-space buffer.
+};
+
+/**
+ * @brief Copies @p source to a new file @p target, preferring a reflink.
+ *
+ * @details
+ * The copy is written under a temporary name and renamed into place, so
+ * @p target never appears partially written. Mode and timestamps are
+ * carried over. If the source changes while being copied (which a
+ * reflink rules out) the copy is discarded.
+ *
+ * @param source File to copy.
+ * @param target Path of the copy; must not exist.
+ * @return The method used, or std::nullopt on failure.
+ */
+std::optional<CloneMethod> clone_file(const std::string &source, const std::string &target);
+
+/**
+ * @struct SnapshotOptions
+ * @brief Where snapshots go and how many are kept.
+ */
+struct SnapshotOptions
+{
+    std::string directory;  ///< Snapshot directory; created if missing.
+    std::size_t keep = 16;  ///< Versions kept per file; 0 keeps all.
+    int max_attempts = 4;   ///< Tries when the source changes mid-copy.
+};
+
+/**
+ * @class SnapshotStore
+ * @brief Keeps the most recent versions of files in one directory.
+ *
+ * @details
+ * A snapshot of @c /etc/app/app.ini is stored as
+ * @c app.ini\@<key>\@<ctime in ns, 20 digits>-<size, 20 digits> in the
+ * snapshot directory, where the key is a 16-digit hex hash of the
+ * canonical path. A write that restores the modification time still
+ * changes the change time, so it is captured as a new version.
+ */
+class SnapshotStore
+{
+public:
+    /**
+     * @brief Creates a store; the directory is created on first use.
+     *
+     * @param options Directory and retention.
+     */
+    explicit SnapshotStore(SnapshotOptions options);
+
+    /**
+     * @brief Snapshots the current version of @p path and prunes old ones.
+     *
+     * @param path File to snapshot.
+     * @return Path of the snapshot (existing if this version was already
+     *         taken), or std::nullopt on failure.
+     */
+    std::optional<std::string> capture(const std::string &path);
+
+    /**
+     * @brief Snapshots of @p path in the store, oldest first.
+     *
+     * @param path File the snapshots were taken of.
+     */
+    std::vector<std::string> list(const std::string &path) const;
+
+    /**
+     * @brief Method used by the most recent successful capture.
+     */
+    std::optional<CloneMethod> last_method() const;
+
+private:
+    /**
+     * @brief Removes the oldest snapshots of @p path beyond the limit.
+     */
+    void prune(const std::string &path);
+
+    const SnapshotOptions options; ///< Directory and retention.
+    std::mutex mutex;              ///< Serializes captures.
+    std::atomic<int> method{-1};   ///< Last CloneMethod, or -1.
+};
+
+#endif // SNAPSHOTSTORE_HPP
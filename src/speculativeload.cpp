@@ -0,0 +1,204 @@
+/**
+ * @file speculativeload.cpp
+ * @brief Implementation file for SpeculativeLoad.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "speculativeload.hpp"
+
+#include <thread>
+
+/**
+ * @brief Creates the loader.
+ *
+ * @param load Load/parse function.
+ * @param commit Commit function.
+ */
+SpeculativeLoad::SpeculativeLoad(LoadFn load, CommitFn commit)
+    : load(std::move(load)),
+      commit(std::move(commit)),
+      epoch(std::make_shared<std::atomic<std::uint64_t>>(0))
+{
+}
+
+/**
+ * @brief Closes the loader and waits for the worker.
+ */
+SpeculativeLoad::~SpeculativeLoad()
+{
+    close();
+}
+
+/**
+ * @brief Starts a speculative attempt.
+ *
+ * @details
+ * The attempt replaces any that is queued but not started, and the one
+ * running is cancelled, so the worker never falls behind a burst of
+ * activity. Exceptions from a speculative load are dropped; confirm()
+ * then falls back to a synchronous load.
+ *
+ * @param path Path of the watched file.
+ */
+void SpeculativeLoad::begin(const std::string &path)
+{
+    auto fingerprint = FileFingerprint::capture(path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || closed)
+    {
+        return;
+    }
+    file_name = path;
+
+    // Cancel whatever is running; its result is never committed.
+    std::uint64_t gen = epoch->fetch_add(1, std::memory_order_acq_rel) + 1;
+    attempt.reset();
+    queued.reset();
+    if (!fingerprint)
+    {
+        return;
+    }
+
+    CancelToken token(epoch, gen);
+    queued = std::make_unique<Task>([this, token]() -> std::shared_ptr<void> {
+        try
+        {
+            return load(token);
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    });
+    attempt = Attempt{*fingerprint, token, queued->get_future().share()};
+    if (!worker.joinable())
+    {
+        worker = std::thread(&SpeculativeLoad::run, this);
+    }
+    wake.notify_one();
+}
+
+/**
+ * @brief Runs queued attempts until halt() asks the worker to exit.
+ */
+void SpeculativeLoad::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this] { return stopping || queued; });
+        if (stopping)
+        {
+            return;
+        }
+        std::unique_ptr<Task> task = std::move(queued);
+        lock.unlock();
+        (*task)();
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Cancels any attempt and waits for the worker to exit.
+ */
+void SpeculativeLoad::stop()
+{
+    halt(false);
+}
+
+/**
+ * @brief Cancels any attempt, waits for the worker and refuses new ones.
+ */
+void SpeculativeLoad::close()
+{
+    halt(true);
+}
+
+/**
+ * @brief Cancels, drops the queued attempt and joins the worker.
+ *
+ * @details
+ * begin() does nothing while stopping is set, so no second worker can
+ * start before the first is joined. A dropped attempt leaves its future
+ * broken, which confirm() treats like a failed load.
+ *
+ * @param final true to refuse later attempts.
+ */
+void SpeculativeLoad::halt(bool final)
+{
+    std::lock_guard<std::mutex> serial(halt_mutex);
+    std::thread running;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        closed = closed || final;
+        epoch->fetch_add(1, std::memory_order_acq_rel);
+        attempt.reset();
+        queued.reset();
+        running = std::move(worker);
+    }
+    wake.notify_all();
+    if (running.joinable())
+    {
+        running.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = false;
+}
+
+/**
+ * @brief Commits a result for a confirmed change.
+ *
+ * @param token Token of the change being dispatched.
+ */
+void SpeculativeLoad::confirm(const CancelToken &token)
+{
+    std::optional<Attempt> current;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = attempt;
+        path = file_name;
+    }
+
+    std::shared_ptr<void> result;
+    if (current && !current->token.cancelled())
+    {
+        auto now = FileFingerprint::capture(path);
+        if (now && *now == current->fingerprint)
+        {
+            // Stable since the attempt started: the speculative work is valid.
+            try
+            {
+                result = current->result.get();
+            }
+            catch (const std::future_error &)
+            {
+                // Dropped before it started; load below instead.
+            }
+            if (current->token.cancelled())
+            {
+                result.reset();
+            }
+        }
+    }
+
+    if (!result)
+    {
+        if (token.cancelled())
+        {
+            return;
+        }
+        result = load(token);
+    }
+
+    if (result && !token.cancelled())
+    {
+        commit(result);
+    }
+}
@@ -0,0 +1,156 @@
+/**
+ * @file speculativeload.hpp
+ * @brief Starts a reload during the debounce window and commits it on confirm.
+ *
+ * @details
+ * A watch waits for several stable polls after the first sign of a change
+ * before it reports the change. A SpeculativeLoad uses that wait: as soon
+ * as activity is seen it starts the user's load function in the
+ * background, tagged with the file's fingerprint at that moment. When the
+ * change is confirmed, the result is committed only if the fingerprint is
+ * unchanged; otherwise (or if the speculative load failed) the load runs
+ * again synchronously. Further activity during the window cancels the
+ * running attempt through its CancelToken and queues a new one.
+ *
+ * Attempts run on one worker thread per SpeculativeLoad. Only the newest
+ * queued attempt is started, so a burst of activity costs at most the
+ * attempt already running plus one more.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef SPECULATIVELOAD_HPP
+#define SPECULATIVELOAD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "canceltoken.hpp"
+#include "fingerprint.hpp"
+
+/**
+ * @class SpeculativeLoad
+ * @brief Type-erased speculative load/commit pair for one subscriber.
+ *
+ * @details
+ * Results are passed around as std::shared_ptr<void>; the typed front end
+ * is MonitorFile::add_speculative_callback(). The worker is owned by the
+ * object: stop(), close() and the destructor cancel the running attempt
+ * and wait for it, so no load runs after they return.
+ */
+class SpeculativeLoad
+{
+public:
+    /// Produces a result; may return early (with nullptr) when cancelled.
+    using LoadFn = std::function<std::shared_ptr<void>(const CancelToken &)>;
+    /// Consumes a result on the dispatch thread.
+    using CommitFn = std::function<void(const std::shared_ptr<void> &)>;
+
+    /**
+     * @brief Creates the loader.
+     *
+     * @param load Load/parse function, run on a background thread or the
+     *        dispatch thread.
+     * @param commit Commit function, run on the dispatch thread.
+     */
+    SpeculativeLoad(LoadFn load, CommitFn commit);
+
+    /**
+     * @brief Closes the loader and waits for the worker.
+     */
+    ~SpeculativeLoad();
+
+    /**
+     * @brief Starts a speculative attempt for the current file contents.
+     *
+     * @details
+     * Called from the polling thread on the first sign of a change and on
+     * every further change during debouncing. Cancels any attempt still
+     * running and never blocks on it. Does nothing while stop() is
+     * waiting or after close().
+     *
+     * @param path Path of the watched file.
+     */
+    void begin(const std::string &path);
+
+    /**
+     * @brief Commits a result for a confirmed change.
+     *
+     * @details
+     * Called from the dispatch thread. Uses the speculative result when
+     * its fingerprint still matches the file, otherwise loads now. Nothing
+     * is committed if @p token is cancelled first.
+     *
+     * @param token Token of the change being dispatched.
+     */
+    void confirm(const CancelToken &token);
+
+    /**
+     * @brief Cancels any attempt and waits for the worker to exit.
+     *
+     * @details
+     * A later begin() starts a new worker. Must not be called from the
+     * load function.
+     */
+    void stop();
+
+    /**
+     * @brief Like stop(), and makes every later begin() do nothing.
+     *
+     * @details
+     * Used when the subscriber is removed, since a notification already
+     * in progress may still call begin().
+     */
+    void close();
+
+private:
+    /**
+     * @brief One background load and the fingerprint it started from.
+     */
+    struct Attempt
+    {
+        FileFingerprint fingerprint;                  ///< File state at begin().
+        CancelToken token;                            ///< Cancelled by the next begin().
+        std::shared_future<std::shared_ptr<void>> result; ///< Filled by the worker.
+    };
+
+    /// An attempt's load, run once by the worker.
+    using Task = std::packaged_task<std::shared_ptr<void>()>;
+
+    /**
+     * @brief Worker thread body; runs queued attempts until stopped.
+     */
+    void run();
+
+    /**
+     * @brief Shared body of stop() and close().
+     *
+     * @param final true to refuse later attempts.
+     */
+    void halt(bool final);
+
+    LoadFn load;                                       ///< User load function.
+    CommitFn commit;                                   ///< User commit function.
+    std::mutex mutex;                                  ///< Guards the fields below.
+    std::string file_name;                             ///< Path from the last begin().
+    std::optional<Attempt> attempt;                    ///< Latest attempt, if any.
+    std::shared_ptr<std::atomic<std::uint64_t>> epoch; ///< Bumped by begin() to cancel.
+    std::unique_ptr<Task> queued;                      ///< Newest attempt not yet started.
+    std::condition_variable wake;                      ///< Signals the worker.
+    std::thread worker;                                ///< Runs attempts; started by begin().
+    bool stopping = false;                             ///< Set while halt() waits.
+    bool closed = false;                               ///< Set by close().
+    std::mutex halt_mutex;                             ///< Serializes halt().
+};
+
+#endif // SPECULATIVELOAD_HPP
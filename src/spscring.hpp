@@ -0,0 +1,107 @@
+/**
+ * @file spscring.hpp
+ * @brief Bounded lock-free single-producer/single-consumer ring buffer.
+ *
+ * @details
+ * One thread may push and one (other) thread may pop concurrently without
+ * locks. The head and tail indices live on separate cache lines so the
+ * producer and consumer do not false-share. Large rings take their slots
+ * from PageAllocator.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef SPSCRING_HPP
+#define SPSCRING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "pagealloc.hpp"
+
+/**
+ * @class SpscRing
+ * @brief Fixed-capacity SPSC queue.
+ *
+ * @tparam T Element type; must be default constructible and movable.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    /**
+     * @brief Creates a ring.
+     *
+     * @param capacity Requested capacity, rounded up to a power of two.
+     * @param numa_node Node for the slots, or -1 for the calling thread's.
+     */
+    explicit SpscRing(std::size_t capacity, int numa_node = -1)
+        : buffer(PageAllocator<T>(numa_node))
+    {
+        std::size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        buffer.resize(cap);
+        mask = cap - 1;
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /**
+     * @brief Appends an element (producer side).
+     *
+     * @param value Element to append.
+     * @return false if the ring is full.
+     */
+    bool push(T value)
+    {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask)
+            return false;
+        buffer[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element (consumer side).
+     *
+     * @param out Receives the element.
+     * @return false if the ring is empty.
+     */
+    bool pop(T &out)
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        out = std::move(buffer[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Approximate number of queued elements.
+     */
+    std::size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Checks whether the ring is (momentarily) empty.
+     */
+    bool empty() const { return size() == 0; }
+
+private:
+    std::vector<T, PageAllocator<T>> buffer;     ///< Element storage.
+    std::size_t mask = 0;                        ///< Capacity minus one.
+    alignas(64) std::atomic<std::size_t> head{0}; ///< Next slot to pop.
+    alignas(64) std::atomic<std::size_t> tail{0}; ///< Next slot to push.
+};
+
+#endif // SPSCRING_HPP
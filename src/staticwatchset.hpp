@@ -0,0 +1,601 @@
+/**
+ * @file staticwatchset.hpp
+ * @brief Compile-time perfect-hash routing for a fixed set of watched files.
+ *
+ * @details
+ * On appliances where the watched files are known at build time, the path
+ * set can be turned into a StaticWatchTable in a constexpr context. The
+ * compiler builds a two-level (hash and displace) perfect hash over the
+ * paths and splits them into parent directories, so looking an entry up
+ * at run time costs one FNV-1a pass over the string, one mix and one
+ * comparison, and nothing is hashed or allocated to build the table at
+ * startup.
+ *
+ * StaticMonitorSet is a self-contained engine for such a table. It owns
+ * one inotify instance watching the table's directories and routes each
+ * event from (directory, name) straight through the perfect hash to a
+ * slot of fixed per-file state; it never touches the WatchRegistry,
+ * InotifyEngine or any dynamic map. Starting it costs one inotify watch
+ * per directory and the reader thread.
+ *
+ * @code
+ * constexpr auto WATCHED = make_watch_table("/etc/app/app.ini", "/etc/app/keys");
+ * StaticMonitorSet<WATCHED.size()> monitors(WATCHED);
+ * monitors.start([](std::size_t index) { reload(index); });
+ * @endcode
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef STATICWATCHSET_HPP
+#define STATICWATCHSET_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flathashmap.hpp"
+
+/**
+ * @brief 64-bit FNV-1a hash of a string, usable in constant expressions.
+ *
+ * @param s String to hash.
+ * @param h Hash of the preceding part of the string, to hash in pieces.
+ * @return The hash value.
+ */
+constexpr std::uint64_t fnv1a_hash(std::string_view s, std::uint64_t h = 0xcbf29ce484222325ULL)
+{
+    for (char c : s)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @class StaticWatchTable
+ * @brief Perfect-hash table over @p N paths, built at compile time.
+ *
+ * @details
+ * Paths are first split into @p N buckets by their hash. Buckets are then
+ * placed largest first: each gets the smallest displacement that maps all
+ * of its paths to unused slots of a table with at least 2N entries. A
+ * lookup reads its bucket's displacement and lands directly on the only
+ * slot that can hold the path.
+ *
+ * Each path is also assigned to its parent directory, given as a prefix
+ * ending in '/' (empty for a bare file name, i.e. the working directory),
+ * so an event naming an entry of a directory can be looked up without
+ * building the full path.
+ *
+ * Duplicate paths are rejected; in a constant expression that is a
+ * compile error.
+ *
+ * @tparam N Number of paths.
+ */
+template <std::size_t N>
+class StaticWatchTable
+{
+    static_assert(N > 0, "StaticWatchTable needs at least one path");
+
+public:
+    /// Number of slots in the routing table (a power of two, at least 2N).
+    static constexpr std::size_t SLOTS = [] {
+        std::size_t s = 2;
+        while (s < 2 * N)
+            s <<= 1;
+        return s;
+    }();
+
+    /// Returned by index_of() for paths not in the table.
+    static constexpr std::size_t npos = N;
+
+    /**
+     * @brief Builds the perfect hash over @p paths.
+     *
+     * @param paths The watched paths; must be distinct.
+     */
+    constexpr explicit StaticWatchTable(const std::array<std::string_view, N> &paths)
+        : keys(paths), displacement(), slot_index(), dir_of(), prefixes(), dirs(0)
+    {
+        for (auto &s : slot_index)
+            s = static_cast<std::uint32_t>(npos);
+
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            const std::size_t slash = keys[i].rfind('/');
+            const std::string_view prefix =
+                slash == std::string_view::npos ? std::string_view() : keys[i].substr(0, slash + 1);
+            std::size_t d = 0;
+            while (d < dirs && prefixes[d] != prefix)
+                ++d;
+            if (d == dirs)
+                prefixes[dirs++] = prefix;
+            dir_of[i] = static_cast<std::uint32_t>(d);
+        }
+
+        std::array<std::uint64_t, N> hashes{};
+        std::array<std::size_t, N> bucket_size{};
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            hashes[i] = fnv1a_hash(keys[i]);
+            ++bucket_size[bucket_of(hashes[i])];
+            for (std::size_t j = 0; j < i; ++j)
+            {
+                if (keys[i] == keys[j])
+                    throw std::logic_error("StaticWatchTable: duplicate path");
+            }
+        }
+
+        std::array<bool, N> placed{};
+        for (std::size_t round = 0; round < N; ++round)
+        {
+            // Pick the largest bucket not yet placed.
+            std::size_t b = 0;
+            std::size_t best = 0;
+            bool found = false;
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                if (!placed[i] && (!found || bucket_size[i] > best))
+                {
+                    b = i;
+                    best = bucket_size[i];
+                    found = true;
+                }
+            }
+            placed[b] = true;
+            if (best == 0)
+                continue;
+
+            for (std::uint32_t d = 0;; ++d)
+            {
+                if (d == 0xFFFFFFu)
+                    throw std::logic_error("StaticWatchTable: no displacement found");
+
+                // Check that every member of the bucket lands on a free,
+                // distinct slot with this displacement.
+                bool ok = true;
+                std::array<std::size_t, N> taken{};
+                std::size_t ntaken = 0;
+                for (std::size_t i = 0; i < N && ok; ++i)
+                {
+                    if (bucket_of(hashes[i]) != b)
+                        continue;
+                    std::size_t slot = slot_of(hashes[i], d);
+                    if (slot_index[slot] != npos)
+                        ok = false;
+                    for (std::size_t t = 0; t < ntaken && ok; ++t)
+                    {
+                        if (taken[t] == slot)
+                            ok = false;
+                    }
+                    taken[ntaken++] = slot;
+                }
+                if (!ok)
+                    continue;
+
+                displacement[b] = d;
+                for (std::size_t i = 0; i < N; ++i)
+                {
+                    if (bucket_of(hashes[i]) == b)
+                        slot_index[slot_of(hashes[i], d)] = static_cast<std::uint32_t>(i);
+                }
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Finds the index of @p path.
+     *
+     * @param path Path to look up.
+     * @return Index into the original path list, or npos if absent.
+     */
+    constexpr std::size_t index_of(std::string_view path) const
+    {
+        const std::uint64_t h = fnv1a_hash(path);
+        const std::size_t i = slot_index[slot_of(h, displacement[bucket_of(h)])];
+        return (i != npos && keys[i] == path) ? i : npos;
+    }
+
+    /**
+     * @brief Finds the index of the entry @p name of directory @p dir.
+     *
+     * @details
+     * Hashes the directory prefix and the name in sequence, exactly as
+     * if they were one string.
+     *
+     * @param dir Directory index, below directory_count().
+     * @param name Entry name within the directory.
+     * @return Index into the original path list, or npos if absent.
+     */
+    constexpr std::size_t index_of(std::size_t dir, std::string_view name) const
+    {
+        const std::string_view prefix = prefixes[dir];
+        const std::uint64_t h = fnv1a_hash(name, fnv1a_hash(prefix));
+        const std::size_t i = slot_index[slot_of(h, displacement[bucket_of(h)])];
+        return (i != npos && dir_of[i] == dir && keys[i].substr(prefix.size()) == name) ? i
+                                                                                        : npos;
+    }
+
+    /**
+     * @brief Returns the path stored at @p index.
+     */
+    constexpr std::string_view path(std::size_t index) const { return keys[index]; }
+
+    /**
+     * @brief Directory index of the path at @p index.
+     */
+    constexpr std::size_t directory_of(std::size_t index) const { return dir_of[index]; }
+
+    /**
+     * @brief Prefix of directory @p dir, ending in '/' or empty.
+     */
+    constexpr std::string_view directory(std::size_t dir) const { return prefixes[dir]; }
+
+    /**
+     * @brief Number of distinct parent directories.
+     */
+    constexpr std::size_t directory_count() const { return dirs; }
+
+    /**
+     * @brief Number of paths in the table.
+     */
+    static constexpr std::size_t size() { return N; }
+
+private:
+    static constexpr std::size_t bucket_of(std::uint64_t h)
+    {
+        return static_cast<std::size_t>(h % N);
+    }
+
+    static constexpr std::size_t slot_of(std::uint64_t h, std::uint32_t d)
+    {
+        return static_cast<std::size_t>(mix_hash(h ^ (static_cast<std::uint64_t>(d) << 32 | d)) &
+                                        (SLOTS - 1));
+    }
+
+    std::array<std::string_view, N> keys;           ///< Paths in declaration order.
+    std::array<std::uint32_t, N> displacement;      ///< Per-bucket displacement.
+    std::array<std::uint32_t, SLOTS> slot_index;    ///< Slot to path index, npos if free.
+    std::array<std::uint32_t, N> dir_of;            ///< Path index to directory index.
+    std::array<std::string_view, N> prefixes;       ///< Directory prefixes; first dirs used.
+    std::size_t dirs;                               ///< Number of distinct directories.
+};
+
+/**
+ * @brief Builds a StaticWatchTable from a list of string literals.
+ *
+ * @param paths The watched paths.
+ * @return The table; use in a constexpr context to build it at compile time.
+ */
+template <typename... Paths>
+constexpr StaticWatchTable<sizeof...(Paths)> make_watch_table(const Paths &...paths)
+{
+    return StaticWatchTable<sizeof...(Paths)>(
+        std::array<std::string_view, sizeof...(Paths)>{std::string_view(paths)...});
+}
+
+/**
+ * @class StaticMonitorSet
+ * @brief Inotify engine for a compile-time fixed set of files.
+ *
+ * @details
+ * A change is reported once a file has been quiet for the settle time
+ * after its last event, and only if the file exists then. If a watched
+ * directory is removed its files are reported as they reappear: the
+ * directory watch is retried about once a second until it succeeds.
+ *
+ * All per-file state lives in fixed arrays; once started, routing and
+ * debouncing do not allocate. The callback runs on the reader thread.
+ *
+ * @tparam N Number of files, matching the StaticWatchTable it is built from.
+ */
+template <std::size_t N>
+class StaticMonitorSet
+{
+public:
+    /**
+     * @brief Binds the set to a routing table.
+     *
+     * @param table Table built (ideally at compile time) from the paths.
+     * @param settle Quiet time after the last event before a change is reported.
+     */
+    explicit StaticMonitorSet(const StaticWatchTable<N> &table,
+                              std::chrono::milliseconds settle = std::chrono::milliseconds(300))
+        : routes(table), quiet(settle)
+    {
+        wds.fill(-1);
+        pending.fill(false);
+    }
+
+    /**
+     * @brief Stops monitoring.
+     */
+    ~StaticMonitorSet() { stop(); }
+
+    StaticMonitorSet(const StaticMonitorSet &) = delete;
+    StaticMonitorSet &operator=(const StaticMonitorSet &) = delete;
+
+    /**
+     * @brief Starts monitoring every file in the set.
+     *
+     * @param on_change Called on the reader thread with the index of each
+     *        file that changed.
+     * @return Number of files that exist and whose directory is watched;
+     *         0 if inotify is unavailable or the set is already running.
+     */
+    std::size_t start(std::function<void(std::size_t)> on_change)
+    {
+        if (reader.joinable())
+        {
+            return 0;
+        }
+        fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        wake_fd = ::eventfd(0, EFD_CLOEXEC);
+        if (fd < 0 || wake_fd < 0)
+        {
+            close_fds();
+            return 0;
+        }
+
+        callback = std::move(on_change);
+        for (std::size_t d = 0; d < routes.directory_count(); ++d)
+        {
+            watch_dir(d);
+        }
+        std::size_t present = 0;
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (wds[routes.directory_of(i)] >= 0 && exists(routes.path(i)))
+                ++present;
+        }
+
+        stopping.store(false);
+        reader = std::thread(&StaticMonitorSet::run, this);
+        return present;
+    }
+
+    /**
+     * @brief Stops the reader; no callback runs after this returns.
+     */
+    void stop()
+    {
+        if (!reader.joinable())
+        {
+            return;
+        }
+        stopping.store(true);
+        const std::uint64_t one = 1;
+        if (::write(wake_fd, &one, sizeof(one)) < 0)
+        {
+            // The reader still sees the flag at its next timeout.
+        }
+        reader.join();
+        close_fds();
+        wds.fill(-1);
+        pending.fill(false);
+    }
+
+    /**
+     * @brief Index of @p path in the set.
+     *
+     * @param path Path as it was listed in the table.
+     * @return The index, or StaticWatchTable<N>::npos if not in the set.
+     */
+    std::size_t index_of(std::string_view path) const { return routes.index_of(path); }
+
+    /**
+     * @brief Routing table the set was built from.
+     */
+    const StaticWatchTable<N> &table() const { return routes; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// Events that can indicate a change to a file inside a watched directory.
+    static constexpr std::uint32_t WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                                                IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                                IN_MOVED_TO;
+
+    /**
+     * @brief Copies @p path into @p buffer with a terminating NUL.
+     *
+     * @return false if the path does not fit.
+     */
+    static bool terminate(std::string_view path, char (&buffer)[PATH_MAX])
+    {
+        if (path.size() >= PATH_MAX)
+            return false;
+        std::memcpy(buffer, path.data(), path.size());
+        buffer[path.size()] = '\0';
+        return true;
+    }
+
+    /**
+     * @brief Whether @p path exists.
+     */
+    static bool exists(std::string_view path)
+    {
+        char buffer[PATH_MAX];
+        struct stat st;
+        return terminate(path, buffer) && ::stat(buffer, &st) == 0;
+    }
+
+    /**
+     * @brief Adds the inotify watch for directory @p d.
+     *
+     * @return true if the directory is watched.
+     */
+    bool watch_dir(std::size_t d)
+    {
+        std::string_view prefix = routes.directory(d);
+        if (prefix.size() > 1)
+            prefix.remove_suffix(1); // "/etc/app/" -> "/etc/app"
+        else if (prefix.empty())
+            prefix = ".";
+        char buffer[PATH_MAX];
+        wds[d] = terminate(prefix, buffer) ? inotify_add_watch(fd, buffer, WATCH_MASK) : -1;
+        return wds[d] >= 0;
+    }
+
+    /**
+     * @brief Marks file @p i as changed, restarting its settle time.
+     */
+    void touch(std::size_t i, Clock::time_point now)
+    {
+        pending[i] = true;
+        deadline[i] = now + quiet;
+    }
+
+    /**
+     * @brief Marks every file of directory @p d, or of all directories if
+     *        @p d is npos, as changed.
+     */
+    void touch_dir(std::size_t d, Clock::time_point now)
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            if (d == StaticWatchTable<N>::npos || routes.directory_of(i) == d)
+                touch(i, now);
+        }
+    }
+
+    /**
+     * @brief Routes one buffer of raw inotify events.
+     */
+    void route(const char *buffer, std::size_t length, Clock::time_point now)
+    {
+        for (std::size_t off = 0; off < length;)
+        {
+            const auto *ev = reinterpret_cast<const struct inotify_event *>(buffer + off);
+            off += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                touch_dir(StaticWatchTable<N>::npos, now);
+                continue;
+            }
+            std::size_t d = 0;
+            while (d < routes.directory_count() && wds[d] != ev->wd)
+                ++d;
+            if (d == routes.directory_count())
+                continue;
+            if (ev->mask & IN_IGNORED)
+            {
+                // The directory went away; retried from run().
+                wds[d] = -1;
+                touch_dir(d, now);
+                continue;
+            }
+            if (ev->len == 0)
+                continue;
+            const std::size_t i = routes.index_of(d, std::string_view(ev->name));
+            if (i != StaticWatchTable<N>::npos)
+                touch(i, now);
+        }
+    }
+
+    /**
+     * @brief Reader thread body: reads events and reports settled changes.
+     */
+    void run()
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        struct pollfd fds[2] = {{fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+
+        while (!stopping.load())
+        {
+            Clock::time_point now = Clock::now();
+            Clock::time_point next = Clock::time_point::max();
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                if (pending[i] && deadline[i] < next)
+                    next = deadline[i];
+            }
+            for (std::size_t d = 0; d < routes.directory_count(); ++d)
+            {
+                if (wds[d] < 0 && now + std::chrono::seconds(1) < next)
+                    next = now + std::chrono::seconds(1);
+            }
+            int timeout = -1;
+            if (next != Clock::time_point::max())
+            {
+                const auto wait = std::chrono::ceil<std::chrono::milliseconds>(next - now);
+                timeout = static_cast<int>(std::max<decltype(wait.count())>(0, wait.count()));
+            }
+
+            if (::poll(fds, 2, timeout) < 0 && errno != EINTR)
+                return;
+            if (stopping.load())
+                return;
+
+            now = Clock::now();
+            if (fds[0].revents & POLLIN)
+            {
+                ssize_t len;
+                while ((len = ::read(fd, buffer, sizeof(buffer))) > 0)
+                    route(buffer, static_cast<std::size_t>(len), now);
+            }
+            for (std::size_t d = 0; d < routes.directory_count(); ++d)
+            {
+                if (wds[d] < 0 && watch_dir(d))
+                    touch_dir(d, now);
+            }
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                if (pending[i] && deadline[i] <= now)
+                {
+                    pending[i] = false;
+                    if (callback && exists(routes.path(i)))
+                        callback(i);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Closes the inotify and wake-up descriptors.
+     */
+    void close_fds()
+    {
+        if (fd >= 0)
+            ::close(fd);
+        if (wake_fd >= 0)
+            ::close(wake_fd);
+        fd = -1;
+        wake_fd = -1;
+    }
+
+    StaticWatchTable<N> routes;                 ///< Compile-time routing table.
+    const std::chrono::milliseconds quiet;      ///< Settle time.
+    std::function<void(std::size_t)> callback;  ///< Change callback.
+    int fd = -1;                                ///< inotify descriptor.
+    int wake_fd = -1;                           ///< eventfd that wakes the reader for stop().
+    std::thread reader;                         ///< Reader thread.
+    std::atomic<bool> stopping{false};          ///< Tells the reader to exit.
+    std::array<int, N> wds;                     ///< Directory to watch descriptor, -1 if none.
+    std::array<bool, N> pending;                ///< File has unreported events.
+    std::array<Clock::time_point, N> deadline;  ///< When a pending file is reported.
+};
+
+#endif // STATICWATCHSET_HPP
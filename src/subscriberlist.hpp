@@ -0,0 +1,189 @@
+/**
+ * @file subscriberlist.hpp
+ * @brief Copy-on-write subscriber array with lock-free readers.
+ *
+ * @details
+ * Holds an immutable array of subscribers behind an atomically swapped
+ * shared pointer (read-copy-update). Dispatch takes a snapshot and iterates
+ * it without holding any lock, so adding or removing a subscriber never
+ * blocks a dispatch in progress. Writers copy the current array, modify the
+ * copy and publish it; the old array is reclaimed when the last reader that
+ * holds its snapshot lets go.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef SUBSCRIBERLIST_HPP
+#define SUBSCRIBERLIST_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Identifier returned when a subscriber is added.
+ *
+ * @details
+ * Zero is never handed out and can be used as "no subscription".
+ */
+using SubscriptionId = std::uint64_t;
+
+/**
+ * @class SubscriberList
+ * @brief RCU-managed list of subscribers of type @p Fn.
+ *
+ * @tparam Fn Callable type stored for each subscriber.
+ */
+template <typename Fn>
+class SubscriberList
+{
+public:
+    /**
+     * @brief A single registered subscriber.
+     */
+    struct Entry
+    {
+        SubscriptionId id; ///< Identifier handed out by add().
+        Fn func;           ///< The subscriber itself.
+    };
+
+    /// Immutable array published to readers.
+    using Snapshot = std::shared_ptr<const std::vector<Entry>>;
+
+    /**
+     * @brief Constructs an empty subscriber list.
+     */
+    SubscriberList()
+        : entries(std::make_shared<const std::vector<Entry>>())
+    {
+    }
+
+    SubscriberList(const SubscriberList &) = delete;
+    SubscriberList &operator=(const SubscriberList &) = delete;
+
+    /**
+     * @brief Adds a subscriber.
+     *
+     * @param func The subscriber to add.
+     * @return The identifier used to remove it again.
+     */
+    SubscriptionId add(Fn func)
+    {
+        SubscriptionId id = next_id.fetch_add(1) + 1;
+        std::lock_guard<std::mutex> lock(write_mutex);
+        auto next = std::make_shared<std::vector<Entry>>(*std::atomic_load(&entries));
+        next->push_back(Entry{id, std::move(func)});
+        std::atomic_store(&entries, Snapshot(std::move(next)));
+        return id;
+    }
+
+    /**
+     * @brief Adds a subscriber under an identifier issued elsewhere.
+     *
+     * @details
+     * Lets a companion list share identifiers with a primary one, so a
+     * single id can remove related entries from both.
+     *
+     * @param id Identifier to store the subscriber under.
+     * @param func The subscriber to add.
+     */
+    void add_as(SubscriptionId id, Fn func)
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        auto next = std::make_shared<std::vector<Entry>>(*std::atomic_load(&entries));
+        next->push_back(Entry{id, std::move(func)});
+        std::atomic_store(&entries, Snapshot(std::move(next)));
+    }
+
+    /**
+     * @brief Replaces the subscriber registered under @p id.
+     *
+     * @details
+     * If @p id is not present (or zero) the subscriber is added instead.
+     *
+     * @param id Identifier of the subscriber to replace.
+     * @param func The replacement subscriber.
+     * @return The identifier of the stored subscriber.
+     */
+    SubscriptionId replace(SubscriptionId id, Fn func)
+    {
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            auto next = std::make_shared<std::vector<Entry>>(*std::atomic_load(&entries));
+            auto it = std::find_if(next->begin(), next->end(),
+                                   [id](const Entry &e) { return e.id == id; });
+            if (it != next->end())
+            {
+                it->func = std::move(func);
+                std::atomic_store(&entries, Snapshot(std::move(next)));
+                return id;
+            }
+        }
+        return add(std::move(func));
+    }
+
+    /**
+     * @brief Removes a subscriber.
+     *
+     * @param id Identifier returned by add().
+     * @return true if a subscriber was removed.
+     */
+    bool remove(SubscriptionId id)
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        auto current = std::atomic_load(&entries);
+        auto next = std::make_shared<std::vector<Entry>>();
+        next->reserve(current->size());
+        for (const auto &e : *current)
+        {
+            if (e.id != id)
+                next->push_back(e);
+        }
+        if (next->size() == current->size())
+            return false;
+        std::atomic_store(&entries, Snapshot(std::move(next)));
+        return true;
+    }
+
+    /**
+     * @brief Removes all subscribers.
+     */
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        std::atomic_store(&entries, std::make_shared<const std::vector<Entry>>());
+    }
+
+    /**
+     * @brief Returns the current immutable subscriber array.
+     *
+     * @details
+     * The snapshot stays valid (and unchanged) for as long as the caller
+     * holds it, regardless of concurrent add() or remove() calls.
+     */
+    Snapshot snapshot() const
+    {
+        return std::atomic_load(&entries);
+    }
+
+    /**
+     * @brief Checks whether any subscriber is registered.
+     */
+    bool empty() const
+    {
+        return snapshot()->empty();
+    }
+
+private:
+    Snapshot entries;                      ///< Published array; accessed atomically.
+    std::mutex write_mutex;                ///< Serializes writers only.
+    std::atomic<SubscriptionId> next_id{0}; ///< Source of subscription identifiers.
+};
+
+#endif // SUBSCRIBERLIST_HPP
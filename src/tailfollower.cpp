@@ -0,0 +1,133 @@
+/**
+ * @file tailfollower.cpp
+ * @brief Implementation file for TailFollower.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "tailfollower.hpp"
+
+/**
+ * @brief Creates the follower.
+ *
+ * @param step Function run on the worker.
+ */
+TailFollower::TailFollower(Step step)
+    : state(std::make_shared<State>(std::move(step)))
+{
+}
+
+/**
+ * @brief Closes the follower and waits for the worker.
+ */
+TailFollower::~TailFollower()
+{
+    close();
+}
+
+/**
+ * @brief Asks the worker to run the step.
+ *
+ * @param settled true when called for a confirmed change.
+ */
+void TailFollower::wake(bool settled)
+{
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->halting || state->closed)
+        {
+            return;
+        }
+        state->pending = true;
+        state->settled = state->settled || settled;
+        if (!worker.joinable())
+        {
+            worker = std::thread(&TailFollower::work, state, state->run);
+        }
+    }
+    state->cv.notify_one();
+}
+
+/**
+ * @brief Runs the step for each batch of wake-ups.
+ *
+ * @param state Shared state.
+ * @param run Value of State::run the worker was started with.
+ */
+void TailFollower::work(std::shared_ptr<State> state, std::uint64_t run)
+{
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (true)
+    {
+        state->cv.wait(lock, [&] { return state->run != run || state->pending; });
+        if (state->run != run)
+        {
+            return;
+        }
+        const bool settled = state->settled;
+        state->pending = false;
+        state->settled = false;
+        lock.unlock();
+        state->step(settled);
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Drops pending wake-ups and waits for the worker.
+ */
+void TailFollower::stop()
+{
+    halt(false);
+}
+
+/**
+ * @brief Drops pending wake-ups, waits for the worker and refuses new ones.
+ */
+void TailFollower::close()
+{
+    halt(true);
+}
+
+/**
+ * @brief Retires the current worker and joins it.
+ *
+ * @details
+ * wake() does nothing while halting is set, so no second worker can start
+ * before the first is joined. From the step itself the worker is detached
+ * instead; it holds its own reference to the state and exits once the
+ * step returns.
+ *
+ * @param final true to refuse later wake-ups.
+ */
+void TailFollower::halt(bool final)
+{
+    std::lock_guard<std::mutex> serial(halt_mutex);
+    std::thread running;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        ++state->run;
+        state->halting = true;
+        state->closed = state->closed || final;
+        state->pending = false;
+        state->settled = false;
+        running = std::move(worker);
+    }
+    state->cv.notify_all();
+    if (running.joinable())
+    {
+        if (running.get_id() == std::this_thread::get_id())
+        {
+            running.detach();
+        }
+        else
+        {
+            running.join();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->halting = false;
+}
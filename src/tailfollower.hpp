@@ -0,0 +1,120 @@
+/**
+ * @file tailfollower.hpp
+ * @brief Runs a tail subscriber's reads on a thread of its own.
+ *
+ * @details
+ * Appended data is worth reading as soon as activity is seen, but the
+ * activity listeners run on a watch's polling thread, which must not
+ * block: a slow sink or a large append there would hold up change
+ * detection for every handle on the watch. A TailFollower gives each tail
+ * subscriber one worker thread. The listeners only wake it; wake-ups that
+ * arrive while it is reading are coalesced into one more read.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef TAILFOLLOWER_HPP
+#define TAILFOLLOWER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @class TailFollower
+ * @brief Worker thread that reads a followed file when woken.
+ *
+ * @details
+ * The state the worker uses is shared with it, so the follower may be
+ * stopped or destroyed from inside its own step function; the worker then
+ * exits once the step returns.
+ */
+class TailFollower
+{
+public:
+    /// One read; @c settled is true if the change was confirmed since the last step.
+    using Step = std::function<void(bool settled)>;
+
+    /**
+     * @brief Creates the follower; the worker starts on the first wake().
+     *
+     * @param step Function run on the worker for each batch of wake-ups.
+     */
+    explicit TailFollower(Step step);
+
+    /**
+     * @brief Closes the follower and waits for the worker.
+     */
+    ~TailFollower();
+
+    TailFollower(const TailFollower &) = delete;
+    TailFollower &operator=(const TailFollower &) = delete;
+
+    /**
+     * @brief Asks the worker to run the step; never blocks on it.
+     *
+     * @details
+     * Does nothing while stop() is waiting or after close().
+     *
+     * @param settled true when called for a confirmed change.
+     */
+    void wake(bool settled);
+
+    /**
+     * @brief Drops pending wake-ups and waits for the worker to exit.
+     *
+     * @details
+     * A later wake() starts a new worker. Called from the step itself, it
+     * does not wait; the worker exits when the step returns.
+     */
+    void stop();
+
+    /**
+     * @brief Like stop(), and makes every later wake() do nothing.
+     */
+    void close();
+
+private:
+    /**
+     * @brief State shared between the follower and its worker.
+     */
+    struct State
+    {
+        explicit State(Step step) : step(std::move(step)) {}
+
+        Step step;                  ///< User read function.
+        std::mutex mutex;           ///< Guards the fields below.
+        std::condition_variable cv; ///< Signals the worker.
+        std::uint64_t run = 0;      ///< Bumped by halt(); a worker with an older value exits.
+        bool pending = false;       ///< A wake-up is waiting for the worker.
+        bool settled = false;       ///< A pending wake-up came from a confirmation.
+        bool halting = false;       ///< Set while halt() waits.
+        bool closed = false;        ///< Set by close().
+    };
+
+    /**
+     * @brief Worker thread body; runs the step until @p run is stale.
+     *
+     * @param state Shared state.
+     * @param run Value of State::run the worker was started with.
+     */
+    static void work(std::shared_ptr<State> state, std::uint64_t run);
+
+    /**
+     * @brief Shared body of stop() and close().
+     *
+     * @param final true to refuse later wake-ups.
+     */
+    void halt(bool final);
+
+    const std::shared_ptr<State> state; ///< Shared with the worker.
+    std::thread worker;                 ///< Current worker; guarded by the state mutex.
+    std::mutex halt_mutex;              ///< Serializes halt().
+};
+
+#endif // TAILFOLLOWER_HPP
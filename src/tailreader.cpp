@@ -0,0 +1,236 @@
+/**
+ * @file tailreader.cpp
+ * @brief Implementation file for TailReader.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "tailreader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Opens @p path for tailing.
+ *
+ * @details
+ * A missing file is not an error; it is opened by the first poll() that
+ * finds it, from the beginning.
+ *
+ * @param path Path to the file.
+ * @param from_end Start at the current end.
+ * @param buffer_size Initial read buffer size.
+ * @param delimiter Line terminator.
+ */
+TailReader::TailReader(std::string path, bool from_end, std::size_t buffer_size, char delimiter)
+    : file_name(std::move(path)), framer(delimiter),
+      buffer(std::max<std::size_t>(buffer_size, 4096))
+{
+    open_file(from_end);
+}
+
+/**
+ * @brief Closes the file.
+ */
+TailReader::~TailReader()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+/**
+ * @brief File offset just past the last delivered line.
+ *
+ * @return The offset.
+ */
+std::uint64_t TailReader::offset() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return read_pos - (tail - head);
+}
+
+/**
+ * @brief Opens the file currently at the path.
+ *
+ * @param at_end Position at the end of the file.
+ * @return true if the file was opened.
+ */
+bool TailReader::open_file(bool at_end)
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    head = tail = 0;
+    read_pos = 0;
+
+    fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    auto fp = FileFingerprint::capture(fd);
+    if (!fp)
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    identity = *fp;
+    read_pos = at_end ? fp->size : 0;
+    resume_from_registry();
+    return true;
+}
+
+/**
+ * @brief Persists progress in @p registry and resumes from it.
+ *
+ * @param new_registry Registry to use, or nullptr.
+ */
+void TailReader::set_registry(std::shared_ptr<TailRegistry> new_registry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    registry = std::move(new_registry);
+    if (fd >= 0)
+    {
+        resume_from_registry();
+    }
+}
+
+/**
+ * @brief Moves to the registry's saved position for the open file.
+ *
+ * @details
+ * Drops any buffered partial line; it lies beyond the saved position and
+ * is read again.
+ */
+void TailReader::resume_from_registry()
+{
+    if (!registry)
+    {
+        return;
+    }
+    FileIdentity id{static_cast<dev_t>(identity.dev), static_cast<ino_t>(identity.ino)};
+    if (auto saved = registry->resume(fd, id))
+    {
+        head = tail = 0;
+        read_pos = *saved;
+    }
+}
+
+/**
+ * @brief Saves the delivered position in the registry.
+ */
+void TailReader::record_position()
+{
+    if (!registry || fd < 0)
+    {
+        return;
+    }
+    FileIdentity id{static_cast<dev_t>(identity.dev), static_cast<ino_t>(identity.ino)};
+    registry->update(fd, id, read_pos - (tail - head));
+}
+
+/**
+ * @brief Reads appended bytes and delivers the complete lines.
+ *
+ * @param sink Called once per buffer of lines read.
+ * @return Number of lines delivered.
+ */
+std::size_t TailReader::poll(const Sink &sink)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (fd < 0 && !open_file(false))
+    {
+        return 0;
+    }
+
+    auto now = FileFingerprint::capture(fd);
+    if (now && now->size < read_pos)
+    {
+        // Truncated in place: start over from the beginning.
+        head = tail = 0;
+        read_pos = 0;
+    }
+
+    std::size_t delivered = drain(sink);
+    record_position();
+
+    auto current = FileFingerprint::capture(file_name);
+    if (current && (current->dev != identity.dev || current->ino != identity.ino))
+    {
+        // Rotated: the old file has been drained above; follow the new one.
+        if (open_file(false))
+        {
+            delivered += drain(sink);
+            record_position();
+        }
+    }
+    return delivered;
+}
+
+/**
+ * @brief Reads and delivers until the open file is exhausted.
+ *
+ * @param sink Receives the lines.
+ * @return Number of lines delivered.
+ */
+std::size_t TailReader::drain(const Sink &sink)
+{
+    std::size_t delivered = 0;
+
+    while (true)
+    {
+        if (tail == buffer.size())
+        {
+            if (head > 0)
+            {
+                // Move the incomplete line to the front to make room.
+                std::memmove(buffer.data(), buffer.data() + head, tail - head);
+                tail -= head;
+                head = 0;
+            }
+            else
+            {
+                // One line fills the whole buffer.
+                buffer.resize(buffer.size() * 2);
+            }
+        }
+
+        ssize_t n = ::pread(fd, buffer.data() + tail, buffer.size() - tail,
+                            static_cast<off_t>(read_pos));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        tail += static_cast<std::size_t>(n);
+        read_pos += static_cast<std::uint64_t>(n);
+
+        lines.clear();
+        head += framer.frame(buffer.data() + head, tail - head, lines);
+        if (!lines.empty())
+        {
+            delivered += lines.size();
+            sink(lines);
+        }
+        if (head == tail)
+        {
+            head = tail = 0;
+        }
+    }
+    return delivered;
+}
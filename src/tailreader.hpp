@@ -0,0 +1,140 @@
+/**
+ * @file tailreader.hpp
+ * @brief Follows bytes appended to a file and hands them out as lines.
+ *
+ * @details
+ * A TailReader keeps the file open and remembers how far it has read.
+ * Each poll() reads whatever was appended since, frames complete lines
+ * with LineFramer and passes them to a sink as string_views into its own
+ * read buffer. An incomplete final line stays in the buffer and the next
+ * read lands directly behind it, so a line split across two reads is
+ * never copied into a separate string; the buffer is only compacted when
+ * the read position reaches its end.
+ *
+ * Truncation restarts reading from the beginning. When the path is
+ * replaced (log rotation), the rest of the old file is drained before
+ * following the new one.
+ *
+ * With a TailRegistry attached, the reader resumes from the position saved
+ * for the open file and records its progress after every poll().
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef TAILREADER_HPP
+#define TAILREADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fingerprint.hpp"
+#include "lineframer.hpp"
+#include "tailregistry.hpp"
+
+/**
+ * @class TailReader
+ * @brief Incremental, zero-copy line reader for a growing file.
+ *
+ * @details
+ * poll() may be called from several threads; calls are serialized.
+ */
+class TailReader
+{
+public:
+    /// Receives each batch; the views are valid only during the call.
+    using Sink = std::function<void(const LineBatch &)>;
+
+    /**
+     * @brief Opens @p path for tailing.
+     *
+     * @param path Path to the file.
+     * @param from_end Start at the current end (true) or the beginning.
+     * @param buffer_size Initial read buffer size; grows for longer lines.
+     * @param delimiter Line terminator.
+     */
+    explicit TailReader(std::string path, bool from_end = true,
+                        std::size_t buffer_size = 1 << 20, char delimiter = '\n');
+
+    /**
+     * @brief Closes the file.
+     */
+    ~TailReader();
+
+    TailReader(const TailReader &) = delete;
+    TailReader &operator=(const TailReader &) = delete;
+
+    /**
+     * @brief Reads appended bytes and delivers the complete lines.
+     *
+     * @param sink Called once per buffer of lines read.
+     * @return Number of lines delivered.
+     */
+    std::size_t poll(const Sink &sink);
+
+    /**
+     * @brief Persists progress in @p registry and resumes from it.
+     *
+     * @details
+     * If the registry holds a valid position for the open file, reading
+     * continues from there instead of where the constructor started. Files
+     * opened later (after rotation) are looked up as well.
+     *
+     * @param registry Registry to use, or nullptr to stop recording.
+     */
+    void set_registry(std::shared_ptr<TailRegistry> registry);
+
+    /**
+     * @brief File offset just past the last delivered line.
+     */
+    std::uint64_t offset() const;
+
+    /**
+     * @brief Path being followed.
+     */
+    const std::string &path() const { return file_name; }
+
+private:
+    /**
+     * @brief Opens the current file at the path; resets the position.
+     *
+     * @param at_end Position at the end of the file instead of the start.
+     * @return true if the file was opened.
+     */
+    bool open_file(bool at_end);
+
+    /**
+     * @brief Moves to the registry's saved position for the open file.
+     */
+    void resume_from_registry();
+
+    /**
+     * @brief Saves the delivered position in the registry.
+     */
+    void record_position();
+
+    /**
+     * @brief Reads and delivers until the open file is exhausted.
+     */
+    std::size_t drain(const Sink &sink);
+
+    const std::string file_name;    ///< Path being followed.
+    const LineFramer framer;        ///< Splits the buffer into lines.
+    mutable std::mutex mutex;       ///< Serializes poll().
+    int fd = -1;                    ///< Open file, -1 if none.
+    FileFingerprint identity;       ///< Version of the open file (dev/ino used).
+    std::uint64_t read_pos = 0;     ///< File offset of the buffer's end.
+    std::vector<char> buffer;       ///< Read buffer.
+    std::size_t head = 0;           ///< Start of the incomplete line.
+    std::size_t tail = 0;           ///< End of valid bytes.
+    LineBatch lines;                ///< Reused batch storage.
+    std::shared_ptr<TailRegistry> registry; ///< Progress store, may be null.
+};
+
+#endif // TAILREADER_HPP
@@ -0,0 +1,330 @@
+/**
+ * @file tailregistry.cpp
+ * @brief Implementation file for TailRegistry.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "tailregistry.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fingerprint.hpp"
+
+/**
+ * @brief Registry file header.
+ */
+struct TailRegistry::Header
+{
+    char magic[8];          ///< "MFTAIL01".
+    std::uint64_t capacity; ///< Number of slots that follow.
+    std::uint8_t reserved[48];
+};
+
+/**
+ * @brief One file's entry; a cache line each.
+ */
+struct alignas(64) TailRegistry::Slot
+{
+    std::uint64_t dev;        ///< Device, 0 when the slot is free.
+    std::uint64_t ino;        ///< Inode.
+    std::uint64_t offset;     ///< Bytes delivered.
+    std::uint64_t head_hash;  ///< Hash of the first head_length bytes.
+    std::uint64_t stamp;      ///< Update counter, for eviction.
+    std::uint32_t head_length; ///< Bytes covered by head_hash.
+    std::uint32_t used;       ///< 1 when the slot holds an entry.
+    std::uint8_t reserved[16];
+};
+
+namespace
+{
+    constexpr char MAGIC[8] = {'M', 'F', 'T', 'A', 'I', 'L', '0', '1'};
+}
+
+/**
+ * @brief Opens or creates a registry file.
+ *
+ * @param path Registry file.
+ * @param capacity Entries to allocate when creating the file.
+ * @param sync_every Updates between asynchronous msync() calls.
+ * @return The registry, or nullptr on failure.
+ */
+std::shared_ptr<TailRegistry> TailRegistry::open(const std::string &path, std::size_t capacity,
+                                                 std::size_t sync_every)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::size_t bytes = static_cast<std::size_t>(st.st_size);
+    const bool fresh = bytes == 0;
+    if (fresh)
+    {
+        bytes = sizeof(Header) + std::max<std::size_t>(capacity, 1) * sizeof(Slot);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+    }
+    if (bytes < sizeof(Header))
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    auto *header = static_cast<Header *>(base);
+    if (fresh)
+    {
+        std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        header->capacity = (bytes - sizeof(Header)) / sizeof(Slot);
+    }
+    else if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+             sizeof(Header) + header->capacity * sizeof(Slot) > bytes ||
+             header->capacity == 0)
+    {
+        ::munmap(base, bytes);
+        return nullptr;
+    }
+
+    return std::shared_ptr<TailRegistry>(new TailRegistry(base, bytes, sync_every));
+}
+
+/**
+ * @brief Wraps a validated mapping and indexes its entries.
+ *
+ * @param base Mapping start.
+ * @param bytes Mapping length.
+ * @param sync_every Updates between asynchronous msync() calls.
+ */
+TailRegistry::TailRegistry(void *base, std::size_t bytes, std::size_t sync_every)
+    : base(base), bytes(bytes), header(static_cast<Header *>(base)),
+      slots(reinterpret_cast<Slot *>(static_cast<char *>(base) + sizeof(Header))),
+      sync_every(std::max<std::size_t>(sync_every, 1))
+{
+    for (std::size_t i = 0; i < header->capacity; ++i)
+    {
+        if (slots[i].used)
+        {
+            index[FileIdentity{static_cast<dev_t>(slots[i].dev),
+                               static_cast<ino_t>(slots[i].ino)}] = i;
+            clock = std::max(clock, slots[i].stamp);
+        }
+    }
+}
+
+/**
+ * @brief Unmaps the registry after a final flush.
+ */
+TailRegistry::~TailRegistry()
+{
+    flush();
+    ::munmap(base, bytes);
+}
+
+/**
+ * @brief Hashes the first bytes of an open file.
+ *
+ * @param fd Open descriptor.
+ * @param length Bytes to hash.
+ * @param hashed Receives the number of bytes hashed.
+ * @return The hash.
+ */
+std::uint64_t TailRegistry::hash_head(int fd, std::uint32_t length, std::uint32_t &hashed)
+{
+    char head[HEAD_BYTES];
+    length = std::min(length, HEAD_BYTES);
+    ssize_t n;
+    do
+    {
+        n = ::pread(fd, head, length, 0);
+    } while (n < 0 && errno == EINTR);
+
+    hashed = n > 0 ? static_cast<std::uint32_t>(n) : 0;
+    return mix_hash(std::hash<std::string_view>()(std::string_view(head, hashed)));
+}
+
+/**
+ * @brief Returns the saved position for an open file, if still valid.
+ *
+ * @param fd Open descriptor of the file.
+ * @param identity Device and inode of @p fd.
+ * @return The offset to resume from, or std::nullopt.
+ */
+std::optional<std::uint64_t> TailRegistry::resume(int fd, const FileIdentity &identity)
+{
+    TailPosition saved;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::size_t *i = index.find(identity);
+        if (!i)
+        {
+            return std::nullopt;
+        }
+        saved.offset = slots[*i].offset;
+        saved.head_hash = slots[*i].head_hash;
+        saved.head_length = slots[*i].head_length;
+    }
+
+    auto fp = FileFingerprint::capture(fd);
+    if (!fp || fp->size < saved.offset)
+    {
+        return std::nullopt;
+    }
+
+    std::uint32_t hashed = 0;
+    std::uint64_t hash = hash_head(fd, saved.head_length, hashed);
+    if (hashed != saved.head_length || hash != saved.head_hash)
+    {
+        return std::nullopt; // inode reused by a different file
+    }
+    return saved.offset;
+}
+
+/**
+ * @brief Records the position reached in an open file.
+ *
+ * @details
+ * The head hash is recomputed only while it covers fewer than HEAD_BYTES
+ * bytes, so steady-state updates cost a few stores.
+ *
+ * @param fd Open descriptor of the file.
+ * @param identity Device and inode of @p fd.
+ * @param offset Bytes delivered so far.
+ */
+void TailRegistry::update(int fd, const FileIdentity &identity, std::uint64_t offset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot &slot = slot_for(identity);
+
+    if (slot.head_length < HEAD_BYTES)
+    {
+        std::uint32_t hashed = 0;
+        slot.head_hash = hash_head(fd, HEAD_BYTES, hashed);
+        slot.head_length = hashed;
+    }
+    slot.offset = offset;
+    slot.stamp = ++clock;
+    note_update();
+}
+
+/**
+ * @brief Forgets the entry for @p identity.
+ *
+ * @param identity Device and inode of the file.
+ */
+void TailRegistry::forget(const FileIdentity &identity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::size_t *i = index.find(identity);
+    if (!i)
+    {
+        return;
+    }
+    std::memset(&slots[*i], 0, sizeof(Slot));
+    index.erase(identity);
+    note_update();
+}
+
+/**
+ * @brief Writes every pending update to disk and waits for it.
+ */
+void TailRegistry::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ::msync(base, bytes, MS_SYNC);
+    unsynced = 0;
+}
+
+/**
+ * @brief Number of files recorded.
+ *
+ * @return Entry count.
+ */
+std::size_t TailRegistry::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+}
+
+/**
+ * @brief Returns the slot for @p identity, claiming one if needed.
+ *
+ * @details
+ * A free slot is preferred; otherwise the least recently updated entry is
+ * evicted.
+ *
+ * @param identity Device and inode of the file.
+ * @return The slot.
+ */
+TailRegistry::Slot &TailRegistry::slot_for(const FileIdentity &identity)
+{
+    if (const std::size_t *i = index.find(identity))
+    {
+        return slots[*i];
+    }
+
+    std::size_t victim = 0;
+    for (std::size_t i = 0; i < header->capacity; ++i)
+    {
+        if (!slots[i].used)
+        {
+            victim = i;
+            break;
+        }
+        if (slots[i].stamp < slots[victim].stamp)
+        {
+            victim = i;
+        }
+    }
+
+    Slot &slot = slots[victim];
+    if (slot.used)
+    {
+        index.erase(FileIdentity{static_cast<dev_t>(slot.dev), static_cast<ino_t>(slot.ino)});
+    }
+    std::memset(&slot, 0, sizeof(Slot));
+    slot.dev = identity.dev;
+    slot.ino = identity.ino;
+    slot.used = 1;
+    index[identity] = victim;
+    return slot;
+}
+
+/**
+ * @brief Counts an update and syncs asynchronously every few.
+ */
+void TailRegistry::note_update()
+{
+    if (++unsynced >= sync_every)
+    {
+        ::msync(base, bytes, MS_ASYNC);
+        unsynced = 0;
+    }
+}
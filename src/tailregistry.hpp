@@ -0,0 +1,161 @@
+/**
+ * @file tailregistry.hpp
+ * @brief Persistent read positions for tailed files.
+ *
+ * @details
+ * A log shipper that restarts must neither re-send nor skip data. A
+ * TailRegistry keeps, for every tailed file, its device, inode, the offset
+ * up to which lines were delivered and a hash of the file's first bytes,
+ * in a small memory-mapped file. Updates are plain stores into the shared
+ * mapping, so they survive a crash of the process; msync() pushes them to
+ * disk every few updates and on flush(). Opening the registry reads that
+ * one file; no log is rescanned.
+ *
+ * The head hash guards against inode reuse: if a file with the recorded
+ * device and inode no longer starts with the same bytes, it is a different
+ * file and is read from the beginning.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef TAILREGISTRY_HPP
+#define TAILREGISTRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "flathashmap.hpp"
+#include "watch.hpp"
+
+/**
+ * @struct TailPosition
+ * @brief Saved position of one file.
+ */
+struct TailPosition
+{
+    std::uint64_t offset = 0;    ///< Bytes already delivered.
+    std::uint64_t head_hash = 0; ///< Hash of the first @ref head_length bytes.
+    std::uint32_t head_length = 0; ///< Bytes covered by @ref head_hash.
+};
+
+/**
+ * @class TailRegistry
+ * @brief Memory-mapped table of (dev, ino) to TailPosition.
+ *
+ * @details
+ * All member functions are thread safe. When the table is full, the
+ * least recently updated entry is reused.
+ */
+class TailRegistry
+{
+public:
+    /// Bytes at the start of a file covered by the head hash.
+    static constexpr std::uint32_t HEAD_BYTES = 256;
+
+    /**
+     * @brief Opens or creates a registry file.
+     *
+     * @param path Registry file.
+     * @param capacity Entries to allocate when creating the file.
+     * @param sync_every Updates between asynchronous msync() calls.
+     * @return The registry, or nullptr if the file cannot be created or
+     *         is not a registry.
+     */
+    static std::shared_ptr<TailRegistry> open(const std::string &path,
+                                              std::size_t capacity = 1024,
+                                              std::size_t sync_every = 64);
+
+    /**
+     * @brief Unmaps the registry after a final flush.
+     */
+    ~TailRegistry();
+
+    TailRegistry(const TailRegistry &) = delete;
+    TailRegistry &operator=(const TailRegistry &) = delete;
+
+    /**
+     * @brief Returns the saved position for an open file, if still valid.
+     *
+     * @details
+     * Fails if nothing is recorded for the file's device and inode, if the
+     * file is now shorter than the saved offset, or if its first bytes no
+     * longer hash to the saved head hash.
+     *
+     * @param fd Open descriptor of the file.
+     * @param identity Device and inode of @p fd.
+     * @return The offset to resume from, or std::nullopt.
+     */
+    std::optional<std::uint64_t> resume(int fd, const FileIdentity &identity);
+
+    /**
+     * @brief Records the position reached in an open file.
+     *
+     * @param fd Open descriptor of the file.
+     * @param identity Device and inode of @p fd.
+     * @param offset Bytes delivered so far.
+     */
+    void update(int fd, const FileIdentity &identity, std::uint64_t offset);
+
+    /**
+     * @brief Forgets the entry for @p identity.
+     */
+    void forget(const FileIdentity &identity);
+
+    /**
+     * @brief Writes every pending update to disk and waits for it.
+     */
+    void flush();
+
+    /**
+     * @brief Number of files recorded.
+     */
+    std::size_t size();
+
+    /**
+     * @brief Hashes the first @p length bytes of an open file.
+     *
+     * @param fd Open descriptor.
+     * @param length Bytes to hash; fewer are hashed if the file is shorter.
+     * @param hashed Receives the number of bytes actually hashed.
+     * @return The hash.
+     */
+    static std::uint64_t hash_head(int fd, std::uint32_t length, std::uint32_t &hashed);
+
+private:
+    struct Header;
+    struct Slot;
+
+    TailRegistry(void *base, std::size_t bytes, std::size_t sync_every);
+
+    /**
+     * @brief Returns the slot for @p identity, claiming one if needed.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    Slot &slot_for(const FileIdentity &identity);
+
+    /**
+     * @brief Counts an update and syncs asynchronously every few.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void note_update();
+
+    std::mutex mutex;                                    ///< Guards the mapping and index.
+    void *base;                                          ///< Mapping start.
+    std::size_t bytes;                                   ///< Mapping length.
+    Header *header;                                      ///< File header in the mapping.
+    Slot *slots;                                         ///< Entries in the mapping.
+    FlatHashMap<FileIdentity, std::size_t, FileIdentityHash> index; ///< Identity to slot.
+    std::size_t sync_every;                              ///< Updates between msync() calls.
+    std::size_t unsynced = 0;                            ///< Updates since the last msync().
+    std::uint64_t clock = 0;                             ///< Update counter for eviction.
+};
+
+#endif // TAILREGISTRY_HPP
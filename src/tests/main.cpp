@@ -0,0 +1,1003 @@
+/**
+ * @file main.cpp
+ * @brief Regression tests for the MonitorFile internals.
+ *
+ * @details
+ * Built and run with `make check`. Each test prints one line and the
+ * program exits non-zero if any check failed. Tests work in a fresh
+ * directory under /tmp.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "inotifyengine.hpp"
+#include "mappedfile.hpp"
+#include "mergedtail.hpp"
+#include "monitorfile.hpp"
+#include "regiondiff.hpp"
+#include "reloadpipeline.hpp"
+#include "snapshotstore.hpp"
+#include "staticwatchset.hpp"
+#include "treedigest.hpp"
+#include "uringreader.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+/// Number of failed checks.
+static int failures = 0;
+
+/**
+ * @brief Records one check.
+ *
+ * @param ok Outcome.
+ * @param what Description printed on failure.
+ */
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::printf("    FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+/**
+ * @brief Waits up to two seconds for @p done to hold.
+ *
+ * @return The final value of @p done.
+ */
+template <typename Pred>
+static bool eventually(Pred done)
+{
+    for (int i = 0; i < 200 && !done(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return done();
+}
+
+/**
+ * @brief Creates a fresh scratch directory.
+ */
+static fs::path scratch()
+{
+    char name[] = "/tmp/monitorfile-test-XXXXXX";
+    return fs::path(::mkdtemp(name));
+}
+
+/**
+ * @brief Appends a line to @p path, creating it if needed.
+ */
+static void append(const fs::path &path)
+{
+    std::ofstream(path, std::ios::app) << "x\n";
+}
+
+/**
+ * @brief A file is renamed over another path and watched there too.
+ *
+ * @details
+ * After rotation the old inode lives under the new name while the first
+ * watch keeps polling the old name; a handle opened on the new name must
+ * get its own watch, not share the one polling the other file.
+ */
+static void test_rotated_identity()
+{
+    std::printf("  registry: file renamed over another path\n");
+    const fs::path root = scratch();
+    const fs::path log = root / "a.log";
+    const fs::path rotated = root / "a.log.1";
+    append(log);
+    append(rotated);
+
+    std::atomic<int> current{0};
+    std::atomic<int> old{0};
+    MonitorFile first;
+    first.set_backend(MonitorBackend::POLLING);
+    first.set_polling_interval(std::chrono::milliseconds(10));
+    first.filemon(log.string(), [&] { ++current; });
+
+    fs::rename(log, rotated);
+    append(log);
+    check(eventually([&] { return current > 0; }), "new file under the old name seen");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    MonitorFile second;
+    second.set_backend(MonitorBackend::POLLING);
+    second.set_polling_interval(std::chrono::milliseconds(10));
+    second.filemon(rotated.string(), [&] { ++old; });
+    current = 0;
+
+    append(rotated);
+    check(eventually([&] { return old == 1; }), "write to the rotated file reported");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    check(current == 0, "handle on the old name not told");
+
+    append(log);
+    check(eventually([&] { return current == 1; }), "write to the new file reported");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    check(old == 1, "handle on the rotated file not told");
+
+    first.stop();
+    second.stop();
+    fs::remove_all(root);
+}
+
+/**
+ * @brief A watched directory is deleted and re-created.
+ *
+ * @details
+ * The kernel drops the watch; registrations must detach, then re-attach
+ * when the directory is registered again, and see events from the new
+ * directory.
+ */
+static void test_directory_recreated()
+{
+    std::printf("  inotify: directory deleted and re-created\n");
+    InotifyEngine &engine = InotifyEngine::instance();
+    const fs::path root = scratch();
+    const fs::path dir = root / "d";
+    fs::create_directory(dir);
+    append(dir / "f");
+
+    std::atomic<int> file_events{0};
+    std::atomic<int> dir_events{0};
+    auto file = engine.add((dir / "f").string(), [&] { ++file_events; });
+    auto whole = engine.add_directory(dir.string(), [&](std::string_view) { ++dir_events; });
+    check(file && whole, "registered");
+
+    fs::remove_all(dir);
+    check(eventually([&] { return !engine.attached(file) && !engine.attached(whole); }),
+          "detached after the directory was deleted");
+
+    fs::create_directory(dir);
+    auto other = engine.add((dir / "g").string(), [] {});
+    check(engine.attached(file) && engine.attached(whole),
+          "re-attached when the directory was registered again");
+
+    file_events = 0;
+    dir_events = 0;
+    append(dir / "f");
+    check(eventually([&] { return file_events > 0 && dir_events > 0; }),
+          "events from the re-created directory");
+
+    engine.remove(other);
+    engine.remove(whole);
+    engine.remove(file);
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Two paths reach one directory and one registration is removed.
+ *
+ * @details
+ * The kernel has one watch for the directory inode; removing the
+ * registration made through the stale path must not drop it.
+ */
+static void test_two_paths_one_inode()
+{
+    std::printf("  inotify: two paths to one directory, remove one\n");
+    InotifyEngine &engine = InotifyEngine::instance();
+    const fs::path root = scratch();
+    const fs::path d1 = root / "d1";
+    const fs::path d2 = root / "d2";
+    fs::create_directory(d1);
+
+    std::atomic<int> events{0};
+    auto first = engine.add_directory(d1.string(), [](std::string_view) {});
+    fs::rename(d1, d2);
+    auto second = engine.add_directory(d2.string(), [&](std::string_view) { ++events; });
+    check(first && second, "registered");
+
+    engine.remove(first);
+    check(engine.attached(second), "remaining registration still attached");
+    append(d2 / "f");
+    check(eventually([&] { return events > 0; }), "events after removing the other path");
+
+    engine.remove(second);
+    fs::remove_all(root);
+}
+
+/**
+ * @brief A fixed set routes its events through its own table.
+ *
+ * @details
+ * Changes must be reported with the right index, including for a file
+ * created after start, without registering anything with InotifyEngine.
+ */
+static void test_static_set()
+{
+    constexpr auto FIXED = make_watch_table("/etc/app/app.ini", "/etc/app/keys", "local.ini");
+    static_assert(FIXED.directory_count() == 2, "directories split at compile time");
+    static_assert(FIXED.index_of(FIXED.directory_of(1), "keys") == 1, "entry lookup");
+    static_assert(FIXED.index_of(FIXED.directory_of(2), "local.ini") == 2, "bare name lookup");
+
+    std::printf("  static set: events routed through the perfect hash\n");
+    const fs::path root = scratch();
+    fs::create_directory(root / "sub");
+    const std::string a = (root / "a.ini").string();
+    const std::string b = (root / "sub" / "b.ini").string();
+    const std::string c = (root / "c.ini").string();
+    append(a);
+    append(b);
+
+    const StaticWatchTable<3> table(std::array<std::string_view, 3>{a, b, c});
+    check(table.directory_count() == 2, "two directories");
+    StaticMonitorSet<3> set(table, std::chrono::milliseconds(50));
+
+    const std::size_t routes = InotifyEngine::instance().route_count();
+    std::array<std::atomic<int>, 3> hits{};
+    check(set.start([&](std::size_t i) { ++hits[i]; }) == 2, "two files present at start");
+    check(InotifyEngine::instance().route_count() == routes, "nothing added to InotifyEngine");
+
+    append(b);
+    check(eventually([&] { return hits[1] == 1; }), "change to the file in the subdirectory");
+    append(c);
+    check(eventually([&] { return hits[2] == 1; }), "file created after start");
+    append(root / "unrelated");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    check(hits[0] == 0, "no report for an untouched file");
+
+    set.stop();
+    append(a);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    check(hits[0] == 0, "no report after stop");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief The last handle on a watch is stopped from its own callback.
+ *
+ * @details
+ * Dropping the watch there must not join the thread running the callback.
+ */
+static void test_stop_from_callback()
+{
+    std::printf("  dispatch: last handle stopped from its callback\n");
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    append(file);
+
+    std::atomic<bool> stopped{false};
+    MonitorFile monitor;
+    monitor.set_backend(MonitorBackend::POLLING);
+    monitor.set_polling_interval(std::chrono::milliseconds(10));
+    monitor.filemon(file.string(), [&] {
+        monitor.stop();
+        stopped = true;
+    });
+
+    append(file);
+    check(eventually([&] { return stopped.load(); }), "callback returned after stop()");
+    check(monitor.get_state() == MonitorState::NOT_MONITORING, "handle stopped");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Speculative loads stay on one worker and stop with the subscriber.
+ *
+ * @details
+ * A burst of writes must not pile up concurrent loads, and no load may be
+ * running or start once remove_callback() has returned.
+ */
+static void test_speculative_bounded()
+{
+    std::printf("  speculative: one worker, joined on removal\n");
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    append(file);
+
+    std::atomic<int> active{0};
+    std::atomic<int> peak{0};
+    std::atomic<int> calls{0};
+    MonitorFile monitor;
+    monitor.set_backend(MonitorBackend::POLLING);
+    monitor.set_polling_interval(std::chrono::milliseconds(10));
+    monitor.filemon(file.string());
+    SubscriptionId id = monitor.add_speculative_callback<int>(
+        [&](const CancelToken &token) {
+            int now = ++active;
+            int seen = peak;
+            while (now > seen && !peak.compare_exchange_weak(seen, now))
+            {
+            }
+            for (int i = 0; i < 10 && !token.cancelled(); ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ++calls;
+            --active;
+            return 0;
+        },
+        [](int &) {});
+
+    for (int i = 0; i < 40; ++i)
+    {
+        append(file);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    check(eventually([&] { return calls > 0; }), "loads ran");
+    check(peak <= 2, "at most the worker and the dispatch thread load at once");
+
+    append(file);
+    monitor.remove_callback(id);
+    check(active == 0, "no load running after remove_callback");
+    const int after = calls;
+    append(file);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    check(calls == after, "no load started after remove_callback");
+
+    monitor.stop();
+    fs::remove_all(root);
+}
+
+/**
+ * @brief A mapped file is truncated in place.
+ *
+ * @details
+ * The slot must notice the shrink and publish a copy covering only the
+ * bytes that remain; the test reads every byte it is given.
+ */
+static void test_mapping_truncated()
+{
+    std::printf("  mapping: file truncated in place\n");
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    std::ofstream(file) << std::string(3 * 4096, 'a');
+
+    MappingSlot slot;
+    slot.set_path(file.string());
+    check(slot.refresh() && slot.current()->size() == 3 * 4096, "mapped");
+
+    fs::resize_file(file, 10);
+    check(slot.refresh(), "refreshed after the truncation");
+    auto view = slot.current();
+    check(view && view->size() == 10, "new version has the remaining bytes");
+    check(view && view->view() == std::string(10, 'a'), "contents readable");
+
+    append(file);
+    check(slot.refresh() && slot.current()->view() == std::string(10, 'a') + "x\n",
+          "later versions copied");
+
+    auto copied = MappedFile::copy(file.string());
+    check(copied && copied->size() == 12, "copy of the whole file");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Two handles on one file get their contents from one read.
+ */
+static void test_content_shared_by_handles()
+{
+    std::printf("  content: one read per change across handles\n");
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    append(file);
+
+    std::mutex mutex;
+    std::vector<ContentBuffer> seen;
+    auto record = [&](const FileContent &content) {
+        std::lock_guard<std::mutex> lock(mutex);
+        seen.push_back(content.data);
+    };
+    MonitorFile first;
+    MonitorFile second;
+    for (MonitorFile *monitor : {&first, &second})
+    {
+        monitor->set_backend(MonitorBackend::POLLING);
+        monitor->set_polling_interval(std::chrono::milliseconds(10));
+        monitor->filemon(file.string());
+        monitor->add_content_callback(record);
+    }
+
+    append(file);
+    check(eventually([&] {
+              std::lock_guard<std::mutex> lock(mutex);
+              return seen.size() == 2;
+          }),
+          "both handles notified");
+    std::lock_guard<std::mutex> lock(mutex);
+    check(seen.size() == 2 && seen[0] == seen[1], "same buffer for both handles");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Many producers feed a pipeline and it drains completely.
+ *
+ * @details
+ * Workers may pop a job before its producer has counted it; every job
+ * must still be accounted for and wait_idle() must return.
+ */
+static void test_pipeline_drains()
+{
+    std::printf("  pipeline: concurrent submits drain\n");
+    const fs::path root = scratch();
+    std::vector<std::string> files;
+    for (int i = 0; i < 16; ++i)
+    {
+        files.push_back((root / std::to_string(i)).string());
+        append(files.back());
+    }
+
+    PipelineOptions options;
+    options.queue_capacity = 8;
+    ReloadPipeline pipeline([](const std::string &, const FileContent &) {
+                                return std::make_shared<int>(0);
+                            },
+                            [](const std::string &, const std::shared_ptr<void> &) {}, options);
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t)
+    {
+        producers.emplace_back([&] {
+            for (int i = 0; i < 200; ++i)
+            {
+                pipeline.submit(files[i % files.size()]);
+            }
+        });
+    }
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+    pipeline.wait_idle();
+
+    const auto stats = pipeline.stats();
+    check(stats.submitted > 0, "jobs accepted");
+    check(stats.published + stats.unchanged + stats.failed + stats.stale == stats.submitted,
+          "every accepted job accounted for");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief A slow parse stage holds up the stages feeding it.
+ *
+ * @details
+ * Upstream workers facing a full queue must sleep, not spin; the process
+ * should use far less CPU time than the wall time the backlog takes.
+ */
+static void test_pipeline_backpressure()
+{
+    std::printf("  pipeline: full stage blocks its producers\n");
+    const fs::path root = scratch();
+    std::vector<std::string> files;
+    for (int i = 0; i < 12; ++i)
+    {
+        files.push_back((root / std::to_string(i)).string());
+        std::ofstream(files.back()) << i << "\n";
+    }
+
+    PipelineOptions options;
+    options.queue_capacity = 2;
+    options.parse_workers = 1;
+    ReloadPipeline pipeline([](const std::string &, const FileContent &) {
+                                std::this_thread::sleep_for(std::chrono::milliseconds(25));
+                                return std::make_shared<int>(0);
+                            },
+                            [](const std::string &, const std::shared_ptr<void> &) {}, options);
+
+    const auto wall = std::chrono::steady_clock::now();
+    const std::clock_t cpu = std::clock();
+    for (const auto &file : files)
+    {
+        while (!pipeline.submit(file))
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    pipeline.wait_idle();
+    const double cpu_ms = 1000.0 * static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC;
+    const double wall_ms = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - wall)
+                               .count();
+
+    check(pipeline.stats().published == files.size(), "every file published");
+    check(cpu_ms < wall_ms / 2, "producers slept while the stage was full");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief A tail sink that blocks does not hold up change detection.
+ *
+ * @details
+ * Appended data is read as soon as activity is seen; that read and the
+ * sink must run off the watch's polling thread, so another handle on the
+ * same file still gets its change confirmed.
+ */
+static void test_tail_off_polling_thread()
+{
+    std::printf("  tail: blocked sink leaves detection running\n");
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    append(file);
+
+    std::atomic<bool> release{false};
+    std::atomic<int> batches{0};
+    std::atomic<int> changes{0};
+    MonitorFile tail;
+    MonitorFile other;
+    for (MonitorFile *monitor : {&tail, &other})
+    {
+        monitor->set_backend(MonitorBackend::POLLING);
+        monitor->set_polling_interval(std::chrono::milliseconds(10));
+    }
+    tail.filemon(file.string());
+    tail.add_tail_callback([&](const LineBatch &) {
+        ++batches;
+        while (!release)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    });
+    other.filemon(file.string(), [&] { ++changes; });
+
+    append(file);
+    check(eventually([&] { return batches > 0; }), "sink called");
+    check(eventually([&] { return changes == 1; }), "change confirmed while the sink blocks");
+    release = true;
+
+    tail.stop();
+    other.stop();
+    fs::remove_all(root);
+}
+
+/**
+ * @brief A merged file that never produces lines does not stall the rest.
+ */
+static void test_merge_silent_source()
+{
+    std::printf("  merge: silent file left out of the watermark\n");
+    const fs::path root = scratch();
+    const fs::path busy = root / "busy.log";
+    const fs::path quiet = root / "quiet.log";
+    append(busy);
+    append(quiet);
+
+    std::atomic<int> lines{0};
+    MergedTail merge([&](std::string_view, std::size_t, std::int64_t) { ++lines; });
+    check(merge.add(busy.string()) && merge.add(quiet.string()), "both files added");
+
+    std::ofstream(busy, std::ios::app) << "2025-01-01 00:00:01 one\n"
+                                       << "2025-01-01 00:00:02 two\n";
+    check(eventually([&] { return lines == 2; }), "lines released without flush()");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Incremental updates of a large directory match a fresh scan.
+ *
+ * @details
+ * The directory spans several chunks; inserts, removals and changes at
+ * both ends and in the middle must give the digest a full scan gives, and
+ * a diff must report just the touched entries.
+ */
+static void test_tree_digest_chunks()
+{
+    std::printf("  tree digest: chunked directory updates\n");
+    const fs::path root = scratch();
+    for (int i = 0; i < 300; ++i)
+    {
+        append(root / ("f" + std::to_string(1000 + i)));
+    }
+
+    TreeDigest tree(root.string());
+    const TreeDigest::Snapshot before = tree.snapshot();
+    check(before->children.size() == 300, "every entry listed");
+
+    fs::remove(root / "f1000");
+    fs::remove(root / "f1150");
+    append(root / "f1299");
+    append(root / "a");
+    append(root / "z");
+    for (const char *name : {"f1000", "f1150", "f1299", "a", "z"})
+    {
+        tree.update(name);
+    }
+
+    check(tree.digest() == TreeDigest(root.string()).digest(), "same digest as a fresh scan");
+    int changes = 0;
+    TreeDigest::diff(before, tree.snapshot(),
+                     [&](const std::string &, TreeDigest::Change) { ++changes; });
+    check(changes == 5, "diff reports the touched entries only");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief An in-place overwrite is found even though no extent moved.
+ */
+static void test_region_overwrite()
+{
+    std::printf("  regions: in-place overwrite and holes\n");
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    constexpr std::size_t BLOCK = 64 * 1024;
+    {
+        std::ofstream out(file);
+        out << std::string(BLOCK, 'a');
+        out.seekp(3 * BLOCK);
+        out << std::string(BLOCK, 'b');
+    }
+
+    RegionStats stats;
+    auto before = map_regions(file.string(), BLOCK, &stats);
+    check(before && stats.hashed == 2 * BLOCK, "data blocks hashed, hole skipped");
+
+    {
+        std::fstream out(file, std::ios::in | std::ios::out | std::ios::binary);
+        out.seekp(3 * BLOCK + 10);
+        out << "changed";
+    }
+    std::vector<ByteRange> changed;
+    auto after = before ? diff_regions(*before, file.string(), changed) : std::nullopt;
+    check(after && changed.size() == 1 && changed[0].offset == 3 * BLOCK &&
+              changed[0].length == BLOCK,
+          "overwritten block reported");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Blocks still shared with a reflink copy are not read again.
+ *
+ * @details
+ * Only runs where the scratch file system supports reflinks.
+ */
+static void test_region_shared()
+{
+    std::printf("  regions: shared extents reused without reading\n");
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    const fs::path copy = root / "g";
+    constexpr std::size_t BLOCK = 64 * 1024;
+    std::ofstream(file) << std::string(BLOCK, 'a') << std::string(BLOCK, 'b');
+
+    const int in = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    const int out = ::open(copy.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    const bool cloned = in >= 0 && out >= 0 && ::ioctl(out, FICLONE, in) == 0;
+    ::close(in);
+    ::close(out);
+    if (!cloned)
+    {
+        fs::remove_all(root);
+        return;
+    }
+
+    auto before = map_regions(file.string(), BLOCK);
+    {
+        std::fstream write(file, std::ios::in | std::ios::out | std::ios::binary);
+        write.seekp(BLOCK + 10);
+        write << "changed";
+    }
+    RegionStats stats;
+    std::vector<ByteRange> changed;
+    auto after = before ? diff_regions(*before, file.string(), changed, &stats) : std::nullopt;
+    check(after && changed.size() == 1 && changed[0].offset == BLOCK, "written block reported");
+    check(stats.skipped_extents == BLOCK && stats.hashed == BLOCK, "shared block not read");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Snapshots are per file and see writes that restore mtime.
+ */
+static void test_snapshot_keys()
+{
+    std::printf("  snapshots: keyed by path, change time and size\n");
+    const fs::path root = scratch();
+    fs::create_directory(root / "a");
+    fs::create_directory(root / "b");
+    const fs::path first = root / "a" / "app.ini";
+    const fs::path second = root / "b" / "app.ini";
+    append(first);
+    append(second);
+    fs::last_write_time(second, fs::last_write_time(first));
+
+    SnapshotStore store(SnapshotOptions{(root / "store").string(), 1});
+    auto a1 = store.capture(first.string());
+    auto b1 = store.capture(second.string());
+    check(a1 && b1 && *a1 != *b1, "same name and mtime, different files");
+
+    const auto stamp = fs::last_write_time(first);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(first) << "y\n";
+    fs::last_write_time(first, stamp);
+    auto a2 = store.capture(first.string());
+    check(a2 && *a2 != *a1, "write that restores mtime is a new version");
+
+    check(store.list(first.string()).size() == 1, "older version of one file pruned");
+    check(store.list(second.string()).size() == 1, "other file's snapshot kept");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Collects the lines a UringReader delivers, per path.
+ */
+struct UringLines
+{
+    std::mutex mutex;
+    std::vector<std::string> lines;
+
+    UringReader::Sink sink()
+    {
+        return [this](const std::string &, const LineBatch &batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto line : batch)
+                lines.emplace_back(line);
+        };
+    }
+
+    std::vector<std::string> take()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::move(lines);
+    }
+};
+
+/**
+ * @brief A file followed through io_uring is rotated and then truncated.
+ *
+ * @details
+ * Rotation must drain the rest of the old file before the new one is read
+ * from the start; truncation must restart at the beginning. A queue
+ * smaller than the files' reads keeps every line too.
+ */
+static void test_uring_rotation()
+{
+    std::printf("  uring: tail across rotation and truncation\n");
+    UringOptions options;
+    options.queue_depth = 4;
+    options.buffers = 4;
+    auto reader = UringReader::create(options);
+    if (!reader)
+    {
+        std::printf("    skipped: io_uring unavailable\n");
+        return;
+    }
+    const fs::path root = scratch();
+    const fs::path file = root / "f";
+    std::ofstream(file) << "a\n";
+
+    UringLines got;
+    reader->add(file.string(), true, got.sink());
+    std::vector<fs::path> others;
+    for (int i = 0; i < 6; ++i)
+    {
+        others.push_back(root / ("o" + std::to_string(i)));
+        std::ofstream(others.back()) << "x\n";
+        reader->add(others.back().string(), false, got.sink());
+    }
+    reader->poll(UringReader::Sink());
+    check(got.take().size() == others.size(), "each other file read with a small queue");
+
+    std::ofstream(file, std::ios::app) << "b\n";
+    fs::rename(file, root / "f.1");
+    std::ofstream(file) << "c\n";
+    reader->poll(UringReader::Sink());
+    check(got.take() == std::vector<std::string>{"b", "c"}, "old file drained, new one read");
+
+    std::ofstream(file, std::ios::app) << "ccc\n";
+    reader->poll(UringReader::Sink());
+    got.take();
+    std::ofstream(file, std::ios::trunc) << "d\n";
+    reader->poll(UringReader::Sink());
+    check(got.take() == std::vector<std::string>{"d"}, "truncated file read from the start");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Two monitors follow their files through one shared reader.
+ */
+static void test_uring_monitors()
+{
+    std::printf("  uring: monitors share a reader\n");
+    std::shared_ptr<UringReader> reader = UringReader::create();
+    if (!reader)
+    {
+        std::printf("    skipped: io_uring unavailable\n");
+        return;
+    }
+    const fs::path root = scratch();
+    const fs::path first = root / "a";
+    const fs::path second = root / "b";
+    append(first);
+    append(second);
+
+    UringLines a;
+    UringLines b;
+    MonitorFile ma;
+    MonitorFile mb;
+    ma.set_backend(MonitorBackend::POLLING);
+    mb.set_backend(MonitorBackend::POLLING);
+    ma.set_polling_interval(std::chrono::milliseconds(10));
+    mb.set_polling_interval(std::chrono::milliseconds(10));
+    ma.filemon(first.string());
+    mb.filemon(second.string());
+    const SubscriptionId ida = ma.add_uring_tail_callback(reader, a.sink());
+    const SubscriptionId idb = mb.add_uring_tail_callback(reader, b.sink());
+    check(ida && idb && reader->size() == 2, "both files added");
+    check(!ma.add_uring_tail_callback(reader, a.sink()), "second add of one file refused");
+
+    std::vector<std::string> seen;
+    std::ofstream(second, std::ios::app) << "two\n";
+    check(eventually([&] {
+              for (auto &line : b.take())
+                  seen.push_back(line);
+              return seen == std::vector<std::string>{"two"};
+          }),
+          "line reaches its own sink");
+    check(a.take().empty(), "other file's sink not called");
+
+    mb.remove_callback(idb);
+    check(eventually([&] { return reader->size() == 1; }), "removed subscriber leaves the reader");
+    ma.stop();
+    mb.stop();
+    fs::remove_all(root);
+}
+
+/**
+ * @brief load() refuses a file that grows while it is read.
+ */
+static void test_uring_load_growing()
+{
+    std::printf("  uring: load of a growing file\n");
+    auto reader = UringReader::create();
+    if (!reader)
+    {
+        std::printf("    skipped: io_uring unavailable\n");
+        return;
+    }
+    const fs::path root = scratch();
+    const fs::path file = root / "big";
+    std::ofstream(file) << std::string(8 << 20, 'x');
+
+    int loaded = 0;
+    int refused = 0;
+    bool consistent = true;
+    auto sink = [&](const std::string &, std::optional<FileContent> content) {
+        if (!content)
+        {
+            ++refused;
+            return;
+        }
+        ++loaded;
+        consistent = consistent && content->view().size() == content->fingerprint.size;
+    };
+    check(reader->load({file.string()}, sink) == 1 && loaded == 1, "stable file loaded");
+
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        std::ofstream out(file, std::ios::app);
+        while (!stop)
+            out << "y" << std::flush;
+    });
+    for (int i = 0; i < 20; ++i)
+        reader->load({file.string()}, sink);
+    stop = true;
+    writer.join();
+    check(refused > 0, "growing file refused");
+    check(consistent, "accepted contents match their fingerprint");
+    fs::remove_all(root);
+}
+
+/**
+ * @brief The directory of a file watched with the default backend is
+ *        deleted and re-created.
+ *
+ * @details
+ * The event registration goes away with the directory; the watch must
+ * register again when the file comes back and keep reporting writes.
+ */
+static void test_backend_rearmed()
+{
+    std::printf("  backend: watched file's directory re-created\n");
+    const fs::path root = scratch();
+    const fs::path dir = root / "d";
+    const fs::path file = dir / "f";
+    fs::create_directory(dir);
+    append(file);
+
+    std::atomic<int> hits{0};
+    MonitorFile monitor;
+    monitor.set_polling_interval(std::chrono::milliseconds(10));
+    monitor.filemon(file.string(), [&] { ++hits; });
+    const MonitorBackend chosen = monitor.get_backend();
+
+    fs::remove_all(dir);
+    check(eventually([&] { return monitor.get_state() == MonitorState::FILE_NOT_FOUND; }),
+          "file reported missing");
+
+    fs::create_directory(dir);
+    append(file);
+    check(eventually([&] { return hits == 1; }), "re-created file detected");
+    check(eventually([&] { return monitor.get_backend() == chosen; }),
+          "backend restored after the file came back");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    append(file);
+    check(eventually([&] { return hits == 2; }), "later write detected");
+
+    monitor.stop();
+    fs::remove_all(root);
+}
+
+/**
+ * @brief Nested directories are deleted and re-created, then the watched
+ *        one is renamed away and replaced.
+ *
+ * @details
+ * Nothing registers again: the engine must wait on the nearest existing
+ * ancestor, follow the path down as each level appears, and re-attach
+ * the registration to the new directory.
+ */
+static void test_engine_rearms()
+{
+    std::printf("  inotify: nested directory re-created without registering again\n");
+    InotifyEngine &engine = InotifyEngine::instance();
+    const fs::path root = scratch();
+    const fs::path top = root / "a";
+    const fs::path dir = top / "b";
+    fs::create_directories(dir);
+
+    std::atomic<int> events{0};
+    auto file = engine.add((dir / "f").string(), [&] { ++events; });
+    check(file != 0, "registered");
+
+    fs::remove_all(top);
+    check(eventually([&] { return !engine.attached(file); }), "detached after deletion");
+    fs::create_directories(dir);
+    check(eventually([&] { return engine.attached(file); }), "re-attached after re-creation");
+    events = 0;
+    append(dir / "f");
+    check(eventually([&] { return events > 0; }), "events from the re-created directory");
+
+    fs::rename(dir, top / "old");
+    check(eventually([&] { return !engine.attached(file); }), "detached after rename");
+    fs::create_directory(dir);
+    check(eventually([&] { return engine.attached(file); }), "re-attached to the new directory");
+    events = 0;
+    append(top / "old" / "f");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(events == 0, "renamed directory no longer reported");
+    append(dir / "f");
+    check(eventually([&] { return events > 0; }), "events from the new directory");
+
+    engine.remove(file);
+    fs::remove_all(root);
+}
+
+int main()
+{
+    test_rotated_identity();
+    test_directory_recreated();
+    test_two_paths_one_inode();
+    test_static_set();
+    test_stop_from_callback();
+    test_speculative_bounded();
+    test_mapping_truncated();
+    test_content_shared_by_handles();
+    test_pipeline_drains();
+    test_pipeline_backpressure();
+    test_tail_off_polling_thread();
+    test_merge_silent_source();
+    test_tree_digest_chunks();
+    test_region_overwrite();
+    test_region_shared();
+    test_snapshot_keys();
+    test_uring_rotation();
+    test_uring_monitors();
+    test_uring_load_growing();
+    test_backend_rearmed();
+    test_engine_rearms();
+
+    std::printf("%s\n", failures ? "FAILED" : "All tests passed.");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,697 @@
+/**
+ * @file treedigest.cpp
+ * @brief Implementation file for TreeDigest.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "treedigest.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace
+{
+    /// Hash of an entry name.
+    std::uint64_t name_hash(std::string_view name)
+    {
+        return mix_hash(static_cast<std::uint64_t>(std::hash<std::string_view>()(name)));
+    }
+
+    /// Folds @p value into the running hash @p h.
+    std::uint64_t fold(std::uint64_t h, std::uint64_t value)
+    {
+        return mix_hash(h ^ (value + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2)));
+    }
+
+    /// What a child adds to its parent's sum.
+    std::uint64_t contribution(const TreeDigest::Node &node)
+    {
+        return fold(name_hash(node.name), node.digest);
+    }
+
+    /// Digest of a directory from its children's sum and count.
+    std::uint64_t directory_digest(std::uint64_t sum, std::size_t count)
+    {
+        return fold(fold(0xD1B54A32D192ED03ULL, sum), count);
+    }
+
+    /// Digest of a non-directory entry from its metadata.
+    std::uint64_t leaf_digest(const struct stat &st)
+    {
+        std::uint64_t h = fold(0x8CB92BA72F3D8DD7ULL, static_cast<std::uint64_t>(st.st_ino));
+        h = fold(h, static_cast<std::uint64_t>(st.st_size));
+        h = fold(h, static_cast<std::uint64_t>(st.st_mode));
+        h = fold(h, static_cast<std::uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL +
+                        static_cast<std::uint64_t>(st.st_mtim.tv_nsec));
+        return fold(h, static_cast<std::uint64_t>(st.st_ctim.tv_sec) * 1000000000ULL +
+                           static_cast<std::uint64_t>(st.st_ctim.tv_nsec));
+    }
+
+    /// Joins a relative directory path and an entry name.
+    std::string join(const std::string &rel, std::string_view name)
+    {
+        std::string out;
+        out.reserve(rel.size() + 1 + name.size());
+        if (!rel.empty())
+            out.append(rel).append(1, '/');
+        out.append(name);
+        return out;
+    }
+
+    /// Orders an entry before a name.
+    bool before(const TreeDigest::Snapshot &child, std::string_view name)
+    {
+        return child->name < name;
+    }
+
+    /// Collects every directory of a subtree, relative to the root.
+    void collect_dirs(const TreeDigest::Snapshot &node, const std::string &rel,
+                      std::vector<std::string> &dirs)
+    {
+        if (!node || !node->directory)
+            return;
+        dirs.push_back(rel);
+        for (const auto &child : node->children)
+        {
+            collect_dirs(child, join(rel, child->name), dirs);
+        }
+    }
+
+    /// Reports @p node and everything under it.
+    void report_all(const TreeDigest::Snapshot &node, const std::string &path,
+                    TreeDigest::Change change, const TreeDigest::DiffFn &fn)
+    {
+        fn(path, change);
+        for (const auto &child : node->children)
+        {
+            report_all(child, join(path, child->name), change, fn);
+        }
+    }
+
+    /// Reports the differences between two versions of one entry.
+    void diff_node(const TreeDigest::Snapshot &a, const TreeDigest::Snapshot &b,
+                   const std::string &path, const TreeDigest::DiffFn &fn)
+    {
+        if (a == b)
+            return;
+        if (a && b && a->directory == b->directory)
+        {
+            if (a->digest == b->digest)
+                return;
+            if (!a->directory)
+            {
+                fn(path, TreeDigest::Change::MODIFIED);
+                return;
+            }
+
+            // Both children lists are sorted, so one merge pass pairs them.
+            // Chunks both versions still share hold identical entries.
+            auto x = a->children.begin();
+            auto y = b->children.begin();
+            const auto x_end = a->children.end();
+            const auto y_end = b->children.end();
+            while (x != x_end || y != y_end)
+            {
+                if (x != x_end && y != y_end && x.chunk_start() &&
+                    x.chunk_start() == y.chunk_start())
+                {
+                    x.skip_chunk();
+                    y.skip_chunk();
+                }
+                else if (x != x_end && (y == y_end || (*x)->name < (*y)->name))
+                {
+                    report_all(*x, join(path, (*x)->name), TreeDigest::Change::REMOVED, fn);
+                    ++x;
+                }
+                else if (y != y_end && (x == x_end || (*y)->name < (*x)->name))
+                {
+                    report_all(*y, join(path, (*y)->name), TreeDigest::Change::ADDED, fn);
+                    ++y;
+                }
+                else
+                {
+                    diff_node(*x, *y, join(path, (*x)->name), fn);
+                    ++x;
+                    ++y;
+                }
+            }
+            return;
+        }
+        if (a)
+            report_all(a, path, TreeDigest::Change::REMOVED, fn);
+        if (b)
+            report_all(b, path, TreeDigest::Change::ADDED, fn);
+    }
+}
+
+/**
+ * @brief Takes entries already sorted by name.
+ *
+ * @param sorted Entries in name order.
+ */
+TreeDigest::Children::Children(std::vector<std::shared_ptr<const Node>> sorted)
+    : count(sorted.size())
+{
+    for (std::size_t i = 0; i < sorted.size(); i += CHUNK)
+    {
+        const std::size_t last = std::min(sorted.size(), i + CHUNK);
+        chunks.push_back(std::make_shared<const Chunk>(
+            std::make_move_iterator(sorted.begin() + static_cast<std::ptrdiff_t>(i)),
+            std::make_move_iterator(sorted.begin() + static_cast<std::ptrdiff_t>(last))));
+    }
+}
+
+/**
+ * @brief First chunk whose last entry is not ordered before @p name.
+ *
+ * @param name Entry name.
+ * @return Index of the chunk, or the chunk count if @p name sorts last.
+ */
+std::size_t TreeDigest::Children::chunk_for(std::string_view name) const
+{
+    auto it = std::lower_bound(chunks.begin(), chunks.end(), name,
+                               [](const std::shared_ptr<const Chunk> &chunk, std::string_view n) {
+                                   return before(chunk->back(), n);
+                               });
+    return static_cast<std::size_t>(it - chunks.begin());
+}
+
+/**
+ * @brief The entry named @p name.
+ *
+ * @param name Entry name.
+ * @return The entry, or nullptr if there is none.
+ */
+TreeDigest::Snapshot TreeDigest::Children::find(std::string_view name) const
+{
+    const std::size_t c = chunk_for(name);
+    if (c == chunks.size())
+    {
+        return nullptr;
+    }
+    const Chunk &chunk = *chunks[c];
+    auto it = std::lower_bound(chunk.begin(), chunk.end(), name, before);
+    return (it != chunk.end() && (*it)->name == name) ? *it : nullptr;
+}
+
+/**
+ * @brief Inserts, replaces or removes the entry named @p name.
+ *
+ * @details
+ * Copies the one chunk concerned. A chunk that grows past CHUNK entries
+ * is split in two; one that becomes empty is dropped.
+ *
+ * @param name Entry name; must equal @p node's name when @p node is set.
+ * @param node New entry, or nullptr to remove it.
+ */
+void TreeDigest::Children::set(std::string_view name, std::shared_ptr<const Node> node)
+{
+    std::size_t c = chunk_for(name);
+    if (c == chunks.size())
+    {
+        // Sorts after every entry: append to the last chunk if it has room.
+        if (!node)
+            return;
+        if (chunks.empty() || chunks.back()->size() >= CHUNK)
+        {
+            chunks.push_back(std::make_shared<const Chunk>(1, std::move(node)));
+            ++count;
+            return;
+        }
+        c = chunks.size() - 1;
+    }
+
+    auto copy = std::make_shared<Chunk>(*chunks[c]);
+    auto it = std::lower_bound(copy->begin(), copy->end(), name, before);
+    const bool found = it != copy->end() && (*it)->name == name;
+    if (found && node)
+    {
+        *it = std::move(node);
+    }
+    else if (found)
+    {
+        copy->erase(it);
+        --count;
+    }
+    else if (node)
+    {
+        copy->insert(it, std::move(node));
+        ++count;
+    }
+    else
+    {
+        return;
+    }
+
+    const auto at = chunks.begin() + static_cast<std::ptrdiff_t>(c);
+    if (copy->empty())
+    {
+        chunks.erase(at);
+    }
+    else if (copy->size() > CHUNK)
+    {
+        const auto half = copy->begin() + static_cast<std::ptrdiff_t>(copy->size() / 2);
+        auto tail = std::make_shared<const Chunk>(half, copy->end());
+        copy->erase(half, copy->end());
+        *at = std::move(copy);
+        chunks.insert(at + 1, std::move(tail));
+    }
+    else
+    {
+        *at = std::move(copy);
+    }
+}
+
+/**
+ * @brief Scans the tree under @p root.
+ *
+ * @param root Directory to summarize; symlinks in the path are resolved.
+ */
+TreeDigest::TreeDigest(const std::string &root)
+{
+    std::error_code ec;
+    root_path = std::filesystem::weakly_canonical(root, ec).string();
+    if (ec)
+    {
+        root_path = root;
+    }
+    std::vector<std::string> dirs;
+    tree = build(root_path, std::string(), std::string(), dirs);
+}
+
+/**
+ * @brief Drops every inotify registration.
+ *
+ * @details
+ * Once the engine has removed a token its callback no longer runs, so
+ * nothing touches this object afterwards.
+ */
+TreeDigest::~TreeDigest()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    watches.for_each([](const std::string &, InotifyEngine::Token &token) {
+        InotifyEngine::instance().remove(token);
+    });
+    watches.clear();
+}
+
+/**
+ * @brief Keeps the digest current from inotify events.
+ *
+ * @return true if every directory could be watched.
+ */
+bool TreeDigest::watch()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    watching = true;
+    std::vector<std::string> dirs;
+    collect_dirs(tree, std::string(), dirs);
+
+    bool ok = true;
+    for (const auto &rel : dirs)
+    {
+        ok = watch_dir(rel, false) && ok;
+    }
+
+    // One pass over the whole tree catches anything changed before the
+    // watches were in place.
+    enqueue(std::string(), true);
+    return ok;
+}
+
+/**
+ * @brief Re-checks one entry and updates the digests above it.
+ *
+ * @param path Entry path relative to the root; empty rescans the root.
+ */
+void TreeDigest::update(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    apply_pending();
+    update_locked(path, true);
+}
+
+/**
+ * @brief Digest of the whole tree.
+ *
+ * @return The root digest, or 0 if the root does not exist.
+ */
+std::uint64_t TreeDigest::digest()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    apply_pending();
+    return tree ? tree->digest : 0;
+}
+
+/**
+ * @brief Digest of the entry at @p path.
+ *
+ * @param path Entry path relative to the root.
+ * @return The digest, or std::nullopt if the entry does not exist.
+ */
+std::optional<std::uint64_t> TreeDigest::digest(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    apply_pending();
+
+    NodePtr node = tree;
+    std::size_t start = 0;
+    while (node && start < path.size())
+    {
+        std::size_t end = path.find('/', start);
+        if (end == std::string::npos)
+            end = path.size();
+        const std::string_view name(path.data() + start, end - start);
+        start = end + 1;
+        if (name.empty())
+            continue;
+
+        node = node->children.find(name);
+    }
+    if (!node)
+        return std::nullopt;
+    return node->digest;
+}
+
+/**
+ * @brief Current state of the tree.
+ *
+ * @return Shared, immutable root node.
+ */
+TreeDigest::Snapshot TreeDigest::snapshot()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    apply_pending();
+    return tree;
+}
+
+/**
+ * @brief Reports the entries that differ between two snapshots.
+ *
+ * @details
+ * Subtrees with equal digests are skipped without being visited. Added
+ * and removed directories are reported along with everything in them.
+ *
+ * @param before Older state.
+ * @param after Newer state.
+ * @param fn Called once per added, removed or modified entry.
+ */
+void TreeDigest::diff(const Snapshot &before, const Snapshot &after, const DiffFn &fn)
+{
+    diff_node(before, after, std::string(), fn);
+}
+
+/**
+ * @brief Builds the node for @p abs.
+ *
+ * @param abs Absolute path of the entry.
+ * @param name Entry name to store.
+ * @param rel Path of the entry relative to the root.
+ * @param dirs Collects directories found, relative to the root.
+ * @return The node, or nullptr if the entry does not exist.
+ */
+TreeDigest::NodePtr TreeDigest::build(const std::string &abs, std::string name,
+                                      const std::string &rel, std::vector<std::string> &dirs)
+{
+    struct stat st;
+    if (::lstat(abs.c_str(), &st) != 0)
+    {
+        return nullptr;
+    }
+
+    auto node = std::make_shared<Node>();
+    node->name = std::move(name);
+    node->inode = static_cast<std::uint64_t>(st.st_ino);
+    if (!S_ISDIR(st.st_mode))
+    {
+        node->digest = leaf_digest(st);
+        return node;
+    }
+
+    node->directory = true;
+    dirs.push_back(rel);
+    std::vector<NodePtr> entries;
+    if (DIR *d = ::opendir(abs.c_str()))
+    {
+        while (const struct dirent *entry = ::readdir(d))
+        {
+            const std::string_view child(entry->d_name);
+            if (child == "." || child == "..")
+                continue;
+            std::string child_abs = abs;
+            child_abs.append(1, '/').append(child);
+            if (NodePtr c = build(child_abs, std::string(child), join(rel, child), dirs))
+            {
+                node->sum += contribution(*c);
+                entries.push_back(std::move(c));
+            }
+        }
+        ::closedir(d);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const NodePtr &a, const NodePtr &b) { return a->name < b->name; });
+    node->children = Children(std::move(entries));
+    node->digest = directory_digest(node->sum, node->children.size());
+    return node;
+}
+
+/**
+ * @brief Returns @p dir with the entry at @p parts[index..] re-checked.
+ *
+ * @details
+ * Only the nodes on the path, and in each the chunk of children holding
+ * the entry, are copied; every other subtree is shared with the previous
+ * version. A directory that is still the same inode and
+ * still watched is kept as is unless @p rescan is set, since its own
+ * watch reports changes inside it.
+ *
+ * @param dir Directory node holding the entry.
+ * @param parts Components of the entry's relative path.
+ * @param index Component naming the child of @p dir.
+ * @param rel Relative path of @p dir.
+ * @param rescan Rebuild a directory entry even if it is still watched.
+ * @return The updated directory node (@p dir itself if nothing changed).
+ *
+ * @note Caller must hold @ref mutex.
+ */
+TreeDigest::NodePtr TreeDigest::apply(const NodePtr &dir, const std::vector<std::string_view> &parts,
+                                      std::size_t index, const std::string &rel, bool rescan)
+{
+    const std::string_view name = parts[index];
+    const std::string child_rel = join(rel, name);
+    const NodePtr old = dir->children.find(name);
+
+    NodePtr next;
+    if (index + 1 < parts.size() && old && old->directory)
+    {
+        next = apply(old, parts, index + 1, child_rel, rescan);
+    }
+    else
+    {
+        const std::string abs = root_path + "/" + child_rel;
+        struct stat st;
+        if (!rescan && old && old->directory && watching && watches.find(child_rel) &&
+            ::lstat(abs.c_str(), &st) == 0 && S_ISDIR(st.st_mode) &&
+            static_cast<std::uint64_t>(st.st_ino) == old->inode)
+        {
+            return dir;
+        }
+
+        std::vector<std::string> dirs;
+        next = build(abs, std::string(name), child_rel, dirs);
+        replace_watches(old, child_rel, dirs);
+    }
+
+    if (next == old || (next && old && next->directory == old->directory &&
+                        next->digest == old->digest))
+    {
+        return dir;
+    }
+
+    // Copies the chunk pointers and the one chunk holding the entry.
+    auto copy = std::make_shared<Node>(*dir);
+    if (old)
+    {
+        copy->sum -= contribution(*old);
+    }
+    if (next)
+    {
+        copy->sum += contribution(*next);
+    }
+    copy->children.set(name, next);
+    copy->digest = directory_digest(copy->sum, copy->children.size());
+    return copy;
+}
+
+/**
+ * @brief Swaps the subtree @p before for one containing @p dirs.
+ *
+ * @details
+ * Directories that disappeared stop being watched; new ones start.
+ *
+ * @param before Subtree being replaced (may be null).
+ * @param rel Relative path of the subtree.
+ * @param dirs Directories of the replacement.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+void TreeDigest::replace_watches(const NodePtr &before, const std::string &rel,
+                                 const std::vector<std::string> &dirs)
+{
+    if (!watching)
+        return;
+
+    std::vector<std::string> old_dirs;
+    collect_dirs(before, rel, old_dirs);
+    std::vector<std::string> keep(dirs);
+    std::sort(keep.begin(), keep.end());
+    for (const auto &d : old_dirs)
+    {
+        if (!std::binary_search(keep.begin(), keep.end(), d))
+        {
+            if (auto *token = watches.find(d))
+            {
+                InotifyEngine::instance().remove(*token);
+                watches.erase(d);
+            }
+        }
+    }
+    for (const auto &d : dirs)
+    {
+        if (!watches.find(d))
+            watch_dir(d, true);
+    }
+}
+
+/**
+ * @brief Starts watching @p rel.
+ *
+ * @param rel Directory relative to the root.
+ * @param rescan Queue a rescan of the directory once watched.
+ * @return true if the watch was added.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+bool TreeDigest::watch_dir(const std::string &rel, bool rescan)
+{
+    const std::string abs = rel.empty() ? root_path : root_path + "/" + rel;
+    InotifyEngine::Token token = InotifyEngine::instance().add_directory(
+        abs, [this, rel](std::string_view name) {
+            if (name.empty())
+                enqueue(rel, true);
+            else
+                enqueue(join(rel, name), false);
+        });
+    if (token == 0)
+    {
+        return false;
+    }
+    watches[rel] = token;
+    if (rescan)
+    {
+        enqueue(rel, true);
+    }
+    return true;
+}
+
+/**
+ * @brief Re-checks @p rel.
+ *
+ * @param rel Entry path relative to the root; empty rebuilds everything.
+ * @param rescan Rebuild a directory entry even if it is still watched.
+ *
+ * @note Caller must hold @ref mutex.
+ */
+void TreeDigest::update_locked(const std::string &rel, bool rescan)
+{
+    std::vector<std::string_view> parts;
+    std::size_t start = 0;
+    while (start <= rel.size())
+    {
+        std::size_t end = rel.find('/', start);
+        if (end == std::string::npos)
+            end = rel.size();
+        if (end > start)
+            parts.emplace_back(rel.data() + start, end - start);
+        start = end + 1;
+    }
+
+    if (parts.empty() || !tree || !tree->directory)
+    {
+        std::vector<std::string> dirs;
+        NodePtr before = tree;
+        tree = build(root_path, std::string(), std::string(), dirs);
+        replace_watches(before, std::string(), dirs);
+        return;
+    }
+
+    tree = apply(tree, parts, 0, std::string(), rescan);
+}
+
+/**
+ * @brief Drains the event queue into the tree, removals first.
+ *
+ * @details
+ * Every re-check reads the live file system. Paths that no longer exist
+ * are applied before the rest, and each group in path order, so a batch
+ * (a directory renamed within the tree, say) always drops old watches
+ * and subtrees before adding new ones, whatever order the hash map held
+ * them in. Applying may queue more (new directories).
+ *
+ * @note Caller must hold @ref mutex.
+ */
+void TreeDigest::apply_pending()
+{
+    while (true)
+    {
+        FlatHashMap<std::string, bool> batch;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            if (pending.empty())
+                return;
+            std::swap(batch, pending);
+        }
+
+        std::vector<std::pair<std::string, bool>> removed;
+        std::vector<std::pair<std::string, bool>> present;
+        batch.for_each([&](const std::string &rel, bool &rescan) {
+            struct stat st;
+            const std::string abs = rel.empty() ? root_path : root_path + "/" + rel;
+            auto &group = ::lstat(abs.c_str(), &st) == 0 ? present : removed;
+            group.emplace_back(rel, rescan);
+        });
+        std::sort(removed.begin(), removed.end());
+        std::sort(present.begin(), present.end());
+        for (const auto &entry : removed)
+        {
+            update_locked(entry.first, entry.second);
+        }
+        for (const auto &entry : present)
+        {
+            update_locked(entry.first, entry.second);
+        }
+    }
+}
+
+/**
+ * @brief Queues @p rel for the next query.
+ *
+ * @details
+ * Runs on an inotify reader thread, so it only records the path.
+ * Repeated events for one path collapse into one re-check.
+ *
+ * @param rel Entry path relative to the root.
+ * @param rescan Rebuild the entry even if it is a watched directory.
+ */
+void TreeDigest::enqueue(std::string rel, bool rescan)
+{
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    bool &flag = pending[rel];
+    flag = flag || rescan;
+}
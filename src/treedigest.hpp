@@ -0,0 +1,343 @@
+/**
+ * @file treedigest.hpp
+ * @brief Merkle digest of a directory tree, kept current from inotify events.
+ *
+ * @details
+ * Every file is a leaf whose digest covers its inode, size, mode and
+ * modification/change times. A directory's digest is a mix of the sum of
+ * its children's (name, digest) contributions. The sum does not depend on
+ * order, so replacing one child only subtracts its old contribution and
+ * adds the new one. An event therefore touches the nodes on the path from
+ * the entry to the root and nothing else.
+ *
+ * Nodes are immutable and shared. An update copies the path it changes,
+ * and in each directory on that path only the chunk of entries holding
+ * the changed one, so a snapshot is a single pointer, taken in O(1), and
+ * an update to a huge directory does not copy all of its entries. Two
+ * snapshots are compared by descending only into subtrees whose digests
+ * differ and skipping chunks they share, so a diff visits the changed
+ * entries and their ancestors.
+ *
+ * Digests are 64-bit and meant for change detection, not as a
+ * cryptographic commitment.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef TREEDIGEST_HPP
+#define TREEDIGEST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flathashmap.hpp"
+#include "inotifyengine.hpp"
+
+/**
+ * @class TreeDigest
+ * @brief Incrementally maintained Merkle digest of a directory tree.
+ *
+ * @details
+ * Events are only queued on the inotify reader thread; they are applied
+ * when the digest or a snapshot is next requested, so queries always see
+ * every change reported so far. Directories created later are watched
+ * and scanned as they appear. Symlinks are leaves and are not followed.
+ */
+class TreeDigest
+{
+public:
+    struct Node;
+
+    /**
+     * @class Children
+     * @brief A directory's entries, sorted by name, in shared chunks.
+     *
+     * @details
+     * Entries are held in chunks of at most @ref CHUNK nodes. Copying the
+     * container copies only the chunk pointers, and changing one entry
+     * copies only the chunk holding it, so a directory with n entries is
+     * updated in O(n / CHUNK + CHUNK) rather than O(n). Chunks are never
+     * empty.
+     */
+    class Children
+    {
+    public:
+        /// Most entries held by one chunk.
+        static constexpr std::size_t CHUNK = 64;
+
+        /// One run of consecutive entries.
+        using Chunk = std::vector<std::shared_ptr<const Node>>;
+
+        /**
+         * @brief Forward iterator over the entries in name order.
+         */
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::shared_ptr<const Node>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const value_type *;
+            using reference = const value_type &;
+
+            const_iterator() = default;
+            const_iterator(const std::vector<std::shared_ptr<const Chunk>> *chunks,
+                           std::size_t chunk)
+                : chunks(chunks), chunk(chunk)
+            {
+            }
+
+            reference operator*() const { return (*(*chunks)[chunk])[offset]; }
+            pointer operator->() const { return &**this; }
+
+            const_iterator &operator++()
+            {
+                if (++offset == (*chunks)[chunk]->size())
+                {
+                    ++chunk;
+                    offset = 0;
+                }
+                return *this;
+            }
+
+            bool operator==(const const_iterator &other) const
+            {
+                return chunk == other.chunk && offset == other.offset;
+            }
+            bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+            /**
+             * @brief The chunk this iterator is at the start of, or nullptr.
+             */
+            const Chunk *chunk_start() const
+            {
+                return offset == 0 && chunk < chunks->size() ? (*chunks)[chunk].get() : nullptr;
+            }
+
+            /**
+             * @brief Moves to the start of the next chunk.
+             */
+            void skip_chunk()
+            {
+                ++chunk;
+                offset = 0;
+            }
+
+        private:
+            /// The container's chunks.
+            const std::vector<std::shared_ptr<const Chunk>> *chunks = nullptr;
+            std::size_t chunk = 0;  ///< Current chunk.
+            std::size_t offset = 0; ///< Entry within the chunk.
+        };
+
+        Children() = default;
+
+        /**
+         * @brief Takes entries already sorted by name.
+         */
+        explicit Children(std::vector<std::shared_ptr<const Node>> sorted);
+
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const_iterator begin() const { return const_iterator(&chunks, 0); }
+        const_iterator end() const { return const_iterator(&chunks, chunks.size()); }
+
+        /**
+         * @brief The entry named @p name, or nullptr.
+         */
+        std::shared_ptr<const Node> find(std::string_view name) const;
+
+        /**
+         * @brief Inserts or replaces the entry named @p name, or removes it
+         *        when @p node is null.
+         */
+        void set(std::string_view name, std::shared_ptr<const Node> node);
+
+    private:
+        /**
+         * @brief First chunk whose last entry is not ordered before @p name.
+         */
+        std::size_t chunk_for(std::string_view name) const;
+
+        std::vector<std::shared_ptr<const Chunk>> chunks; ///< Runs in name order.
+        std::size_t count = 0;                             ///< Entries in all chunks.
+    };
+
+    /**
+     * @brief One immutable node of the tree.
+     */
+    struct Node
+    {
+        std::string name;        ///< Entry name; empty for the root.
+        bool directory = false;  ///< Whether the entry is a directory.
+        std::uint64_t inode = 0; ///< Inode number, to tell a replaced directory.
+        std::uint64_t digest = 0; ///< Merkle digest of the entry.
+        std::uint64_t sum = 0;   ///< Directories: sum of child contributions.
+        Children children;       ///< Sorted by name.
+    };
+
+    /// A point-in-time state of the tree.
+    using Snapshot = std::shared_ptr<const Node>;
+
+    /**
+     * @enum Change
+     * @brief Kind of difference reported by diff().
+     */
+    enum class Change
+    {
+        ADDED,    ///< Present only in the newer snapshot.
+        REMOVED,  ///< Present only in the older snapshot.
+        MODIFIED  ///< Present in both with different metadata.
+    };
+
+    /// Receives a changed file's path, relative to the root.
+    using DiffFn = std::function<void(const std::string &path, Change change)>;
+
+    /**
+     * @brief Scans the tree under @p root.
+     *
+     * @param root Directory to summarize.
+     */
+    explicit TreeDigest(const std::string &root);
+
+    /**
+     * @brief Drops every inotify registration.
+     */
+    ~TreeDigest();
+
+    TreeDigest(const TreeDigest &) = delete;
+    TreeDigest &operator=(const TreeDigest &) = delete;
+
+    /**
+     * @brief Keeps the digest current from inotify events.
+     *
+     * @return true if every directory could be watched.
+     */
+    bool watch();
+
+    /**
+     * @brief Re-checks one entry and updates the digests above it.
+     *
+     * @param path Entry path relative to the root; empty rescans the root.
+     */
+    void update(const std::string &path);
+
+    /**
+     * @brief Digest of the whole tree.
+     */
+    std::uint64_t digest();
+
+    /**
+     * @brief Digest of the entry at @p path, relative to the root.
+     *
+     * @return The digest, or std::nullopt if the entry does not exist.
+     */
+    std::optional<std::uint64_t> digest(const std::string &path);
+
+    /**
+     * @brief Current state of the tree, for a later diff().
+     */
+    Snapshot snapshot();
+
+    /**
+     * @brief Reports the files that differ between two snapshots.
+     *
+     * @param before Older state.
+     * @param after Newer state.
+     * @param fn Called once per added, removed or modified file.
+     */
+    static void diff(const Snapshot &before, const Snapshot &after, const DiffFn &fn);
+
+    /**
+     * @brief Root directory, as resolved at construction.
+     */
+    const std::string &root() const { return root_path; }
+
+private:
+    using NodePtr = std::shared_ptr<const Node>;
+
+    /**
+     * @brief Builds the node for @p abs, or nullptr if it does not exist.
+     *
+     * @param abs Absolute path of the entry.
+     * @param name Entry name to store.
+     * @param dirs Collects directories found, relative to the root.
+     * @param rel Path of the entry relative to the root.
+     */
+    static NodePtr build(const std::string &abs, std::string name, const std::string &rel,
+                         std::vector<std::string> &dirs);
+
+    /**
+     * @brief Returns @p dir with the entry at @p parts[index..] re-checked.
+     *
+     * @param dir Directory node holding the entry.
+     * @param parts Components of the entry's relative path.
+     * @param index Component naming the child of @p dir.
+     * @param rel Relative path of @p dir.
+     * @param rescan Rebuild a directory entry even if it is still watched.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    NodePtr apply(const NodePtr &dir, const std::vector<std::string_view> &parts,
+                  std::size_t index, const std::string &rel, bool rescan);
+
+    /**
+     * @brief Swaps the subtree @p before for @p after and updates watches.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void replace_watches(const NodePtr &before, const std::string &rel,
+                         const std::vector<std::string> &dirs);
+
+    /**
+     * @brief Drains the event queue into the tree, removals first.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void apply_pending();
+
+    /**
+     * @brief Starts watching @p rel, optionally queueing a rescan of it.
+     *
+     * @details
+     * The rescan picks up entries created between the scan that found the
+     * directory and the watch being in place.
+     *
+     * @return true if the watch was added.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    bool watch_dir(const std::string &rel, bool rescan);
+
+    /**
+     * @brief Re-checks @p rel.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void update_locked(const std::string &rel, bool rescan);
+
+    /**
+     * @brief Queues @p rel for the next query; called on the reader thread.
+     */
+    void enqueue(std::string rel, bool rescan);
+
+    std::string root_path;                      ///< Resolved root directory.
+    std::mutex mutex;                           ///< Guards the tree and watches.
+    NodePtr tree;                               ///< Current root node.
+    bool watching = false;                      ///< Whether watch() was called.
+    FlatHashMap<std::string, InotifyEngine::Token> watches; ///< Relative dir to token.
+    std::mutex pending_mutex;                   ///< Guards the queue below.
+    FlatHashMap<std::string, bool> pending;     ///< Paths reported by events, and whether to rescan.
+};
+
+#endif // TREEDIGEST_HPP
@@ -0,0 +1,367 @@
+/**
+ * @file uncachedread.cpp
+ * @brief Implementation file for BlockReader.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "uncachedread.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "flathashmap.hpp"
+
+#ifndef RWF_DONTCACHE
+#define RWF_DONTCACHE 0x00000080 // Linux 6.14 uapi
+#endif
+
+namespace
+{
+    /// Memory alignment of pooled buffers; satisfies O_DIRECT on common devices.
+    constexpr std::size_t BUFFER_ALIGN = 4096;
+
+    /// Idle buffers kept for reuse.
+    constexpr std::size_t MAX_IDLE = 4;
+
+    /**
+     * @brief Recycles page-aligned buffers between readers.
+     */
+    class AlignedPool
+    {
+    public:
+        static AlignedPool &instance()
+        {
+            static AlignedPool *pool = new AlignedPool();
+            return *pool;
+        }
+
+        char *acquire(std::size_t size)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto it = idle.begin(); it != idle.end(); ++it)
+                {
+                    if (it->first == size)
+                    {
+                        char *p = it->second;
+                        idle.erase(it);
+                        return p;
+                    }
+                }
+            }
+            return static_cast<char *>(std::aligned_alloc(BUFFER_ALIGN, size));
+        }
+
+        void release(char *p, std::size_t size)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (idle.size() < MAX_IDLE)
+                {
+                    idle.emplace_back(size, p);
+                    return;
+                }
+            }
+            std::free(p);
+        }
+
+    private:
+        AlignedPool() = default;
+
+        std::mutex mutex;
+        std::vector<std::pair<std::size_t, char *>> idle;
+    };
+
+    /**
+     * @brief Direct I/O offset alignment of @p fd.
+     *
+     * @return The alignment, 0 if the file does not support O_DIRECT
+     *         (known only on kernels reporting STATX_DIOALIGN), or 4096.
+     */
+    std::size_t dio_alignment(int fd)
+    {
+#ifdef STATX_DIOALIGN
+        struct statx stx;
+        if (::statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 &&
+            (stx.stx_mask & STATX_DIOALIGN))
+        {
+            if (stx.stx_dio_offset_align == 0 || stx.stx_dio_mem_align > BUFFER_ALIGN)
+                return 0;
+            return std::max<std::size_t>(stx.stx_dio_offset_align, 512);
+        }
+#endif
+        (void)fd;
+        return 4096;
+    }
+}
+
+/**
+ * @brief Printable name of a read mode.
+ *
+ * @param mode Mode to name.
+ * @return Static string.
+ */
+const char *read_mode_name(ReadMode mode)
+{
+    switch (mode)
+    {
+    case ReadMode::CACHED:
+        return "cached";
+    case ReadMode::DIRECT:
+        return "O_DIRECT";
+    case ReadMode::DONTCACHE:
+        return "RWF_DONTCACHE";
+    case ReadMode::DROP_BEHIND:
+        return "FADV_DONTNEED";
+    case ReadMode::AUTO:
+        return "auto";
+    }
+    return "?";
+}
+
+/**
+ * @brief Returns a buffer to the pool.
+ *
+ * @param p Buffer from AlignedPool::acquire().
+ */
+void BlockReader::Release::operator()(char *p) const
+{
+    AlignedPool::instance().release(p, size);
+}
+
+/**
+ * @brief Opens @p path for reading in @p mode.
+ *
+ * @details
+ * DIRECT (or AUTO) opens a second, O_DIRECT descriptor; file systems that
+ * refuse it, such as tmpfs, fall back to DONTCACHE under AUTO and to
+ * DROP_BEHIND under DIRECT. The buffer leaves room to widen a read to the
+ * alignment on both ends.
+ *
+ * @param path File to read.
+ * @param mode Requested mode.
+ * @param max_block Largest length passed to read().
+ * @return The reader, or nullptr on failure.
+ */
+std::unique_ptr<BlockReader> BlockReader::open(const std::string &path, ReadMode mode,
+                                               std::size_t max_block)
+{
+    std::unique_ptr<BlockReader> reader(new BlockReader());
+    reader->file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (reader->file < 0)
+    {
+        return nullptr;
+    }
+
+    reader->current = mode == ReadMode::AUTO ? ReadMode::DONTCACHE : mode;
+    if (mode == ReadMode::DIRECT || mode == ReadMode::AUTO)
+    {
+        const std::size_t align = dio_alignment(reader->file);
+        if (align != 0)
+        {
+            reader->direct = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+        }
+        if (reader->direct >= 0)
+        {
+            reader->current = ReadMode::DIRECT;
+            reader->alignment = align;
+        }
+        else if (mode == ReadMode::DIRECT)
+        {
+            reader->current = ReadMode::DROP_BEHIND;
+        }
+    }
+
+    const std::size_t size =
+        (max_block + 2 * reader->alignment + BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+    char *p = AlignedPool::instance().acquire(size);
+    if (!p)
+    {
+        return nullptr;
+    }
+    reader->buffer = std::unique_ptr<char, Release>(p, Release{size});
+    reader->capacity = size;
+    return reader;
+}
+
+/**
+ * @brief Closes both descriptors; the buffer goes back to the pool.
+ *
+ * @details
+ * In drop-behind mode the rest of the file from the last read on is
+ * advised away first.
+ */
+BlockReader::~BlockReader()
+{
+    if (drop_from)
+    {
+        // Whatever readahead brought in past the last read.
+        ::posix_fadvise(file, static_cast<off_t>(*drop_from), 0, POSIX_FADV_DONTNEED);
+    }
+    if (direct >= 0)
+        ::close(direct);
+    if (file >= 0)
+        ::close(file);
+}
+
+/**
+ * @brief Reads up to @p length bytes at @p offset.
+ *
+ * @details
+ * A direct read covers the aligned range around the request and returns
+ * a pointer offset into it. If the file system rejects the direct read,
+ * the reader switches to drop-behind reads for good.
+ *
+ * @param offset File offset.
+ * @param length Bytes wanted.
+ * @param got Receives the number of bytes read.
+ * @return Pointer to the bytes, or nullptr on error.
+ */
+const char *BlockReader::read(std::uint64_t offset, std::size_t length, std::size_t &got)
+{
+    got = 0;
+    if (current != ReadMode::DIRECT)
+    {
+        return read_buffered(offset, length, got);
+    }
+
+    const std::uint64_t start = offset / alignment * alignment;
+    const std::size_t lead = static_cast<std::size_t>(offset - start);
+    const std::size_t span = (lead + length + alignment - 1) / alignment * alignment;
+    if (span > capacity)
+    {
+        return nullptr;
+    }
+
+    std::size_t done = 0;
+    while (done < span)
+    {
+        ssize_t n = ::pread(direct, buffer.get() + done, span - done, static_cast<off_t>(start + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EINVAL && done == 0)
+        {
+            // Alignment the kernel did not report; give up on O_DIRECT.
+            current = ReadMode::DROP_BEHIND;
+            return read_buffered(offset, length, got);
+        }
+        if (n < 0)
+            return nullptr;
+        if (n == 0)
+            break;
+        done += static_cast<std::size_t>(n);
+        if (done % alignment != 0)
+            break; // end of file
+    }
+    got = done > lead ? std::min(length, done - lead) : 0;
+    return buffer.get() + lead;
+}
+
+/**
+ * @brief Buffered read into the buffer, honouring the current mode.
+ *
+ * @param offset File offset.
+ * @param length Bytes wanted.
+ * @param got Receives the number of bytes read.
+ * @return Pointer to the bytes, or nullptr on error.
+ */
+const char *BlockReader::read_buffered(std::uint64_t offset, std::size_t length, std::size_t &got)
+{
+    if (length > capacity)
+    {
+        return nullptr;
+    }
+
+    std::size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n;
+        if (current == ReadMode::DONTCACHE)
+        {
+            struct iovec iov = {buffer.get() + done, length - done};
+            n = ::preadv2(file, &iov, 1, static_cast<off_t>(offset + done), RWF_DONTCACHE);
+            if (n < 0 && (errno == EOPNOTSUPP || errno == EINVAL))
+            {
+                // Kernel or file system without uncached buffered reads.
+                current = ReadMode::DROP_BEHIND;
+                continue;
+            }
+        }
+        else
+        {
+            n = ::pread(file, buffer.get() + done, length - done, static_cast<off_t>(offset + done));
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return nullptr;
+        if (n == 0)
+            break;
+        done += static_cast<std::size_t>(n);
+    }
+
+    if (current == ReadMode::DROP_BEHIND && done > 0)
+    {
+        // Readahead fills large folios that straddle read boundaries, and
+        // the kernel only drops folios a range covers entirely, so each
+        // call also covers the previous read.
+        const std::uint64_t from = drop_from ? std::min(*drop_from, offset) : offset;
+        ::posix_fadvise(file, static_cast<off_t>(from), static_cast<off_t>(offset + done - from),
+                        POSIX_FADV_DONTNEED);
+        drop_from = offset;
+    }
+    got = done;
+    return buffer.get();
+}
+
+/**
+ * @brief Hashes a whole file in @p mode.
+ *
+ * @details
+ * Blocks are hashed as they are read and folded together in order, so
+ * memory use is one block regardless of file size.
+ *
+ * @param path File to hash.
+ * @param mode Cache mode for the reads.
+ * @param block Bytes per read.
+ * @return The hash, or std::nullopt if the file cannot be read.
+ */
+std::optional<std::uint64_t> hash_file(const std::string &path, ReadMode mode, std::size_t block)
+{
+    auto reader = BlockReader::open(path, mode, block);
+    if (!reader)
+    {
+        return std::nullopt;
+    }
+
+    std::uint64_t hash = 0x243F6A8885A308D3ULL;
+    std::uint64_t offset = 0;
+    while (true)
+    {
+        std::size_t got = 0;
+        const char *data = reader->read(offset, block, got);
+        if (!data)
+            return std::nullopt;
+        if (got == 0)
+            break;
+        hash = mix_hash(hash ^ std::hash<std::string_view>()(std::string_view(data, got)));
+        offset += got;
+        if (got < block)
+            break;
+    }
+    return hash;
+}
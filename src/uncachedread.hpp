@@ -0,0 +1,138 @@
+/**
+ * @file uncachedread.hpp
+ * @brief Reads large files for hashing without filling the page cache.
+ *
+ * @details
+ * Verifying a multi-gigabyte file through ordinary buffered reads pulls
+ * every page of it into the page cache and evicts whatever the service
+ * had cached. BlockReader reads around the cache instead, using the best
+ * mechanism available:
+ *
+ * - DIRECT: O_DIRECT into aligned, pooled buffers; the cache is bypassed.
+ * - DONTCACHE: buffered reads with RWF_DONTCACHE (Linux 6.14+); pages are
+ *   dropped as soon as the read completes.
+ * - DROP_BEHIND: buffered reads followed by POSIX_FADV_DONTNEED on the
+ *   range just read.
+ *
+ * AUTO tries them in that order, falling back at open time or on the
+ * first read a file system rejects.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef UNCACHEDREAD_HPP
+#define UNCACHEDREAD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+/**
+ * @enum ReadMode
+ * @brief How BlockReader treats the page cache.
+ */
+enum class ReadMode
+{
+    CACHED,      ///< Plain buffered reads.
+    DIRECT,      ///< O_DIRECT with aligned buffers.
+    DONTCACHE,   ///< preadv2() with RWF_DONTCACHE.
+    DROP_BEHIND, ///< Buffered reads, then POSIX_FADV_DONTNEED.
+    AUTO         ///< Best of the uncached modes the file system supports.
+};
+
+/**
+ * @brief Printable name of a read mode.
+ */
+const char *read_mode_name(ReadMode mode);
+
+/**
+ * @class BlockReader
+ * @brief Sequential or random block reads in a chosen cache mode.
+ *
+ * @details
+ * Each read returns a pointer into the reader's own buffer, valid until
+ * the next read, so hashing needs no extra copy. Direct reads are widened
+ * to the device alignment internally; callers may use any offset and
+ * length. Not thread-safe.
+ */
+class BlockReader
+{
+public:
+    /**
+     * @brief Opens @p path for reading in @p mode.
+     *
+     * @param path File to read.
+     * @param mode Requested mode; see mode() for the one in effect.
+     * @param max_block Largest length passed to read().
+     * @return The reader, or nullptr if the file cannot be opened.
+     */
+    static std::unique_ptr<BlockReader> open(const std::string &path, ReadMode mode = ReadMode::AUTO,
+                                             std::size_t max_block = 1 << 20);
+
+    ~BlockReader();
+
+    BlockReader(const BlockReader &) = delete;
+    BlockReader &operator=(const BlockReader &) = delete;
+
+    /**
+     * @brief Reads up to @p length bytes at @p offset.
+     *
+     * @param offset File offset.
+     * @param length Bytes wanted, at most the @c max_block given to open().
+     * @param got Receives the number of bytes read (short at end of file).
+     * @return Pointer to the bytes, or nullptr on error.
+     */
+    const char *read(std::uint64_t offset, std::size_t length, std::size_t &got);
+
+    /**
+     * @brief Descriptor for metadata queries (never opened O_DIRECT).
+     */
+    int fd() const { return file; }
+
+    /**
+     * @brief Mode in effect after any fallback.
+     */
+    ReadMode mode() const { return current; }
+
+private:
+    /**
+     * @brief Frees a pooled buffer back to the pool.
+     */
+    struct Release
+    {
+        std::size_t size; ///< Allocation size, for the pool.
+        void operator()(char *p) const;
+    };
+
+    BlockReader() = default;
+
+    /**
+     * @brief Buffered read into the buffer, honouring the current mode.
+     */
+    const char *read_buffered(std::uint64_t offset, std::size_t length, std::size_t &got);
+
+    int file = -1;                        ///< Buffered descriptor.
+    int direct = -1;                      ///< O_DIRECT descriptor, or -1.
+    ReadMode current = ReadMode::CACHED;  ///< Mode in effect.
+    std::size_t alignment = 4096;         ///< Direct I/O alignment.
+    std::unique_ptr<char, Release> buffer{nullptr, Release{0}}; ///< Aligned, pooled.
+    std::size_t capacity = 0;             ///< Usable bytes in @ref buffer.
+    std::optional<std::uint64_t> drop_from; ///< Start of the range still to advise away.
+};
+
+/**
+ * @brief Hashes a whole file in @p mode.
+ *
+ * @param path File to hash.
+ * @param mode Cache mode for the reads.
+ * @param block Bytes per read.
+ * @return The hash, or std::nullopt if the file cannot be read.
+ */
+std::optional<std::uint64_t> hash_file(const std::string &path, ReadMode mode = ReadMode::AUTO,
+                                       std::size_t block = 1 << 20);
+
+#endif // UNCACHEDREAD_HPP
@@ -0,0 +1,872 @@
+/**
+ * @file uringreader.cpp
+ * @brief Implementation file for UringReader.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "uringreader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "pagealloc.hpp"
+
+namespace
+{
+    /// user_data bit that marks a content load read.
+    constexpr std::uint64_t LOAD_TAG = std::uint64_t{1} << 63;
+
+    int uring_setup(unsigned entries, io_uring_params *params)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+    }
+
+    int uring_register(int fd, unsigned opcode, const void *arg, unsigned count)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    /**
+     * @brief Clamps options to what the ring and the read results can express.
+     */
+    UringOptions sanitized(UringOptions o)
+    {
+        o.queue_depth = std::clamp(o.queue_depth, 8u, 4096u);
+        o.block_size = std::clamp<std::size_t>(o.block_size, 4096, std::size_t{1} << 30);
+        o.buffers = std::clamp(o.buffers, 1u, 1024u);
+        o.reads_per_file = std::clamp(o.reads_per_file, 1u, 255u);
+        return o;
+    }
+}
+
+/**
+ * @brief Submission and completion rings shared with the kernel.
+ */
+struct UringReader::Ring
+{
+    int fd = -1;                         ///< io_uring descriptor.
+    void *sq_map = MAP_FAILED;           ///< Submission ring mapping.
+    std::size_t sq_bytes = 0;            ///< Size of @ref sq_map.
+    void *cq_map = MAP_FAILED;           ///< Completion ring mapping (may equal @ref sq_map).
+    std::size_t cq_bytes = 0;            ///< Size of @ref cq_map.
+    io_uring_sqe *sqes = nullptr;        ///< Submission queue entries.
+    std::size_t sqe_bytes = 0;           ///< Size of the @ref sqes mapping.
+    unsigned *sq_head = nullptr;         ///< Advanced by the kernel.
+    unsigned *sq_tail = nullptr;         ///< Advanced by us.
+    unsigned *sq_array = nullptr;        ///< Index array of the submission ring.
+    unsigned sq_mask = 0;                ///< Submission ring mask.
+    unsigned *cq_head = nullptr;         ///< Advanced by us.
+    unsigned *cq_tail = nullptr;         ///< Advanced by the kernel.
+    unsigned cq_mask = 0;                ///< Completion ring mask.
+    io_uring_cqe *cqes = nullptr;        ///< Completion queue entries.
+    unsigned capacity = 0;               ///< Submission queue entries.
+    unsigned local_tail = 0;             ///< Entries filled, published on submit().
+
+    ~Ring()
+    {
+        if (sqes)
+            ::munmap(sqes, sqe_bytes);
+        if (cq_map != MAP_FAILED && cq_map != sq_map)
+            ::munmap(cq_map, cq_bytes);
+        if (sq_map != MAP_FAILED)
+            ::munmap(sq_map, sq_bytes);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    /**
+     * @brief Creates the instance and maps its rings.
+     *
+     * @param entries Requested submission queue entries.
+     * @return true on success.
+     */
+    bool setup(unsigned entries)
+    {
+        io_uring_params p{};
+        fd = uring_setup(entries, &p);
+        if (fd < 0)
+            return false;
+
+        sq_bytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_bytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            sq_bytes = cq_bytes = std::max(sq_bytes, cq_bytes);
+
+        sq_map = ::mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+        if (sq_map == MAP_FAILED)
+            return false;
+        cq_map = single ? sq_map
+                        : ::mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED)
+            return false;
+        sqe_bytes = p.sq_entries * sizeof(io_uring_sqe);
+        void *s = ::mmap(nullptr, sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_SQES);
+        if (s == MAP_FAILED)
+            return false;
+        sqes = static_cast<io_uring_sqe *>(s);
+
+        char *sq = static_cast<char *>(sq_map);
+        sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        char *cq = static_cast<char *>(cq_map);
+        cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        capacity = p.sq_entries;
+        local_tail = *sq_tail;
+        return true;
+    }
+
+    /**
+     * @brief Returns a cleared entry to fill.
+     *
+     * @note The caller keeps the number of requests in flight at or below
+     *       @ref capacity, so an entry is always free.
+     */
+    io_uring_sqe *next()
+    {
+        const unsigned index = local_tail & sq_mask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        ++local_tail;
+        return sqe;
+    }
+
+    /**
+     * @brief Publishes the filled entries and waits for completions.
+     *
+     * @param wait Completions to wait for.
+     * @return Entries submitted, or -1 with errno set.
+     */
+    int submit(unsigned wait)
+    {
+        __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+        while (true)
+        {
+            const unsigned pending = local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            int r = uring_enter(fd, pending, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+            if (r < 0 && errno == EINTR)
+            {
+                if (__atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) != *cq_head)
+                    return 0;
+                continue;
+            }
+            return r;
+        }
+    }
+
+    /**
+     * @brief Takes back entries the kernel has not consumed.
+     *
+     * @details
+     * Used after submit() failed. Nothing else consumes the submission
+     * ring (no SQPOLL), so lowering its tail is safe. Each entry is handed
+     * to @p fn as if it had completed with -ECANCELED, so callers keep
+     * their bookkeeping in one place.
+     *
+     * @param fn Called with the request's user data and -ECANCELED.
+     */
+    template <typename Fn>
+    void withdraw(Fn &&fn)
+    {
+        const unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        for (unsigned i = head; i != local_tail; ++i)
+        {
+            fn(sqes[sq_array[i & sq_mask]].user_data, -ECANCELED);
+        }
+        local_tail = head;
+        __atomic_store_n(sq_tail, head, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * @brief Waits for a completion without submitting anything.
+     *
+     * @details
+     * Requests already taken by the kernel complete whether or not the
+     * ring accepts more, so if even waiting fails this sleeps briefly
+     * and lets the caller reap again.
+     */
+    void wait()
+    {
+        if (__atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) != *cq_head)
+            return;
+        if (uring_enter(fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    /**
+     * @brief Hands every available completion to @p fn.
+     *
+     * @param fn Called with the request's user data and result.
+     */
+    template <typename Fn>
+    void reap(Fn &&fn)
+    {
+        unsigned head = *cq_head;
+        const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe &cqe = cqes[head & cq_mask];
+            fn(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+};
+
+/**
+ * @brief A followed file and the round of reads it has in flight.
+ */
+struct UringReader::Tail
+{
+    /**
+     * @brief One read of the current round.
+     */
+    struct Read
+    {
+        unsigned buffer = 0; ///< Tail buffer the read lands in.
+        int result = 0;      ///< Bytes read, or -errno.
+        bool done = false;   ///< Completion seen.
+    };
+
+    std::string path;            ///< Path being followed.
+    Sink sink;                   ///< Receives the lines; poll()'s sink if empty.
+    int fd = -1;                 ///< Open file, -1 if none.
+    std::uint64_t dev = 0;       ///< Device of the open file.
+    std::uint64_t ino = 0;       ///< Inode of the open file.
+    std::uint64_t read_pos = 0;  ///< File offset just past the bytes consumed.
+    std::vector<char> carry;     ///< Incomplete final line.
+    std::vector<Read> reads;     ///< Current round, empty between rounds.
+    std::size_t next = 0;        ///< First read of the round not yet processed.
+    bool at_eof = false;         ///< A read of the round came up short.
+    bool behind = false;         ///< The last round was full; read unlinked.
+    struct statx stat{};         ///< Filled by the statx request.
+    bool stat_sent = false;      ///< statx submitted during this poll.
+    bool stat_done = false;      ///< statx completed.
+    int stat_result = 0;         ///< statx result.
+    bool recovered = false;      ///< Truncation or rotation handled during this poll.
+};
+
+/**
+ * @brief A file being loaded by load().
+ */
+struct UringReader::Load
+{
+    int fd = -1;                               ///< Open file, -1 if none.
+    bool opened = false;                       ///< open() was attempted.
+    bool failed = false;                       ///< Open or a read failed.
+    bool finished = false;                     ///< Handed to the sink.
+    FileFingerprint before;                    ///< Fingerprint before the reads.
+    std::unique_ptr<std::vector<char>> buffer; ///< Destination, size plus one spare byte.
+    std::size_t next = 0;                      ///< Offset of the next read to submit.
+    std::size_t got = 0;                       ///< Bytes read so far.
+    unsigned pending = 0;                      ///< Reads in flight.
+};
+
+/**
+ * @brief Stores the sizing; create() sets up the ring.
+ *
+ * @param opts Queue depth and buffer sizing.
+ * @param delimiter Line terminator.
+ */
+UringReader::UringReader(const UringOptions &opts, char delimiter)
+    : options(sanitized(opts)), framer(delimiter)
+{
+}
+
+/**
+ * @brief Sets up the ring and registers the tail buffers.
+ *
+ * @param options Queue depth and buffer sizing.
+ * @param delimiter Line terminator for tailed files.
+ * @return The reader, or nullptr if io_uring is unavailable.
+ */
+std::unique_ptr<UringReader> UringReader::create(const UringOptions &options, char delimiter)
+{
+    std::unique_ptr<UringReader> reader(new UringReader(options, delimiter));
+    const UringOptions &o = reader->options;
+
+    reader->ring = std::make_unique<Ring>();
+    if (!reader->ring->setup(o.queue_depth))
+    {
+        return nullptr;
+    }
+
+    reader->arena_bytes = o.buffers * o.block_size;
+    reader->arena = static_cast<char *>(page_alloc(reader->arena_bytes, 4096));
+
+    std::vector<iovec> iov(o.buffers);
+    for (unsigned i = 0; i < o.buffers; ++i)
+    {
+        iov[i].iov_base = reader->arena + i * o.block_size;
+        iov[i].iov_len = o.block_size;
+    }
+    reader->fixed = uring_register(reader->ring->fd, IORING_REGISTER_BUFFERS, iov.data(),
+                                   o.buffers) == 0;
+
+    reader->free_buffers.reserve(o.buffers);
+    for (unsigned i = o.buffers; i-- > 0;)
+    {
+        reader->free_buffers.push_back(i);
+    }
+    return reader;
+}
+
+/**
+ * @brief Closes every file and tears the ring down.
+ */
+UringReader::~UringReader()
+{
+    for (auto &tail : tails)
+    {
+        if (tail->fd >= 0)
+            ::close(tail->fd);
+    }
+    // Closing the ring unregisters the buffers before they are unmapped.
+    ring.reset();
+    if (arena)
+    {
+        page_free(arena, arena_bytes, 4096);
+    }
+}
+
+/**
+ * @brief Starts following @p path.
+ *
+ * @param path Path to the file.
+ * @param from_end Start at the current end.
+ * @param sink Receives this file's lines, or empty for poll()'s sink.
+ * @return false if @p path is already being followed.
+ */
+bool UringReader::add(const std::string &path, bool from_end, Sink sink)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &tail : tails)
+    {
+        if (tail->path == path)
+            return false;
+    }
+    auto tail = std::make_unique<Tail>();
+    tail->path = path;
+    tail->sink = std::move(sink);
+    open_tail(*tail, from_end);
+    tails.push_back(std::move(tail));
+    return true;
+}
+
+/**
+ * @brief Stops following @p path.
+ *
+ * @details
+ * Requests carry the file's position in @ref tails, which is safe to
+ * change here because poll() has reaped every request before it returns.
+ *
+ * @param path Path passed to add().
+ * @return true if the file was being followed.
+ */
+bool UringReader::remove(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(tails.begin(), tails.end(),
+                           [&](const std::unique_ptr<Tail> &t) { return t->path == path; });
+    if (it == tails.end())
+    {
+        return false;
+    }
+    if ((*it)->fd >= 0)
+    {
+        ::close((*it)->fd);
+    }
+    tails.erase(it);
+    return true;
+}
+
+/**
+ * @brief Number of files being followed.
+ *
+ * @return The count.
+ */
+std::size_t UringReader::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return tails.size();
+}
+
+/**
+ * @brief Opens the file currently at the tail's path.
+ *
+ * @param tail File to (re)open.
+ * @param at_end Position at the end of the file.
+ * @return true if the file was opened.
+ */
+bool UringReader::open_tail(Tail &tail, bool at_end)
+{
+    if (tail.fd >= 0)
+    {
+        ::close(tail.fd);
+        tail.fd = -1;
+    }
+    tail.carry.clear();
+    tail.read_pos = 0;
+    tail.behind = false;
+
+    tail.fd = ::open(tail.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (tail.fd < 0)
+    {
+        return false;
+    }
+    auto fp = FileFingerprint::capture(tail.fd);
+    if (!fp)
+    {
+        ::close(tail.fd);
+        tail.fd = -1;
+        return false;
+    }
+    tail.dev = fp->dev;
+    tail.ino = fp->ino;
+    tail.read_pos = at_end ? fp->size : 0;
+    return true;
+}
+
+/**
+ * @brief Reads everything appended to every followed file.
+ *
+ * @param sink Called once per buffer of complete lines.
+ * @return Number of lines delivered.
+ */
+std::size_t UringReader::poll(const Sink &sink)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::size_t delivered = 0;
+    std::deque<std::size_t> queue;
+    for (std::size_t i = 0; i < tails.size(); ++i)
+    {
+        Tail &tail = *tails[i];
+        tail.stat_sent = tail.recovered = false;
+        if (tail.fd >= 0 || open_tail(tail, false))
+        {
+            queue.push_back(i);
+        }
+    }
+
+    std::vector<std::size_t> runnable;
+    std::vector<std::size_t> touched;
+    auto complete = [&](std::uint64_t data, int result) {
+        --in_flight;
+        const std::size_t index = static_cast<std::size_t>(data >> 8);
+        const unsigned slot = static_cast<unsigned>(data & 0xFF);
+        Tail &tail = *tails[index];
+        if (slot == 0)
+        {
+            tail.stat_done = true;
+            tail.stat_result = result;
+        }
+        else
+        {
+            tail.reads[slot - 1].result = result;
+            tail.reads[slot - 1].done = true;
+        }
+        touched.push_back(index);
+    };
+
+    // Set when the ring refuses submissions; from then on only the
+    // requests already taken are waited for, so none outlives this call.
+    bool broken = false;
+    while (!queue.empty() || in_flight > 0)
+    {
+        while (!broken && !queue.empty() && submit_tail(queue.front()))
+        {
+            queue.pop_front();
+        }
+        if (in_flight == 0)
+        {
+            // Nothing could be submitted; only happens if the ring is unusable.
+            break;
+        }
+
+        touched.clear();
+        if (broken)
+        {
+            ring->wait();
+        }
+        else if (ring->submit(1) < 0 && errno != EAGAIN && errno != EBUSY)
+        {
+            broken = true;
+            queue.clear();
+            ring->withdraw(complete);
+        }
+        ring->reap(complete);
+
+        runnable.clear();
+        for (std::size_t index : touched)
+        {
+            delivered += process_tail(index, sink, runnable);
+        }
+        if (!broken)
+        {
+            queue.insert(queue.end(), runnable.begin(), runnable.end());
+        }
+    }
+    return delivered;
+}
+
+/**
+ * @brief Queues the next round of reads for a file.
+ *
+ * @details
+ * The reads cover consecutive blocks from the current position. Unless
+ * the file is behind they are linked, so a short read at the end of the
+ * file cancels the rest of the round.
+ *
+ * @param index Position of the file in @ref tails.
+ * @return false if no buffers or queue entries are free.
+ */
+bool UringReader::submit_tail(std::size_t index)
+{
+    Tail &tail = *tails[index];
+    const unsigned count = std::min<unsigned>(options.reads_per_file,
+                                              static_cast<unsigned>(free_buffers.size()));
+    const unsigned needed = count + (tail.stat_sent ? 0 : 1);
+    if (count == 0 || in_flight + needed > ring->capacity)
+    {
+        return false;
+    }
+
+    if (!tail.stat_sent)
+    {
+        io_uring_sqe *sqe = ring->next();
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(tail.path.c_str());
+        sqe->len = STATX_TYPE | STATX_INO | STATX_SIZE;
+        sqe->off = reinterpret_cast<std::uint64_t>(&tail.stat);
+        sqe->user_data = static_cast<std::uint64_t>(index) << 8;
+        tail.stat_sent = true;
+        tail.stat_done = false;
+    }
+
+    tail.reads.assign(count, Tail::Read{});
+    tail.next = 0;
+    tail.at_eof = false;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const unsigned buffer = free_buffers.back();
+        free_buffers.pop_back();
+        tail.reads[i].buffer = buffer;
+
+        io_uring_sqe *sqe = ring->next();
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = tail.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(arena + buffer * options.block_size);
+        sqe->len = static_cast<std::uint32_t>(options.block_size);
+        sqe->off = tail.read_pos + i * options.block_size;
+        sqe->buf_index = fixed ? static_cast<std::uint16_t>(buffer) : 0;
+        sqe->user_data = (static_cast<std::uint64_t>(index) << 8) | (i + 1);
+        if (!tail.behind && i + 1 < count)
+        {
+            sqe->flags = IOSQE_IO_LINK;
+        }
+    }
+    in_flight += needed;
+    return true;
+}
+
+/**
+ * @brief Delivers completed reads of a file in offset order.
+ *
+ * @details
+ * Reads after the first short one are discarded: their offsets lie past
+ * what was consumed, and the file is read from there next time. Once the
+ * round is over, a file that reached its end is checked against the
+ * path's statx for truncation and rotation.
+ *
+ * @param index Position of the file in @ref tails.
+ * @param sink Receives the lines.
+ * @param runnable Receives @p index if the file needs another round.
+ * @return Number of lines delivered.
+ */
+std::size_t UringReader::process_tail(std::size_t index, const Sink &sink,
+                                      std::vector<std::size_t> &runnable)
+{
+    Tail &tail = *tails[index];
+    if (tail.reads.empty())
+    {
+        return 0;
+    }
+
+    std::size_t delivered = 0;
+    const int block = static_cast<int>(options.block_size);
+    while (tail.next < tail.reads.size() && tail.reads[tail.next].done)
+    {
+        const Tail::Read &read = tail.reads[tail.next++];
+        if (!tail.at_eof && read.result > 0)
+        {
+            delivered += deliver(tail, arena + read.buffer * options.block_size,
+                                 static_cast<std::size_t>(read.result), sink);
+            tail.read_pos += static_cast<std::uint64_t>(read.result);
+        }
+        if (read.result < block)
+        {
+            tail.at_eof = true;
+        }
+        free_buffers.push_back(read.buffer);
+    }
+    if (tail.next < tail.reads.size() || (tail.stat_sent && !tail.stat_done))
+    {
+        return delivered;
+    }
+
+    tail.reads.clear();
+    tail.behind = !tail.at_eof;
+    if (tail.behind)
+    {
+        runnable.push_back(index);
+        return delivered;
+    }
+    if (!tail.stat_sent || tail.stat_result != 0 || tail.recovered)
+    {
+        return delivered;
+    }
+
+    const std::uint64_t dev = makedev(tail.stat.stx_dev_major, tail.stat.stx_dev_minor);
+    if (dev == tail.dev && tail.stat.stx_ino == tail.ino)
+    {
+        if (tail.stat.stx_size < tail.read_pos)
+        {
+            // Truncated in place: start over from the beginning.
+            tail.carry.clear();
+            tail.read_pos = 0;
+            tail.recovered = true;
+            runnable.push_back(index);
+        }
+    }
+    else if (open_tail(tail, false))
+    {
+        // Rotated: the old file has been drained; follow the new one.
+        tail.recovered = true;
+        runnable.push_back(index);
+    }
+    return delivered;
+}
+
+/**
+ * @brief Frames bytes read from a tailed file and passes on its lines.
+ *
+ * @details
+ * Lines are framed in place in the read buffer. Only a line split across
+ * two reads is assembled in the file's carry buffer.
+ *
+ * @param tail File the bytes belong to.
+ * @param data Bytes read.
+ * @param length Number of bytes.
+ * @param sink Receives the lines.
+ * @return Number of lines delivered.
+ */
+std::size_t UringReader::deliver(Tail &tail, const char *data, std::size_t length,
+                                 const Sink &sink)
+{
+    const char *begin = data;
+    const char *end = data + length;
+    lines.clear();
+
+    if (!tail.carry.empty())
+    {
+        const char *delim = find_delimiter(begin, end, framer.delimiter());
+        if (delim == end)
+        {
+            tail.carry.insert(tail.carry.end(), begin, end);
+            return 0;
+        }
+        tail.carry.insert(tail.carry.end(), begin, delim);
+        lines.emplace_back(tail.carry.data(), tail.carry.size());
+        begin = delim + 1;
+    }
+
+    const std::size_t used = framer.frame(begin, static_cast<std::size_t>(end - begin), lines);
+    const Sink &target = tail.sink ? tail.sink : sink;
+    if (!lines.empty() && target)
+    {
+        target(tail.path, lines);
+    }
+    tail.carry.assign(begin + used, end);
+    return lines.size();
+}
+
+/**
+ * @brief Loads several whole files with all of their reads in flight.
+ *
+ * @details
+ * Files are opened in order as queue entries free up, and each is split
+ * into block-sized reads that run in parallel. One spare byte past the
+ * recorded size detects a file that grew.
+ *
+ * @param paths Files to load.
+ * @param sink Called once per path, in completion order.
+ * @return Number of files loaded successfully.
+ */
+std::size_t UringReader::load(const std::vector<std::string> &paths, const LoadSink &sink)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    BufferPool &pool = BufferPool::instance();
+
+    std::vector<Load> loads(paths.size());
+    std::size_t loaded = 0;
+    std::size_t finished = 0;
+
+    auto finish = [&](std::size_t index) {
+        Load &load = loads[index];
+        load.finished = true;
+        ++finished;
+
+        bool ok = !load.failed && load.got == load.before.size;
+        if (ok)
+        {
+            auto after = FileFingerprint::capture(load.fd);
+            auto current = FileFingerprint::capture(paths[index]);
+            ok = after && current && *after == load.before && *current == load.before;
+        }
+        if (load.fd >= 0)
+        {
+            ::close(load.fd);
+            load.fd = -1;
+        }
+        if (!ok)
+        {
+            if (load.buffer)
+                pool.recycle(std::move(load.buffer));
+            sink(paths[index], std::nullopt);
+            return;
+        }
+        load.buffer->resize(load.before.size);
+        ++loaded;
+        sink(paths[index], FileContent{pool.share(std::move(load.buffer)), load.before});
+    };
+
+    auto complete = [&](std::uint64_t data, int result) {
+        --in_flight;
+        const std::size_t index = static_cast<std::size_t>(data & ~LOAD_TAG);
+        Load &load = loads[index];
+        --load.pending;
+        if (result < 0)
+            load.failed = true;
+        else
+            load.got += static_cast<std::size_t>(result);
+        if (load.pending == 0 && (load.failed || load.next == load.buffer->size()))
+            finish(index);
+    };
+
+    // As in poll(): after a refused submission, fail what is left and
+    // wait for the reads already taken, which still write to the buffers.
+    bool broken = false;
+    std::size_t cursor = 0;
+    while (finished < loads.size())
+    {
+        while (cursor < loads.size() && in_flight < ring->capacity)
+        {
+            Load &load = loads[cursor];
+            if (broken && !load.failed)
+            {
+                load.opened = true;
+                load.failed = true;
+            }
+            if (!load.opened)
+            {
+                load.opened = true;
+                load.fd = ::open(paths[cursor].c_str(), O_RDONLY | O_CLOEXEC);
+                auto fp = load.fd >= 0 ? FileFingerprint::capture(load.fd) : std::nullopt;
+                if (fp)
+                {
+                    load.before = *fp;
+                    load.buffer = pool.acquire(fp->size + 1);
+                    load.buffer->resize(fp->size + 1);
+                }
+                else
+                {
+                    load.failed = true;
+                }
+            }
+            if (load.failed)
+            {
+                if (load.pending == 0 && !load.finished)
+                    finish(cursor);
+                ++cursor;
+                continue;
+            }
+            submit_load(load, cursor);
+            if (load.next < load.buffer->size())
+            {
+                break;
+            }
+            ++cursor;
+        }
+        if (in_flight == 0)
+        {
+            continue;
+        }
+        if (broken)
+        {
+            ring->wait();
+        }
+        else if (ring->submit(1) < 0 && errno != EAGAIN && errno != EBUSY)
+        {
+            broken = true;
+            ring->withdraw(complete);
+        }
+        ring->reap(complete);
+    }
+    return loaded;
+}
+
+/**
+ * @brief Queues reads for the next blocks of a file being loaded.
+ *
+ * @param load File being loaded.
+ * @param index Position of the file in the request.
+ */
+void UringReader::submit_load(Load &load, std::size_t index)
+{
+    const std::size_t length = load.buffer->size();
+    while (load.next < length && in_flight < ring->capacity)
+    {
+        const std::size_t len = std::min(options.block_size, length - load.next);
+        io_uring_sqe *sqe = ring->next();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = load.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(load.buffer->data() + load.next);
+        sqe->len = static_cast<std::uint32_t>(len);
+        sqe->off = load.next;
+        sqe->user_data = LOAD_TAG | index;
+        load.next += len;
+        ++load.pending;
+        ++in_flight;
+    }
+}
@@ -0,0 +1,234 @@
+/**
+ * @file uringreader.hpp
+ * @brief Batched tail and content reads for many files through io_uring.
+ *
+ * @details
+ * A TailReader per file issues one synchronous pread() at a time, so a
+ * poll over hundreds of files on a slow disk waits for each read in turn
+ * and only more threads would overlap them. UringReader keeps one
+ * io_uring instance for all of its files and has reads for every file in
+ * flight at once; throughput follows the device queue depth, not the
+ * number of threads.
+ *
+ * Tail reads land in buffers registered with the ring once, so the
+ * kernel does not pin and map them again for every read. Each file gets
+ * several reads per round at consecutive offsets. Near the end of the
+ * file (the usual case when tailing) they are linked: the first short
+ * read ends the file's chain and the rest complete as cancelled without
+ * touching the disk. A file that filled its whole chain is behind, and
+ * its next round is submitted unlinked so the reads run in parallel.
+ * Each completed read is processed as soon as every earlier read of the
+ * same file is: its lines are framed in the registered buffer and handed
+ * to the sink, and the buffer goes straight back to the pool.
+ *
+ * A statx of the path rides along with each file's first round and
+ * replaces the separate stat calls TailReader makes to notice truncation
+ * and rotation.
+ *
+ * The ring is driven with the raw system calls; liburing is not needed.
+ * MonitorFile::add_uring_tail_callback() follows watched files through
+ * a shared reader, so activity on any of them reads all of them at once.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef URINGREADER_HPP
+#define URINGREADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "contentloader.hpp"
+#include "lineframer.hpp"
+
+/**
+ * @struct UringOptions
+ * @brief Sizing of a UringReader.
+ */
+struct UringOptions
+{
+    unsigned queue_depth = 128;         ///< Submission queue entries; caps reads in flight.
+    std::size_t block_size = 64 * 1024; ///< Bytes per read and per registered buffer.
+    unsigned buffers = 128;             ///< Registered tail buffers.
+    unsigned reads_per_file = 4;        ///< Reads submitted per file per round (1..255).
+};
+
+/**
+ * @class UringReader
+ * @brief Follows many growing files and loads many files over one io_uring.
+ *
+ * @details
+ * poll() and load() may be called from several threads; calls are
+ * serialized. Sinks run on the calling thread.
+ */
+class UringReader
+{
+public:
+    /// Receives lines of one file; the views are valid only during the call.
+    using Sink = std::function<void(const std::string &path, const LineBatch &lines)>;
+
+    /// Receives one loaded file, or std::nullopt if it could not be read consistently.
+    using LoadSink = std::function<void(const std::string &path, std::optional<FileContent> content)>;
+
+    /**
+     * @brief Sets up the ring and registers the tail buffers.
+     *
+     * @details
+     * If the buffers cannot be registered (for example because of the
+     * locked-memory limit on older kernels) the reader still works with
+     * ordinary reads into the same buffers; see registered().
+     *
+     * @param options Queue depth and buffer sizing.
+     * @param delimiter Line terminator for tailed files.
+     * @return The reader, or nullptr if io_uring is unavailable.
+     */
+    static std::unique_ptr<UringReader> create(const UringOptions &options = {},
+                                               char delimiter = '\n');
+
+    /**
+     * @brief Closes every file and tears the ring down.
+     */
+    ~UringReader();
+
+    UringReader(const UringReader &) = delete;
+    UringReader &operator=(const UringReader &) = delete;
+
+    /**
+     * @brief Starts following @p path.
+     *
+     * @details
+     * A missing file is not an error; it is opened by the first poll()
+     * that finds it, from the beginning.
+     *
+     * @param path Path to the file.
+     * @param from_end Start at the current end (true) or the beginning.
+     * @param sink Receives this file's lines instead of the sink passed
+     *        to poll(); lets several owners share one reader.
+     * @return false if @p path is already being followed.
+     */
+    bool add(const std::string &path, bool from_end = true, Sink sink = nullptr);
+
+    /**
+     * @brief Stops following @p path.
+     *
+     * @param path Path passed to add().
+     * @return true if the file was being followed.
+     */
+    bool remove(const std::string &path);
+
+    /**
+     * @brief Reads everything appended to every followed file.
+     *
+     * @details
+     * Returns once each file has been read to its end. Truncation restarts
+     * a file from the beginning; when the path was replaced, the rest of
+     * the old file is drained and the new one is read from the start.
+     * Every request is reaped before returning, even if the ring starts
+     * refusing submissions; files left unread are read by the next poll.
+     *
+     * @param sink Called once per buffer of complete lines of every file
+     *        added without a sink of its own; may be empty.
+     * @return Number of lines delivered.
+     */
+    std::size_t poll(const Sink &sink);
+
+    /**
+     * @brief Loads several whole files with all of their reads in flight.
+     *
+     * @details
+     * Like load_file(), the bytes are only accepted if the file's
+     * fingerprint did not change while it was read, but there is no
+     * retry; a file that fails can be handed to load_file(). Contents are
+     * read straight into BufferPool buffers, and no read is left in flight
+     * when load() returns.
+     *
+     * @param paths Files to load.
+     * @param sink Called once per path, in completion order.
+     * @return Number of files loaded successfully.
+     */
+    std::size_t load(const std::vector<std::string> &paths, const LoadSink &sink);
+
+    /**
+     * @brief Number of files being followed.
+     */
+    std::size_t size();
+
+    /**
+     * @brief Whether tail reads use registered (fixed) buffers.
+     */
+    bool registered() const { return fixed; }
+
+private:
+    struct Ring;
+    struct Tail;
+    struct Load;
+
+    UringReader(const UringOptions &options, char delimiter);
+
+    /**
+     * @brief Opens the file currently at the tail's path.
+     *
+     * @param tail File to (re)open; its position and carried bytes are reset.
+     * @param at_end Position at the end of the file instead of the start.
+     * @return true if the file was opened.
+     */
+    bool open_tail(Tail &tail, bool at_end);
+
+    /**
+     * @brief Queues the next round of reads for @p tail.
+     *
+     * @return false if no buffers or queue entries are free.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    bool submit_tail(std::size_t index);
+
+    /**
+     * @brief Delivers completed reads of @p tail in offset order.
+     *
+     * @param index Position of the file in @ref tails.
+     * @param sink Receives the lines.
+     * @param runnable Receives @p index if the file needs another round.
+     * @return Number of lines delivered.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    std::size_t process_tail(std::size_t index, const Sink &sink,
+                             std::vector<std::size_t> &runnable);
+
+    /**
+     * @brief Frames bytes read from a tailed file and passes on its lines.
+     *
+     * @return Number of lines delivered.
+     */
+    std::size_t deliver(Tail &tail, const char *data, std::size_t length, const Sink &sink);
+
+    /**
+     * @brief Queues reads for the next blocks of @p load.
+     *
+     * @note Caller must hold @ref mutex.
+     */
+    void submit_load(Load &load, std::size_t index);
+
+    const UringOptions options;            ///< Sizing the reader was created with.
+    const LineFramer framer;               ///< Splits tailed bytes into lines.
+    std::mutex mutex;                      ///< Serializes all public operations.
+    std::unique_ptr<Ring> ring;            ///< The io_uring instance.
+    unsigned in_flight = 0;                ///< Submitted requests not yet reaped.
+    char *arena = nullptr;                 ///< Backing store of the tail buffers.
+    std::size_t arena_bytes = 0;           ///< Size of @ref arena.
+    bool fixed = false;                    ///< Tail buffers are registered.
+    std::vector<unsigned> free_buffers;    ///< Indices of idle tail buffers.
+    std::vector<std::unique_ptr<Tail>> tails; ///< Followed files.
+    LineBatch lines;                       ///< Reused batch storage.
+};
+
+#endif // URINGREADER_HPP
@@ -0,0 +1,625 @@
+/**
+ * @file watch.cpp
+ * @brief Implementation file for the shared Watch core.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "watch.hpp"
+#include "fanotifyengine.hpp"
+#include "inotifyengine.hpp"
+#include "watchregistry.hpp"
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+/**
+ * @brief Lower-case name of a backend.
+ *
+ * @param backend Backend to name.
+ * @return A static string.
+ */
+const char *backend_name(MonitorBackend backend)
+{
+    switch (backend)
+    {
+    case MonitorBackend::POLLING:
+        return "polling";
+    case MonitorBackend::INOTIFY:
+        return "inotify";
+    case MonitorBackend::FANOTIFY:
+        return "fanotify";
+    case MonitorBackend::AUTO:
+        return "auto";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Resolves the device and inode of a path.
+ *
+ * @param path Path to the file; symlinks are followed.
+ * @return The identity, or std::nullopt if stat() fails.
+ */
+std::optional<FileIdentity> FileIdentity::of(const std::string &path)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+    {
+        return std::nullopt;
+    }
+    return FileIdentity{st.st_dev, st.st_ino};
+}
+
+/**
+ * @brief Creates the watch and starts polling.
+ *
+ * @param path Path used to poll the file.
+ * @param identity Device and inode of the file.
+ * @param interval Initial polling interval.
+ * @param backend Initial change notification backend.
+ */
+Watch::Watch(std::string path, FileIdentity identity, std::chrono::milliseconds interval,
+             MonitorBackend backend)
+    : file_name(std::move(path)),
+      file_identity(identity),
+      stop_monitoring(false),
+      polling_interval(interval),
+      monitoring_state(MonitorState::MONITORING),
+      generation(std::make_shared<std::atomic<std::uint64_t>>(0)),
+      content(std::make_shared<SharedContent>())
+{
+    content->set_path(file_name);
+    std::error_code ec;
+    org_time = fs::last_write_time(file_name, ec);
+    if (ec)
+    {
+        org_time = fs::file_time_type::min();
+    }
+    if (backend != MonitorBackend::POLLING)
+    {
+        set_backend(backend);
+    }
+    dispatch_thread = std::thread(&Watch::dispatch_loop, this);
+    monitoring_thread = std::thread(&Watch::monitor_loop, this);
+}
+
+/**
+ * @brief Stops the polling thread and removes the watch from the registry.
+ *
+ * @note Must not run on the watch's own threads; see dispose().
+ */
+Watch::~Watch()
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        stop_monitoring.store(true);
+        monitoring_state.store(MonitorState::NOT_MONITORING);
+    }
+    {
+        // After stop_monitoring, so the loop cannot register again.
+        std::lock_guard<std::mutex> guard(backend_mutex);
+        release_backend();
+    }
+
+    cv.notify_all();
+    dispatch_cv.notify_all();
+
+    if (monitoring_thread.joinable())
+    {
+        monitoring_thread.join();
+    }
+    if (dispatch_thread.joinable())
+    {
+        dispatch_thread.join();
+    }
+
+    WatchRegistry::instance().release(file_identity);
+}
+
+/**
+ * @brief Deletes a watch, off its own threads.
+ *
+ * @param watch Watch to delete.
+ */
+void Watch::dispose(Watch *watch)
+{
+    const std::thread::id self = std::this_thread::get_id();
+    if (self == watch->dispatch_thread.get_id() || self == watch->monitoring_thread.get_id())
+    {
+        std::thread([watch] { delete watch; }).detach();
+        return;
+    }
+    delete watch;
+}
+
+/**
+ * @brief Adds a listener.
+ *
+ * @param func Listener invoked once per confirmed change.
+ * @return Identifier to pass to unsubscribe().
+ */
+SubscriptionId Watch::subscribe(Listener func)
+{
+    return listeners.add(std::move(func));
+}
+
+/**
+ * @brief Adds an activity listener.
+ *
+ * @param func Listener invoked on unconfirmed activity.
+ * @return Identifier to pass to unsubscribe_activity().
+ */
+SubscriptionId Watch::subscribe_activity(ActivityListener func)
+{
+    return activity_listeners.add(std::move(func));
+}
+
+/**
+ * @brief Removes an activity listener.
+ *
+ * @details
+ * Waits for a notification in progress unless called from the polling
+ * thread itself.
+ *
+ * @param id Identifier returned by subscribe_activity().
+ * @return true if the listener was removed.
+ */
+bool Watch::unsubscribe_activity(SubscriptionId id)
+{
+    bool removed = activity_listeners.remove(id);
+    if (removed && std::this_thread::get_id() != monitoring_thread.get_id())
+    {
+        std::lock_guard<std::mutex> quiesce(activity_mutex);
+    }
+    return removed;
+}
+
+/**
+ * @brief Adds a listener run as each change is confirmed.
+ *
+ * @param func Listener to add.
+ * @return Identifier to pass to unsubscribe_confirm().
+ */
+SubscriptionId Watch::subscribe_confirm(ActivityListener func)
+{
+    return confirm_listeners.add(std::move(func));
+}
+
+/**
+ * @brief Removes a confirm listener.
+ *
+ * @details
+ * Confirm and activity listeners run under the same mutex, so the wait
+ * works exactly as in unsubscribe_activity().
+ *
+ * @param id Identifier returned by subscribe_confirm().
+ * @return true if the listener was removed.
+ */
+bool Watch::unsubscribe_confirm(SubscriptionId id)
+{
+    bool removed = confirm_listeners.remove(id);
+    if (removed && std::this_thread::get_id() != monitoring_thread.get_id())
+    {
+        std::lock_guard<std::mutex> quiesce(activity_mutex);
+    }
+    return removed;
+}
+
+/**
+ * @brief Removes a listener.
+ *
+ * @details
+ * The listener is dropped from the published array right away. If a
+ * dispatch that still holds the old array is running on another thread,
+ * this call waits for it to finish so the caller can safely tear down
+ * whatever the listener refers to.
+ *
+ * @param id Identifier returned by subscribe().
+ * @return true if the listener was removed.
+ */
+bool Watch::unsubscribe(SubscriptionId id)
+{
+    bool removed = listeners.remove(id);
+    if (removed && std::this_thread::get_id() != dispatch_thread.get_id())
+    {
+        std::lock_guard<std::mutex> quiesce(dispatch_mutex);
+    }
+    return removed;
+}
+
+/**
+ * @brief Sets the polling interval for monitoring.
+ *
+ * @param interval The new polling interval in milliseconds.
+ */
+void Watch::set_polling_interval(std::chrono::milliseconds interval)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    polling_interval = interval;
+    cv.notify_all();
+}
+
+/**
+ * @brief Switches the change notification backend.
+ *
+ * @details
+ * Engine calls are made without holding @ref mutex, because the engines
+ * take that mutex (through wake()) while holding their own.
+ *
+ * AUTO resolves to INOTIFY on file systems whose local events see every
+ * write, falling back to FANOTIFY if inotify refuses the file, and to
+ * POLLING elsewhere, with the interval floored at the mount's attribute
+ * cache lifetime. An event backend that cannot register polls.
+ *
+ * @param backend Backend to use.
+ */
+void Watch::set_backend(MonitorBackend backend)
+{
+    std::lock_guard<std::mutex> guard(backend_mutex);
+
+    requested = backend;
+    release_backend();
+    register_backend();
+}
+
+/**
+ * @brief Registers with the engine @ref requested calls for.
+ *
+ * @details
+ * AUTO probes the file system again, since the file may have come back
+ * on a different one.
+ *
+ * @note Caller must hold @ref backend_mutex.
+ */
+void Watch::register_backend()
+{
+    MonitorBackend backend = requested;
+    std::chrono::milliseconds floor{0};
+    const bool automatic = backend == MonitorBackend::AUTO;
+    if (automatic)
+    {
+        filesystem_info = probe_filesystem(file_name);
+        // An unprobeable file is most likely missing; assume local.
+        backend = !filesystem_info || filesystem_info->events ? MonitorBackend::INOTIFY
+                                                              : MonitorBackend::POLLING;
+        if (filesystem_info)
+        {
+            floor = filesystem_info->min_interval;
+        }
+    }
+    else
+    {
+        filesystem_info.reset();
+    }
+
+    if (backend == MonitorBackend::INOTIFY)
+    {
+        inotify_token.store(InotifyEngine::instance().add(file_name, [this] { wake(); }));
+    }
+    if (backend == MonitorBackend::FANOTIFY || (automatic && backend == MonitorBackend::INOTIFY &&
+                                                !inotify_token.load()))
+    {
+        fanotify_token.store(FanotifyEngine::instance().add(file_name, [this] { wake(); }));
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        interval_floor = floor;
+        pending_event = true; // re-check once under the new backend
+    }
+    cv.notify_all();
+}
+
+/**
+ * @brief Registers again after the file reappeared.
+ *
+ * @details
+ * InotifyEngine re-attaches the registration itself once the directory
+ * exists again; registering anew also covers a registration the engine
+ * could not re-attach and a file that came back on another file system.
+ */
+void Watch::refresh_backend()
+{
+    std::lock_guard<std::mutex> guard(backend_mutex);
+    if (stop_monitoring.load() || requested == MonitorBackend::POLLING)
+    {
+        return;
+    }
+    release_backend();
+    register_backend();
+}
+
+/**
+ * @brief Backend actually in use.
+ *
+ * @details
+ * Must not be called with @ref mutex held: InotifyEngine::attached()
+ * takes the engine's lock, which the engine holds while calling wake().
+ *
+ * @return INOTIFY or FANOTIFY if registered with that engine, otherwise
+ *         POLLING.
+ */
+MonitorBackend Watch::get_backend() const
+{
+    const InotifyEngine::Token token = inotify_token.load();
+    if (token)
+    {
+        return InotifyEngine::instance().attached(token) ? MonitorBackend::INOTIFY
+                                                         : MonitorBackend::POLLING;
+    }
+    return fanotify_token.load() ? MonitorBackend::FANOTIFY : MonitorBackend::POLLING;
+}
+
+/**
+ * @brief File system the last AUTO selection was based on.
+ *
+ * @return The probe result, or std::nullopt.
+ */
+std::optional<FilesystemInfo> Watch::filesystem() const
+{
+    std::lock_guard<std::mutex> guard(backend_mutex);
+    return filesystem_info;
+}
+
+/**
+ * @brief Unregisters from the event engines.
+ *
+ * @details
+ * Once this returns the engines no longer call wake().
+ */
+void Watch::release_backend()
+{
+    InotifyEngine::Token token = inotify_token.exchange(0);
+    if (token)
+    {
+        InotifyEngine::instance().remove(token);
+    }
+    FanotifyEngine::Token fan = fanotify_token.exchange(0);
+    if (fan)
+    {
+        FanotifyEngine::instance().remove(fan);
+    }
+}
+
+/**
+ * @brief Wakes the monitoring loop.
+ *
+ * @details
+ * Called from an engine's reader thread. The flag is set under the mutex
+ * so the wake-up cannot slip in between the loop's predicate check and
+ * its wait.
+ */
+void Watch::wake()
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        pending_event = true;
+    }
+    cv.notify_all();
+}
+
+/**
+ * @brief Sets the scheduling policy and priority for the watch threads.
+ *
+ * @param schedPolicy The desired scheduling policy.
+ * @param priority The priority level associated with the policy.
+ * @return `true` if `pthread_setschedparam()` succeeded for both threads.
+ */
+bool Watch::set_priority(int schedPolicy, int priority)
+{
+    if (!monitoring_thread.joinable() || !dispatch_thread.joinable())
+    {
+        return false;
+    }
+
+    sched_param sch_params;
+    sch_params.sched_priority = priority;
+    int ret = pthread_setschedparam(monitoring_thread.native_handle(), schedPolicy, &sch_params);
+    if (ret == 0)
+    {
+        ret = pthread_setschedparam(dispatch_thread.native_handle(), schedPolicy, &sch_params);
+    }
+
+    return (ret == 0);
+}
+
+/**
+ * @brief Gets the current state of the watch.
+ *
+ * @return The current monitoring state.
+ */
+MonitorState Watch::get_state() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return monitoring_state;
+}
+
+/**
+ * @brief Runs the monitoring loop to detect file changes.
+ */
+void Watch::monitor_loop()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // Initialize last_reported_time so we never treat the very first timestamp
+    // as “new” when it's actually just our starting point.
+    fs::file_time_type last_reported_time = org_time.value();
+
+    // This flag tracks whether we've seen a write > org_time yet.
+    bool change_detected = false;
+    stable_checks = 0;
+
+    while (!stop_monitoring.load())
+    {
+        // With an event backend there is nothing to poll for until the engine
+        // reports activity; keep timed waits while debouncing or while the
+        // file is missing (its directory may be gone along with the watch).
+        // A detached registration counts as polling until it is re-attached.
+        lock.unlock();
+        const bool events = get_backend() != MonitorBackend::POLLING;
+        lock.lock();
+        if (events && !change_detected &&
+            monitoring_state.load() != MonitorState::FILE_NOT_FOUND)
+        {
+            cv.wait(lock, [this] {
+                return stop_monitoring.load() || pending_event;
+            });
+        }
+        else
+        {
+            // wait_for returns true if predicate (stop) becomes true
+            cv.wait_for(lock, std::max(polling_interval, interval_floor), [this] {
+                return stop_monitoring.load();
+            });
+        }
+        pending_event = false;
+        if (stop_monitoring.load())
+            return;
+
+        if (!fs::exists(file_name))
+        {
+            monitoring_state.store(MonitorState::FILE_NOT_FOUND);
+            continue;
+        }
+        if (monitoring_state.load() == MonitorState::FILE_NOT_FOUND)
+        {
+            monitoring_state.store(MonitorState::MONITORING);
+            lock.unlock();
+            refresh_backend();
+            lock.lock();
+        }
+
+        if (!events)
+        {
+            // release lock while we sleep to allow set_polling_interval / stop()
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            lock.lock();
+        }
+
+        std::error_code ec;
+        auto last_write = fs::last_write_time(file_name, ec);
+        if (ec)
+        {
+            continue;
+        }
+
+        if (!change_detected)
+        {
+            // Haven't seen any write > org_time yet
+            if (last_write > org_time.value())
+            {
+                change_detected = true;
+                org_time = last_write;
+                stable_checks = 0;      // start counting stability from here
+                notify_path(activity_listeners, lock);
+            }
+            // ELSE: still no change — keep waiting
+            continue;
+        }
+
+        // Once we've detected a write, watch for stable intervals
+        if (last_write > org_time.value())
+        {
+            // file changed again before stabilizing
+            org_time = last_write;
+            stable_checks = 0;
+            notify_path(activity_listeners, lock);
+        }
+        else
+        {
+            // file unchanged since last write
+            if (++stable_checks >= 3 && last_write != last_reported_time)
+            {
+                last_reported_time = last_write;
+                monitoring_state.store(MonitorState::FILE_CHANGED);
+                notify_path(confirm_listeners, lock);
+
+                // hand the change to the dispatch thread; bumping the
+                // generation also cancels a dispatch still in progress
+                generation->fetch_add(1, std::memory_order_acq_rel);
+                dispatch_cv.notify_all();
+
+                // reset for the next change
+                stable_checks = 0;
+                change_detected = false;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Runs activity or confirm listeners with the watched path.
+ *
+ * @param targets List to notify.
+ * @param lock The polling loop's lock; released while listeners run.
+ */
+void Watch::notify_path(const SubscriberList<ActivityListener> &targets,
+                        std::unique_lock<std::shared_mutex> &lock)
+{
+    if (targets.empty())
+    {
+        return;
+    }
+
+    lock.unlock();
+    {
+        // Snapshot under the mutex so unsubscribe_activity() can wait out
+        // any notification still using a removed listener.
+        std::lock_guard<std::mutex> notifying(activity_mutex);
+        auto subs = targets.snapshot();
+        for (const auto &sub : *subs)
+        {
+            sub.func(file_name);
+        }
+    }
+    lock.lock();
+}
+
+/**
+ * @brief Runs listeners for confirmed changes.
+ *
+ * @details
+ * Always handles the newest generation; generations confirmed while a
+ * dispatch was running are coalesced into the next one. The snapshot is
+ * taken under dispatch_mutex so unsubscribe() can wait out any dispatch
+ * that still sees a removed listener.
+ */
+void Watch::dispatch_loop()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    std::uint64_t handled = 0;
+
+    while (true)
+    {
+        dispatch_cv.wait(lock, [&] {
+            return stop_monitoring.load() || generation->load() != handled;
+        });
+        if (stop_monitoring.load())
+            return;
+
+        handled = generation->load();
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> dispatching(dispatch_mutex);
+            CancelToken token(generation, handled);
+            auto subs = listeners.snapshot();
+            for (const auto &sub : *subs)
+            {
+                // a newer change supersedes the rest of this dispatch
+                if (token.cancelled())
+                    break;
+                sub.func(token);
+            }
+        }
+        lock.lock();
+
+        if (generation->load() == handled)
+        {
+            MonitorState changed = MonitorState::FILE_CHANGED;
+            monitoring_state.compare_exchange_strong(changed, MonitorState::MONITORING);
+        }
+    }
+}
@@ -0,0 +1,397 @@
+/**
+ * @file watch.hpp
+ * @brief Shared watch core that polls one file for every interested handle.
+ *
+ * @details
+ * A Watch owns the polling thread and change-detection state for a single
+ * file, identified by device and inode. MonitorFile objects that refer to
+ * the same file (through different paths, symlinks, bind mounts or hard
+ * links) share one Watch through the WatchRegistry, so the file is polled
+ * and a change is detected exactly once.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef WATCH_HPP
+#define WATCH_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+
+#include <sys/types.h>
+
+#include "canceltoken.hpp"
+#include "contentloader.hpp"
+#include "fsprobe.hpp"
+#include "subscriberlist.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * @enum MonitorState
+ * @brief Represents the possible states of the file monitoring process.
+ */
+enum class MonitorState
+{
+    NOT_MONITORING, ///< Monitoring has been stopped.
+    MONITORING,     ///< Monitoring is active, file exists, no recent changes.
+    FILE_NOT_FOUND, ///< The file does not exist.
+    FILE_CHANGED    ///< The file was modified and has stabilized.
+};
+
+/**
+ * @enum MonitorBackend
+ * @brief How a watch learns that its file may have changed.
+ */
+enum class MonitorBackend
+{
+    POLLING,  ///< Check the modification time every polling interval.
+    INOTIFY,  ///< Sleep until inotify reports activity, then debounce.
+    FANOTIFY, ///< Sleep until a fanotify filesystem mark reports activity.
+    AUTO      ///< Pick one of the above from the file system type.
+};
+
+/**
+ * @brief Lower-case name of a backend, for logs and metrics.
+ *
+ * @param backend Backend to name.
+ * @return "polling", "inotify", "fanotify" or "auto".
+ */
+const char *backend_name(MonitorBackend backend);
+
+/**
+ * @struct FileIdentity
+ * @brief Device and inode pair that identifies a file independent of path.
+ */
+struct FileIdentity
+{
+    dev_t dev = 0; ///< Device containing the file.
+    ino_t ino = 0; ///< Inode number on that device.
+
+    /**
+     * @brief Resolves the identity of @p path, following symlinks.
+     *
+     * @param path Path to the file.
+     * @return The identity, or std::nullopt if the file cannot be stat'ed.
+     */
+    static std::optional<FileIdentity> of(const std::string &path);
+
+    bool operator==(const FileIdentity &other) const
+    {
+        return dev == other.dev && ino == other.ino;
+    }
+};
+
+/**
+ * @struct FileIdentityHash
+ * @brief Hash functor for FileIdentity.
+ */
+struct FileIdentityHash
+{
+    std::size_t operator()(const FileIdentity &id) const
+    {
+        return static_cast<std::size_t>(id.ino) * 0x9E3779B97F4A7C15ULL ^
+               static_cast<std::size_t>(id.dev);
+    }
+};
+
+/**
+ * @class Watch
+ * @brief Polls one file in a background thread and fans changes out.
+ *
+ * @details
+ * Listeners are held in a SubscriberList, so attaching or detaching a
+ * MonitorFile never blocks detection or dispatch.
+ *
+ * Detection and dispatch run on separate threads. A change confirmed while
+ * listeners are still handling the previous one bumps the generation,
+ * which cancels the tokens those listeners hold; the dispatcher skips any
+ * listeners not yet reached and starts the newer generation right away.
+ * Intermediate generations that were never started are coalesced.
+ *
+ * With the INOTIFY backend the thread sleeps until the InotifyEngine
+ * reports activity on the file and only polls while a change is being
+ * debounced or while the file is missing. If inotify cannot watch the
+ * file the watch falls back to polling. FANOTIFY works the same way
+ * through the FanotifyEngine.
+ *
+ * AUTO probes the file system: local ones get INOTIFY (or FANOTIFY when
+ * inotify refuses the file, e.g. at the watch limit); remote and pseudo
+ * ones get POLLING, never faster than the mount's attribute cache
+ * lifetime, since inotify would miss changes made elsewhere.
+ *
+ * Deleting the file's directory detaches the inotify registration until
+ * InotifyEngine sees the directory created again; meanwhile the watch
+ * polls. It also registers again when the file reappears, so an event
+ * backend never silently stops reporting.
+ */
+class Watch
+{
+public:
+    /**
+     * @brief Creates the watch and starts its polling thread.
+     *
+     * @param path Path used to poll the file.
+     * @param identity Device and inode of the file.
+     * @param interval Initial polling interval.
+     * @param backend Initial change notification backend.
+     */
+    Watch(std::string path, FileIdentity identity, std::chrono::milliseconds interval,
+          MonitorBackend backend = MonitorBackend::POLLING);
+
+    /**
+     * @brief Stops the polling thread and unregisters from the registry.
+     */
+    ~Watch();
+
+    Watch(const Watch &) = delete;
+    Watch &operator=(const Watch &) = delete;
+
+    /**
+     * @brief Deleter for shared watches.
+     *
+     * @details
+     * A listener may drop the last handle on its own watch, which would
+     * run the destructor on a thread it has to join. In that case the
+     * watch is deleted from a short-lived thread instead, once the
+     * listener has returned.
+     *
+     * @param watch Watch to delete.
+     */
+    static void dispose(Watch *watch);
+
+    /**
+     * @brief Returns the cache of the file's contents.
+     *
+     * @details
+     * Shared by every handle attached to the watch, so a confirmed change
+     * is read once no matter how many handles want its contents.
+     */
+    std::shared_ptr<SharedContent> content_cache() const { return content; }
+
+    /// Listener invoked with a token for the change it handles.
+    using Listener = std::function<void(const CancelToken &)>;
+
+    /**
+     * @brief Adds a listener to be invoked once per confirmed change.
+     *
+     * @param func Listener to add.
+     * @return Identifier to pass to unsubscribe().
+     */
+    SubscriptionId subscribe(Listener func);
+
+    /// Listener told about unconfirmed activity, with the watched path.
+    using ActivityListener = std::function<void(const std::string &)>;
+
+    /**
+     * @brief Adds a listener for unconfirmed activity.
+     *
+     * @details
+     * Invoked on the polling thread when a change is first seen and again
+     * each time the file changes while the change is being debounced.
+     * Must not block.
+     *
+     * @param func Listener to add.
+     * @return Identifier to pass to unsubscribe_activity().
+     */
+    SubscriptionId subscribe_activity(ActivityListener func);
+
+    /**
+     * @brief Removes an activity listener and waits for any notification using it.
+     *
+     * @details
+     * When called from the polling thread the wait is skipped.
+     *
+     * @param id Identifier returned by subscribe_activity().
+     * @return true if the listener was removed.
+     */
+    bool unsubscribe_activity(SubscriptionId id);
+
+    /**
+     * @brief Adds a listener run at the moment a change is confirmed.
+     *
+     * @details
+     * Invoked on the polling thread as the state turns FILE_CHANGED,
+     * before the change is handed to the dispatch thread and before the
+     * file is checked again. Unlike subscribe(), every confirmed change
+     * reaches it; none is coalesced or cancelled. Detection waits while it
+     * runs, so it must be quick.
+     *
+     * @param func Listener to add.
+     * @return Identifier to pass to unsubscribe_confirm().
+     */
+    SubscriptionId subscribe_confirm(ActivityListener func);
+
+    /**
+     * @brief Removes a confirm listener and waits for any notification using it.
+     *
+     * @details
+     * When called from the polling thread the wait is skipped.
+     *
+     * @param id Identifier returned by subscribe_confirm().
+     * @return true if the listener was removed.
+     */
+    bool unsubscribe_confirm(SubscriptionId id);
+
+    /**
+     * @brief Removes a listener and waits for any dispatch using it to end.
+     *
+     * @details
+     * When called from the watch's dispatch thread (i.e. from inside a
+     * callback) the wait is skipped.
+     *
+     * @param id Identifier returned by subscribe().
+     * @return true if the listener was removed.
+     */
+    bool unsubscribe(SubscriptionId id);
+
+    /**
+     * @brief Sets the polling interval; the most recent call wins.
+     *
+     * @param interval Polling interval in milliseconds.
+     */
+    void set_polling_interval(std::chrono::milliseconds interval);
+
+    /**
+     * @brief Switches the change notification backend; the most recent call wins.
+     *
+     * @param backend Backend to use.
+     */
+    void set_backend(MonitorBackend backend);
+
+    /**
+     * @brief Backend actually in use.
+     *
+     * @details
+     * Never AUTO. Reports POLLING if an event backend was requested but
+     * the file could not be registered with its engine, or while its
+     * inotify registration is detached because the directory went away.
+     */
+    MonitorBackend get_backend() const;
+
+    /**
+     * @brief File system the last AUTO selection was based on.
+     *
+     * @return The probe result, or std::nullopt if AUTO was not used or
+     *         the file could not be probed.
+     */
+    std::optional<FilesystemInfo> filesystem() const;
+
+    /**
+     * @brief Sets the scheduling policy and priority of the watch threads.
+     *
+     * @details
+     * Applies to both the polling thread and the dispatch thread.
+     *
+     * @param schedPolicy The thread scheduling policy (e.g., SCHED_FIFO).
+     * @param priority The priority value for the thread.
+     * @return true if the scheduling parameters were applied.
+     */
+    bool set_priority(int schedPolicy, int priority);
+
+    /**
+     * @brief Retrieves the current monitoring state.
+     */
+    MonitorState get_state() const;
+
+    /**
+     * @brief Path the watch polls (the first path it was opened with).
+     */
+    const std::string &path() const { return file_name; }
+
+    /**
+     * @brief Device and inode the watch was registered under.
+     */
+    const FileIdentity &identity() const { return file_identity; }
+
+private:
+    /**
+     * @brief Internal thread function that runs the monitoring loop.
+     *
+     * @details
+     * Compares the file's last modification time periodically and detects
+     * stabilized changes. Notifies listeners if a change is confirmed.
+     */
+    void monitor_loop();
+
+    /**
+     * @brief Runs activity or confirm listeners with the watched path.
+     *
+     * @param targets List to notify.
+     * @param lock The polling loop's lock; released while listeners run.
+     */
+    void notify_path(const SubscriberList<ActivityListener> &targets,
+                     std::unique_lock<std::shared_mutex> &lock);
+
+    /**
+     * @brief Dispatch thread body; runs listeners for the latest generation.
+     */
+    void dispatch_loop();
+
+    /**
+     * @brief Wakes the monitoring loop after a backend event.
+     */
+    void wake();
+
+    /**
+     * @brief Unregisters from the event engines, if registered.
+     */
+    void release_backend();
+
+    /**
+     * @brief Registers with the engine @ref requested calls for.
+     *
+     * @note Caller must hold @ref backend_mutex.
+     */
+    void register_backend();
+
+    /**
+     * @brief Registers again after the file reappeared.
+     *
+     * @details
+     * Called from the monitoring loop without @ref mutex held. Does
+     * nothing once the watch is stopping.
+     */
+    void refresh_backend();
+
+    const std::string file_name;                ///< Path of the file being monitored.
+    const FileIdentity file_identity;           ///< Registry key of this watch.
+    std::optional<fs::file_time_type> org_time; ///< Last known modification timestamp.
+    std::thread monitoring_thread;              ///< Thread for running monitor loop.
+    std::atomic<bool> stop_monitoring;          ///< Signals monitoring loop to terminate.
+    std::chrono::milliseconds polling_interval; ///< Interval between file checks.
+    std::chrono::milliseconds interval_floor{0}; ///< Lower bound from AUTO, guarded by @ref mutex.
+    std::atomic<MonitorState> monitoring_state; ///< Tracks current monitor state.
+    SubscriberList<Listener> listeners;         ///< Attached handles.
+    SubscriberList<ActivityListener> activity_listeners; ///< Told about unconfirmed changes.
+    SubscriberList<ActivityListener> confirm_listeners;  ///< Run as each change is confirmed.
+    std::mutex dispatch_mutex;                  ///< Held while listeners run.
+    std::mutex activity_mutex;                  ///< Held while activity or confirm listeners run.
+    std::thread dispatch_thread;                ///< Runs listeners off the polling thread.
+    std::condition_variable_any dispatch_cv;    ///< Wakes the dispatch thread.
+    std::shared_ptr<std::atomic<std::uint64_t>> generation; ///< Confirmed change count.
+    const std::shared_ptr<SharedContent> content; ///< Contents, loaded once per generation.
+    mutable std::mutex backend_mutex;           ///< Serializes backend switches.
+    MonitorBackend requested = MonitorBackend::POLLING; ///< Last set_backend(); see backend_mutex.
+    std::atomic<std::uint64_t> inotify_token{0}; ///< InotifyEngine registration, or 0.
+    std::atomic<std::uint64_t> fanotify_token{0}; ///< FanotifyEngine registration, or 0.
+    std::optional<FilesystemInfo> filesystem_info; ///< Last AUTO probe; see backend_mutex.
+    bool pending_event = false;                 ///< Set by wake(), guarded by @ref mutex.
+    mutable std::shared_mutex mutex;            ///< Protects shared access to file state.
+    std::condition_variable_any cv;             ///< Condition variable for timing/sleep.
+    int stable_checks = 0;                      ///< Counts stable intervals before confirming change.
+};
+
+#endif // WATCH_HPP
@@ -0,0 +1,87 @@
+/**
+ * @file watchregistry.cpp
+ * @brief Implementation file for WatchRegistry.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#include "watchregistry.hpp"
+
+/**
+ * @brief Returns the process-wide registry.
+ *
+ * @details
+ * The instance is intentionally never destroyed so that MonitorFile
+ * objects with static storage duration can still release their watch
+ * during program exit.
+ *
+ * @return Reference to the singleton instance.
+ */
+WatchRegistry &WatchRegistry::instance()
+{
+    static WatchRegistry *registry = new WatchRegistry();
+    return *registry;
+}
+
+/**
+ * @brief Returns the shared watch for a file, creating it on first use.
+ *
+ * @details
+ * A live watch is shared only while its own path still names the file.
+ * After a rename (log rotation) or an inode reused after a delete, the
+ * watch polls a different file than @p identity now denotes, so a new
+ * watch takes over the index entry; the old one keeps its handles.
+ *
+ * @param path Path to poll if a new watch is created.
+ * @param identity Device and inode of the file.
+ * @param interval Polling interval for a newly created watch.
+ * @param backend Notification backend for a newly created watch.
+ * @return Shared watch for the file.
+ */
+std::shared_ptr<Watch> WatchRegistry::acquire(const std::string &path,
+                                              const FileIdentity &identity,
+                                              std::chrono::milliseconds interval,
+                                              MonitorBackend backend)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<Watch> &slot = index[identity];
+    if (auto existing = slot.lock())
+    {
+        if (FileIdentity::of(existing->path()) == identity)
+        {
+            return existing;
+        }
+    }
+
+    std::shared_ptr<Watch> watch(new Watch(path, identity, interval, backend), &Watch::dispose);
+    slot = watch;
+    return watch;
+}
+
+/**
+ * @brief Removes the entry for a destroyed watch.
+ *
+ * @param identity Device and inode of the destroyed watch.
+ */
+void WatchRegistry::release(const FileIdentity &identity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<Watch> *slot = index.find(identity);
+    if (slot && slot->expired())
+    {
+        index.erase(identity);
+    }
+}
+
+/**
+ * @brief Number of distinct files currently being watched.
+ *
+ * @return Count of live index entries.
+ */
+std::size_t WatchRegistry::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+}
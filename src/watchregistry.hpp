@@ -0,0 +1,84 @@
+/**
+ * @file watchregistry.hpp
+ * @brief Process-wide registry that deduplicates watches by device and inode.
+ *
+ * @details
+ * Every MonitorFile acquires its Watch through the registry. The registry
+ * canonicalizes the path to its (dev, inode) pair, so the same file opened
+ * through a symlink, a bind mount, a hard link or a relative path shares a
+ * single Watch, and therefore a single poll and a single detection.
+ *
+ * This software is distributed under the MIT License. See LICENSE.md for details.
+ *
+ * Copyright (C) 2025 Lee C. Bussy (@LBussy). All rights reserved.
+ */
+
+#ifndef WATCHREGISTRY_HPP
+#define WATCHREGISTRY_HPP
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "flathashmap.hpp"
+#include "watch.hpp"
+
+/**
+ * @class WatchRegistry
+ * @brief Maps file identities to the live Watch that polls them.
+ *
+ * @details
+ * The registry only holds weak references; a Watch lives for as long as
+ * at least one MonitorFile holds it and removes itself on destruction.
+ */
+class WatchRegistry
+{
+public:
+    /**
+     * @brief Returns the process-wide registry.
+     */
+    static WatchRegistry &instance();
+
+    /**
+     * @brief Returns the watch for @p identity, creating it if needed.
+     *
+     * @details
+     * An existing watch is shared only if the path it polls still leads
+     * to @p identity.
+     *
+     * @param path Path to poll if a new watch is created.
+     * @param identity Device and inode of the file.
+     * @param interval Polling interval for a newly created watch.
+     * @param backend Notification backend for a newly created watch.
+     * @return Shared watch for the file.
+     */
+    std::shared_ptr<Watch> acquire(const std::string &path,
+                                   const FileIdentity &identity,
+                                   std::chrono::milliseconds interval,
+                                   MonitorBackend backend = MonitorBackend::POLLING);
+
+    /**
+     * @brief Drops the index entry for @p identity if its watch is gone.
+     *
+     * @details
+     * Called from the Watch destructor. An entry that already refers to a
+     * newer live watch for the same identity is left in place.
+     *
+     * @param identity Device and inode of the destroyed watch.
+     */
+    void release(const FileIdentity &identity);
+
+    /**
+     * @brief Number of distinct files currently being watched.
+     */
+    std::size_t size();
+
+private:
+    WatchRegistry() = default;
+
+    std::mutex mutex; ///< Guards the index.
+    FlatHashMap<FileIdentity, std::weak_ptr<Watch>, FileIdentityHash> index; ///< Live watches.
+};
+
+#endif // WATCHREGISTRY_HPP